@@ -22,7 +22,8 @@ struct GeneticAlgorithm
                     MutationRate<Phenotype, Genotype>& mutationRate,
                     MatingStrategy<Phenotype, Genotype>& matingStrategy,
                     CombinationStrategy<Phenotype, Genotype>& combinationStrategy,
-                    SurvivalPolicy<Phenotype, Genotype>& survivalPolicy);
+                    SurvivalPolicy<Phenotype, Genotype>& survivalPolicy,
+                    GenerationObserver<Phenotype, Genotype>* observer = nullptr);
 
   Population<Phenotype, Genotype> iterate(Population<Phenotype,Genotype>&& population,
                                           std::size_t eliteSize);
@@ -36,6 +37,7 @@ struct GeneticAlgorithm
     MatingStrategy<Phenotype, Genotype>& matingStrategy_;
     CombinationStrategy<Phenotype, Genotype>& combinationStrategy_;
     SurvivalPolicy<Phenotype, Genotype>& survivalPolicy_;
+    GenerationObserver<Phenotype, Genotype>* observer_;
 };
 
 }
@@ -2,6 +2,7 @@
 // Distributed under New BSD License.
 // (see accompanying file COPYING)
 
+#include <algorithm>
 #include <map>
 #include <utility>
 #include "gene/algorithm.hpp"
@@ -17,14 +18,16 @@ GeneticAlgorithm<Phenotype,Genotype>::GeneticAlgorithm (
          MutationRate<Phenotype, Genotype>& mutationRate,
          MatingStrategy<Phenotype, Genotype>& matingStrategy,
          CombinationStrategy<Phenotype, Genotype>& combinationStrategy,
-         SurvivalPolicy<Phenotype, Genotype>& survivalPolicy)
+         SurvivalPolicy<Phenotype, Genotype>& survivalPolicy,
+         GenerationObserver<Phenotype, Genotype>* observer)
   : codec_(codec),
     fitnessFunction_(fitnessFunction),
     mutationStrategy_(mutationStrategy),
     mutationRate_(mutationRate),
     matingStrategy_(matingStrategy),
     combinationStrategy_(combinationStrategy),
-    survivalPolicy_(survivalPolicy)
+    survivalPolicy_(survivalPolicy),
+    observer_(observer)
 {
   // do nothing
 }
@@ -37,8 +40,12 @@ GeneticAlgorithm<Phenotype,Genotype>::iterate(Population<Phenotype, Genotype>&&
 {
   std::mt19937 generator {std::random_device{}()};
 
-  // Calculate fitness of the whole population
-  PopulationFitness fitness = fitnessFunction_.calculate(p);
+  // Calculate fitness of the whole population; only the individuals that
+  // may survive or be in the elite need an exact one
+  std::size_t ranked = std::max(survivalPolicy_.survivingRank(p.size()), eliteSize);
+  std::vector<bool> bounded;
+  PopulationFitness fitness = fitnessFunction_.calculateTop(p, ranked, &bounded);
+  if (observer_ != nullptr) observer_->observe(p, fitness, bounded);
 
   // Select elite for later
   std::multimap<FitnessType, PopulationIndex> fitnessMap;
@@ -54,7 +61,7 @@ GeneticAlgorithm<Phenotype,Genotype>::iterate(Population<Phenotype, Genotype>&&
   }
 
   // Apply selection policy
-  Survivors survivors { survivalPolicy_.selectSurvivors(p, fitness) };
+  std::vector<PopulationIndex> survivors = survivalPolicy_.selectIndices(p, fitness);
 
   // filter fitness for dropped individuals
   Population<Phenotype, Genotype> population = survivalPolicy_.select(move(p), survivors);
@@ -88,7 +95,7 @@ GeneticAlgorithm<Phenotype,Genotype>::iterate(Population<Phenotype, Genotype>&&
     std::bernoulli_distribution mutation(rates[k]);
     if (mutation(generator))
     {
-      offspring[k] = mutationStrategy_.mutate(offspring[k], codec_);
+      mutationStrategy_.mutateInPlace(offspring[k], codec_);
     }
   }
 
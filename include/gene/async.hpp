@@ -0,0 +1,137 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_ASYNC_HEADER_SEEN_
+#define GENE_ASYNC_HEADER_SEEN_
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Interface abstracting a fitness function that evaluates individuals in
+ * the background. submit() returns as soon as the evaluation is started;
+ * the future gets the fitness, or the exception thrown calculating it.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct AsyncFitnessFunction
+{
+  virtual std::future<FitnessType> submit(const Individual<Phenotype, Genotype>&) = 0;
+
+  virtual std::vector<std::future<FitnessType>>
+                   submit(const Population<Phenotype, Genotype>& population)
+  {
+    std::vector<std::future<FitnessType>> futures;
+    futures.reserve(population.size());
+    for (const auto& individual : population) futures.push_back(submit(individual));
+    return futures;
+  }
+
+  virtual ~AsyncFitnessFunction() { }
+};
+
+/******************************************************************************
+ * Runs a blocking fitness function on 'threads' threads (the hardware
+ * concurrency if 0), one individual per call. The function must be safe to
+ * call concurrently. When evaluations wait on I/O or external solvers,
+ * more threads than cores hide their latency.
+ * Evaluations still queued when it is destroyed are abandoned, and their
+ * futures get a broken_promise error.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct ThreadedFitness : public AsyncFitnessFunction<Phenotype, Genotype>
+{
+  using AsyncFitnessFunction<Phenotype, Genotype>::submit;
+
+  ThreadedFitness(FitnessFunction<Phenotype, Genotype>& function,
+                  std::size_t threads = 0);
+
+  ThreadedFitness(const ThreadedFitness&) = delete;
+  ThreadedFitness& operator=(const ThreadedFitness&) = delete;
+
+  ~ThreadedFitness();
+
+  std::future<FitnessType> submit(const Individual<Phenotype, Genotype>& individual) override;
+
+  private:
+
+    void run();
+
+    FitnessFunction<Phenotype, Genotype>& function_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::packaged_task<FitnessType()>> tasks_;
+    bool stopping_;
+    std::vector<std::thread> threads_;
+};
+
+/******************************************************************************
+ * Waits until at least 'count' of the futures are ready, and returns how
+ * many are. There is no portable way of waiting on several futures, so it
+ * polls the first one not ready with a short timeout.
+ *****************************************************************************/
+template<typename T>
+std::size_t waitForReady(const std::vector<std::future<T>>& futures, std::size_t count);
+
+/******************************************************************************
+ * GeneticAlgorithm with an asynchronous fitness function, pipelining
+ * evaluation and breeding. Each generation is submitted as a whole, and
+ * selection and breeding start once a 'quorum' fraction of the individuals
+ * in flight is evaluated. The rest are not in the population returned:
+ * they keep being evaluated while the next generation is bred and join
+ * the selection of the first generation after their fitness arrives, so
+ * that slow evaluations do not hold every generation back.
+ * With a quorum of 1 it is the same as GeneticAlgorithm. The observer, if
+ * any, sees the individuals evaluated in each generation. If an evaluation
+ * throws, iterate() rethrows it and drops the individuals evaluated in
+ * that call; those still in flight stay pending for the next one.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct PipelinedGeneticAlgorithm
+{
+  PipelinedGeneticAlgorithm (Codec<Phenotype, Genotype>& codec,
+                             AsyncFitnessFunction<Phenotype, Genotype>& fitnessFunction,
+                             MutationStrategy<Phenotype, Genotype>& mutationStrategy,
+                             MutationRate<Phenotype, Genotype>& mutationRate,
+                             MatingStrategy<Phenotype, Genotype>& matingStrategy,
+                             CombinationStrategy<Phenotype, Genotype>& combinationStrategy,
+                             SurvivalPolicy<Phenotype, Genotype>& survivalPolicy,
+                             double quorum = 0.9,
+                             GenerationObserver<Phenotype, Genotype>* observer = nullptr);
+
+  Population<Phenotype, Genotype> iterate(Population<Phenotype,Genotype>&& population,
+                                          std::size_t eliteSize);
+
+  // Individuals still being evaluated
+  std::size_t pending() const { return inFlight_.size(); }
+
+  private:
+
+    Codec<Phenotype, Genotype>& codec_;
+    AsyncFitnessFunction<Phenotype, Genotype>& fitnessFunction_;
+    MutationStrategy<Phenotype, Genotype>& mutationStrategy_;
+    MutationRate<Phenotype, Genotype>& mutationRate_;
+    MatingStrategy<Phenotype, Genotype>& matingStrategy_;
+    CombinationStrategy<Phenotype, Genotype>& combinationStrategy_;
+    SurvivalPolicy<Phenotype, Genotype>& survivalPolicy_;
+    const double quorum_;
+    GenerationObserver<Phenotype, Genotype>* observer_;
+    Population<Phenotype, Genotype> inFlight_;
+    std::vector<std::future<FitnessType>> futures_;    // one per inFlight_
+    std::mt19937 generator_;
+};
+
+}
+
+#include "gene/async_impl.hpp"
+#endif
@@ -0,0 +1,228 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+
+namespace gene {
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+ThreadedFitness<Phenotype, Genotype>::ThreadedFitness(
+                               FitnessFunction<Phenotype, Genotype>& function,
+                               std::size_t threads)
+  : function_(function),
+    stopping_(false)
+{
+  if (threads == 0) threads = hardwareThreads();
+  for (std::size_t k = 0; k < threads; ++k) threads_.emplace_back([this] { run(); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+ThreadedFitness<Phenotype, Genotype>::~ThreadedFitness()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    tasks_.clear();
+  }
+  ready_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+std::future<FitnessType> ThreadedFitness<Phenotype, Genotype>::submit(
+                           const Individual<Phenotype, Genotype>& individual)
+{
+  FitnessFunction<Phenotype, Genotype>& function = function_;
+  std::packaged_task<FitnessType()> task([&function, individual]
+  {
+    Population<Phenotype, Genotype> population(1, individual);
+    return function.calculate(population).at(0);
+  });
+  std::future<FitnessType> result = task.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  ready_.notify_one();
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+void ThreadedFitness<Phenotype, Genotype>::run()
+{
+  while (true)
+  {
+    std::packaged_task<FitnessType()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (stopping_) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename T>
+std::size_t waitForReady(const std::vector<std::future<T>>& futures, std::size_t count)
+{
+  count = std::min(count, futures.size());
+  while (true)
+  {
+    std::size_t ready = 0;
+    const std::future<T>* waiting = nullptr;
+    for (const std::future<T>& future : futures)
+    {
+      if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) ++ready;
+      else if (waiting == nullptr) waiting = &future;
+    }
+    if (ready >= count) return ready;
+    waiting->wait_for(std::chrono::milliseconds(1));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+PipelinedGeneticAlgorithm<Phenotype,Genotype>::PipelinedGeneticAlgorithm (
+         Codec<Phenotype, Genotype>& codec,
+         AsyncFitnessFunction<Phenotype, Genotype>& fitnessFunction,
+         MutationStrategy<Phenotype, Genotype>& mutationStrategy,
+         MutationRate<Phenotype, Genotype>& mutationRate,
+         MatingStrategy<Phenotype, Genotype>& matingStrategy,
+         CombinationStrategy<Phenotype, Genotype>& combinationStrategy,
+         SurvivalPolicy<Phenotype, Genotype>& survivalPolicy,
+         double quorum,
+         GenerationObserver<Phenotype, Genotype>* observer)
+  : codec_(codec),
+    fitnessFunction_(fitnessFunction),
+    mutationStrategy_(mutationStrategy),
+    mutationRate_(mutationRate),
+    matingStrategy_(matingStrategy),
+    combinationStrategy_(combinationStrategy),
+    survivalPolicy_(survivalPolicy),
+    quorum_(std::min(std::max(quorum, 0.0), 1.0)),
+    observer_(observer),
+    generator_(std::random_device{}())
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+Population<Phenotype, Genotype>
+PipelinedGeneticAlgorithm<Phenotype,Genotype>::iterate(Population<Phenotype, Genotype>&& p,
+                                                       std::size_t eliteSize)
+{
+  // Start evaluating the new individuals, along with those still in flight
+  std::vector<std::future<FitnessType>> futures = fitnessFunction_.submit(p);
+  inFlight_.insert(inFlight_.end(),
+                   std::make_move_iterator(p.begin()),
+                   std::make_move_iterator(p.end()));
+  futures_.insert(futures_.end(),
+                  std::make_move_iterator(futures.begin()),
+                  std::make_move_iterator(futures.end()));
+  if (inFlight_.empty()) return Population<Phenotype, Genotype>();
+
+  // Wait for the quorum, and take every individual evaluated by then
+  std::size_t quorum = std::max<std::size_t>(1, std::ceil(quorum_ * inFlight_.size()));
+  waitForReady(futures_, quorum);
+
+  // The ready ones are moved out before their results are read, so that an
+  // evaluation that threw leaves the pending individuals consistent
+  Population<Phenotype, Genotype> population;
+  std::vector<std::future<FitnessType>> ready;
+  std::size_t kept = 0;
+  for (std::size_t k = 0; k < inFlight_.size(); ++k)
+  {
+    if (futures_[k].wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+      ready.push_back(std::move(futures_[k]));
+      population.push_back(std::move(inFlight_[k]));
+    }
+    else
+    {
+      if (kept != k)
+      {
+        inFlight_[kept] = std::move(inFlight_[k]);
+        futures_[kept] = std::move(futures_[k]);
+      }
+      ++kept;
+    }
+  }
+  inFlight_.erase(inFlight_.begin() + kept, inFlight_.end());
+  futures_.erase(futures_.begin() + kept, futures_.end());
+
+  PopulationFitness fitness;
+  fitness.reserve(ready.size());
+  for (std::future<FitnessType>& result : ready) fitness.push_back(result.get());
+  if (observer_ != nullptr) observer_->observe(population, fitness);
+
+  // From here on, the same as GeneticAlgorithm on the evaluated individuals
+
+  // Select elite for later, best first
+  std::vector<PopulationIndex> order(population.size());
+  for (PopulationIndex k = 0; k < order.size(); ++k) order[k] = k;
+  eliteSize = std::min(eliteSize, order.size());
+  std::partial_sort(order.begin(), order.begin() + eliteSize, order.end(),
+                    [&fitness](PopulationIndex a, PopulationIndex b)
+                    { return fitness[a] > fitness[b]; });
+  Population<Phenotype, Genotype> elite;
+  elite.reserve(eliteSize);
+  for (std::size_t k = 0; k < eliteSize; ++k) elite.push_back(population[order[k]]);
+
+  // Apply selection policy
+  std::vector<PopulationIndex> survivors = survivalPolicy_.selectIndices(population, fitness);
+  population = survivalPolicy_.select(std::move(population), survivors);
+  fitness = survivalPolicy_.select(std::move(fitness), survivors);
+
+  // Determine the mating among individuals of the population
+  auto mating = matingStrategy_.mating(population, fitness);
+
+  // Combine each of the pairs specified in the calculated mating
+  Population<Phenotype, Genotype> offspring;
+  offspring.reserve(mating.size() + eliteSize);
+  for (const auto& entry : mating)
+  {
+    PopulationIndex index1 = std::get<0>(entry);
+    PopulationIndex index2 = std::get<1>(entry);
+    NumberOfChildren numOffspring = std::get<2>(entry);
+
+    const Individual<Phenotype, Genotype>& i1 = population[index1];
+    const Individual<Phenotype, Genotype>& i2 = population[index2];
+
+    for (std::size_t k = 0; k < numOffspring; ++k)
+    {
+      offspring.push_back(combinationStrategy_.combine(i1, i2, codec_));
+    }
+  }
+
+  // Mutate offspring
+  PopulationMutationRates rates = mutationRate_.mutationProbability(offspring);
+  std::size_t offspringSize = offspring.size();
+  for (std::size_t k = 0; k < offspringSize; ++k)
+  {
+    std::bernoulli_distribution mutation(rates[k]);
+    if (mutation(generator_))
+    {
+      mutationStrategy_.mutateInPlace(offspring[k], codec_);
+    }
+  }
+
+  // Keep the best from the previous generation (i.e. elitism)
+  offspring.insert(offspring.end(),
+                   std::make_move_iterator(elite.begin()),
+                   std::make_move_iterator(elite.end()));
+  return offspring;
+}
+
+}
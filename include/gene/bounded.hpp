@@ -0,0 +1,159 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_BOUNDED_HEADER_SEEN_
+#define GENE_BOUNDED_HEADER_SEEN_
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Counters of a BoundedFitnessFunction.
+ *****************************************************************************/
+struct BoundedStatistics
+{
+  std::size_t evaluated = 0;    // individuals evaluated
+  std::size_t bounded = 0;      // of them, given a value below their cutoff
+};
+
+/******************************************************************************
+ * Fitness function that may stop evaluating an individual as soon as its
+ * fitness is certain to be below a cutoff, as sums over many test cases or
+ * time steps can. evaluate() returns either the fitness of the individual,
+ * or an upper bound of it that is below the cutoff.
+ *
+ * calculateTop() keeps the 'count' best values at or above the cutoff seen
+ * so far, all of them exact, and once there are 'count' of them passes the
+ * worst as the cutoff: an individual below it can't be among the 'count'
+ * fittest, so truncation, tournaments and elitism choose the same as with
+ * exact values (see SurvivalPolicy::survivingRank). The individuals are
+ * evaluated from the last to the first, so that the elite GeneticAlgorithm
+ * appends to the offspring sets a tight cutoff early, on 'threads' threads
+ * (the hardware concurrency if 0) sharing the cutoff; evaluate() must then
+ * be safe to call concurrently. The individuals given a value below their
+ * cutoff are flagged as bounded, and GeneticAlgorithm passes the flags to
+ * its GenerationObserver so that the bounds do not bias its statistics.
+ * calculate() evaluates every individual exactly.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct BoundedFitnessFunction : public FitnessFunction<Phenotype, Genotype>
+{
+  BoundedFitnessFunction(std::size_t threads = 1) : threads_(threads)
+  {
+    // do nothing
+  }
+
+  virtual FitnessType evaluate(const Individual<Phenotype, Genotype>& individual,
+                               FitnessType cutoff) = 0;
+
+  PopulationFitness calculate(const Population<Phenotype, Genotype>& population) override
+  {
+    return calculateTop(population, population.size());
+  }
+
+  PopulationFitness calculateTop(const Population<Phenotype, Genotype>& population,
+                                 std::size_t count,
+                                 std::vector<bool>* bounded = nullptr) override
+  {
+    std::size_t size = population.size();
+    PopulationFitness fitness(size);
+    std::vector<char> below(size, 0);
+
+    // min-heap of the best values, the cutoff being the worst of them
+    std::priority_queue<FitnessType, std::vector<FitnessType>,
+                        std::greater<FitnessType>> best;
+    FitnessType lowest = std::numeric_limits<FitnessType>::lowest();
+    FitnessType cutoff = count == 0 ? std::numeric_limits<FitnessType>::max() : lowest;
+    std::mutex mutex;
+
+    parallelFor(size, threads_, [&](std::size_t k)
+    {
+      PopulationIndex index = size - 1 - k;
+      FitnessType current;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = cutoff;
+      }
+
+      FitnessType f = evaluate(population[index], current);
+      fitness[index] = f;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (f < current)
+      {
+        // may be a bound; exact values below a cutoff never raise it
+        below[index] = 1;
+      }
+      else if (count > 0 && (best.size() < count || f > best.top()))
+      {
+        if (best.size() == count) best.pop();
+        best.push(f);
+        if (best.size() == count) cutoff = best.top();
+      }
+    });
+
+    statistics_.evaluated += size;
+    statistics_.bounded += std::count(below.begin(), below.end(), 1);
+    if (bounded != nullptr) bounded->assign(below.begin(), below.end());
+    return fitness;
+  }
+
+  const BoundedStatistics& statistics() const { return statistics_; }
+
+  private:
+    const std::size_t threads_;
+    BoundedStatistics statistics_;
+};
+
+/******************************************************************************
+ * Bounded fitness given by the sum of the scores of 'cases' test cases (or
+ * time steps), each at most 'caseBound'. The evaluation stops when the
+ * score so far plus 'caseBound' for each remaining case is below the
+ * cutoff, returning that sum as the bound.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct SummedFitness : public BoundedFitnessFunction<Phenotype, Genotype>
+{
+  using Score = std::function<FitnessType(const Individual<Phenotype, Genotype>&,
+                                          std::size_t)>;
+
+  SummedFitness(std::size_t cases, Score score, FitnessType caseBound,
+                std::size_t threads = 1)
+    : BoundedFitnessFunction<Phenotype, Genotype>(threads),
+      cases_(cases),
+      score_(score),
+      caseBound_(caseBound)
+  {
+    // do nothing
+  }
+
+  FitnessType evaluate(const Individual<Phenotype, Genotype>& individual,
+                       FitnessType cutoff) override
+  {
+    FitnessType sum = 0;
+    for (std::size_t c = 0; c < cases_; ++c)
+    {
+      FitnessType bound = sum + caseBound_ * (cases_ - c);
+      if (bound < cutoff) return bound;
+      sum += score_(individual, c);
+    }
+    return sum;
+  }
+
+  private:
+    const std::size_t cases_;
+    Score score_;
+    const FitnessType caseBound_;
+};
+
+}
+#endif
@@ -5,59 +5,214 @@
 #ifndef BITSTRING_GENOTIPE_HEADER_SEEN___
 #define BITSTRING_GENOTIPE_HEADER_SEEN___
 
-#include <memory>
 #include <vector>
-#include <string>
-#include <stdexcept>
-#include <boost/noncopyable.hpp>
+#include <random>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+
 #include "gene/policies.hpp"
+#include "gene/statistics.hpp"
+
+namespace gene { namespace coding { namespace bitstring {
 
-namespace gene { namespace bitstring {
+typedef uint64_t Word;
+const std::size_t BITS_PER_WORD = 64;
+
+/******************************************************************************
+ * Number of bits set in a word.
+ *****************************************************************************/
+inline std::size_t popcount(Word w)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(w);
+#else
+  std::size_t count = 0;
+  for (; w != 0; w &= w - 1) ++count;
+  return count;
+#endif
+}
 
 /******************************************************************************
  * PoD representing a chromosome.
- * Immutable sequence of encoded genes.
+ * Sequence of bits packed in 64-bit words: bit k is bit k%64 of word k/64.
+ * The bits past the last one are always zero, so fitness functions can
+ * work on whole words (e.g. popcount them) without masking the tail.
  *****************************************************************************/
-struct Chromosome : boost::noncopyable
+struct Chromosome
 {
-  const std::vector<uint8_t> encodedGenes;
+  std::vector<Word> words;
+  std::size_t size;
+
+  Chromosome() : size(0) { }
+
+  explicit Chromosome(std::size_t bits)
+    : words((bits + BITS_PER_WORD - 1) / BITS_PER_WORD, 0), size(bits) { }
+
+  Chromosome(const std::vector<bool>& bits);
+
+  bool get(std::size_t k) const
+  {
+    assert(k < size);
+    return (words[k / BITS_PER_WORD] >> (k % BITS_PER_WORD)) & 1;
+  }
+
+  void set(std::size_t k, bool value)
+  {
+    assert(k < size);
+    Word bit = Word(1) << (k % BITS_PER_WORD);
+    if (value) words[k / BITS_PER_WORD] |= bit;
+    else words[k / BITS_PER_WORD] &= ~bit;
+  }
+
+  void flip(std::size_t k)
+  {
+    assert(k < size);
+    words[k / BITS_PER_WORD] ^= Word(1) << (k % BITS_PER_WORD);
+  }
+
+  // Number of bits set
+  std::size_t count() const;
+
+  // Number of bits set in [begin, end)
+  std::size_t count(std::size_t begin, std::size_t end) const;
+
+  // Value of the bits [begin, begin + width), with width <= 64
+  Word bits(std::size_t begin, std::size_t width) const;
+
+  bool operator==(const Chromosome& o) const
+  {
+    return size == o.size && words == o.words;
+  }
 };
 
 /******************************************************************************
  * PoD representing the genotype of an individual.
- * Immutable sequence of chromosomes.
+ * Sequence of chromosomes. Mutation strategies modify it in place.
  *****************************************************************************/
-struct Genotype : boost::noncopyable
+struct Genotype
 {
-  const std::vector<std::unique_ptr<Chromosome>> chromosomes;
+  std::vector<Chromosome> chromosomes;
+
+  Genotype() = default;
+
+  Genotype(std::vector<Chromosome> c) : chromosomes(std::move(c)) { }
+
+  // Number of bits set in all the chromosomes
+  std::size_t count() const;
 };
 
+/******************************************************************************
+ * Chromosome of the given size whose bits are set with probability 1/2.
+ *****************************************************************************/
+inline Chromosome randomChromosome(std::size_t bits, std::mt19937& random);
+
 /****************************************************************************
  * Implementation of mutation with a fixed probability.
+ * Each bit is flipped with the given probability. Only the flipped bits are
+ * visited: the distance between consecutive flips is drawn from a geometric
+ * distribution, and the flips falling in the same word are applied at once
+ * with a single XOR mask.
+ * The mutated region reports, for each chromosome, the span between the
+ * first and the last flipped bit.
  ***************************************************************************/
-struct BitFlipMutation : public gene::MutationStrategy<Genotype>,
-                         boost::noncopyable
+template<typename Phenotype>
+struct BitFlipMutation : public MutationStrategy<Phenotype, Genotype>
 {
-  BitFlipMutation (float bitMutationProbability);
+  BitFlipMutation(float bitMutationProbability, uint32_t seed);
+
+  BitFlipMutation(const BitFlipMutation&) = delete;
 
-  std::unique_ptr<Genotype> mutate(const Genotype&);
+  void mutateInPlace(std::pair<Phenotype, Genotype>&,
+                     const Codec<Phenotype, Genotype>&,
+                     MutatedRegion* region = nullptr) override;
 
-  private: const float percentageOfMutation_;
-};  
+  private:
+    const float bitMutationProbability_;
+    std::mt19937 random_;
+    std::geometric_distribution<std::size_t> distance_;
+};
 
 /****************************************************************************
  * Implementation of Combination that performs N point crossover.
+ * Each chromosome of the child takes its bits alternately from the same
+ * chromosome of each parent, switching at numberOfPoints random positions.
+ * Both parents must have the same chromosome sizes.
  ***************************************************************************/
-struct OnePointCrossover : public CombinationStrategy<Genotype>,
-                           boost::noncopyable
+template<typename Phenotype>
+struct NPointCrossover : public CombinationStrategy<Phenotype, Genotype>
 {
-  OnePointCrossover ();
-  std::unique_ptr<Genotype> combine(const Genotype&, const Genotype&);
-  private: const std::size_t numberOfPoints_;
+  NPointCrossover(std::size_t numberOfPoints, uint32_t seed);
+
+  NPointCrossover(const NPointCrossover&) = delete;
+
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
+
+  private:
+    const std::size_t numberOfPoints_;
+    std::mt19937 random_;
+};
+
+/****************************************************************************
+ * Implementation of Combination that performs one point crossover.
+ ***************************************************************************/
+template<typename Phenotype>
+struct OnePointCrossover : public NPointCrossover<Phenotype>
+{
+  OnePointCrossover(uint32_t seed) : NPointCrossover<Phenotype>(1, seed) { }
+};
+
+/****************************************************************************
+ * Implementation of Combination that performs uniform crossover.
+ * Each bit of the child comes from either parent with probability 1/2.
+ * Both parents must have the same chromosome sizes.
+ ***************************************************************************/
+template<typename Phenotype>
+struct UniformCrossover : public CombinationStrategy<Phenotype, Genotype>
+{
+  UniformCrossover(uint32_t seed);
+
+  UniformCrossover(const UniformCrossover&) = delete;
+
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
+
+  private: std::mt19937_64 random_;
+};
+
+/****************************************************************************
+ * Chromosome of the size of c1 taking the bits of word w from c2 where
+ * mask(w) has them set, and from c1 elsewhere. c2 must not be shorter.
+ ***************************************************************************/
+template<typename MaskFunction>
+Chromosome mix(const Chromosome& c1, const Chromosome& c2, MaskFunction mask);
+
+/****************************************************************************
+ * Diversity of the population from the number of ones at every locus,
+ * counted with a LocusCounter per chromosome in a single pass. This gives
+ * the exact mean Hamming distance between two individuals, without
+ * comparing every pair, and the mean binary entropy of the loci. Loci past
+ * the end of a chromosome of one of the individuals do not count.
+ ***************************************************************************/
+struct LocusDiversity : public DiversityEstimator<Genotype>
+{
+  void clear() override;
+  void add(const Genotype& genotype) override;
+  Diversity estimate() override;
+
+  private:
+    std::vector<LocusCounter> ones_;                 // one per chromosome
+    std::vector<std::vector<std::size_t>> lengths_;  // one per chromosome
+    std::size_t individuals_ = 0;
 };
 
-}}
+}}}
 
-#include "gene/bitstring_impl.hpp"
+#include "gene/coding/bitstring_impl.hpp"
 
 #endif
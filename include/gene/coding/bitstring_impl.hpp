@@ -2,31 +2,292 @@
 // Distributed under New BSD License.
 // (see accompanying file COPYING)
 
-namespace gene { namespace bitstring {
+#include <limits>
 
-/*****************************************************************************/
-BitFlipMutation::BitFlipMutation (float bitMutationProbability)
-  : percentageOfMutation_(bitMutationProbability)
+namespace gene { namespace coding { namespace bitstring {
+
+///////////////////////////////////////////////////////////////////////////////
+inline Chromosome::Chromosome(const std::vector<bool>& bits)
+  : Chromosome(bits.size())
+{
+  for (std::size_t k = 0; k < bits.size(); ++k)
+  {
+    if (bits[k]) words[k / BITS_PER_WORD] |= Word(1) << (k % BITS_PER_WORD);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t Chromosome::count() const
+{
+  std::size_t result = 0;
+  for (Word w : words) result += popcount(w);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t Chromosome::count(std::size_t begin, std::size_t end) const
+{
+  assert(begin <= end && end <= size);
+  if (begin == end) return 0;
+
+  std::size_t first = begin / BITS_PER_WORD;
+  std::size_t last = (end - 1) / BITS_PER_WORD;
+  Word head = ~Word(0) << (begin % BITS_PER_WORD);
+  Word tail = ~Word(0) >> (BITS_PER_WORD - 1 - (end - 1) % BITS_PER_WORD);
+
+  if (first == last) return popcount(words[first] & head & tail);
+
+  std::size_t result = popcount(words[first] & head) + popcount(words[last] & tail);
+  for (std::size_t w = first + 1; w < last; ++w) result += popcount(words[w]);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline Word Chromosome::bits(std::size_t begin, std::size_t width) const
+{
+  assert(width <= BITS_PER_WORD && begin + width <= size);
+  if (width == 0) return 0;
+
+  std::size_t w = begin / BITS_PER_WORD;
+  std::size_t shift = begin % BITS_PER_WORD;
+  Word result = words[w] >> shift;
+  if (shift != 0 && w + 1 < words.size()) result |= words[w + 1] << (BITS_PER_WORD - shift);
+  return width == BITS_PER_WORD ? result : result & ((Word(1) << width) - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t Genotype::count() const
+{
+  std::size_t result = 0;
+  for (const Chromosome& c : chromosomes) result += c.count();
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline Chromosome randomChromosome(std::size_t bits, std::mt19937& random)
+{
+  Chromosome result(bits);
+  for (Word& w : result.words)
+  {
+    w = (Word(random()) << 32) | Word(random());
+  }
+  if (bits % BITS_PER_WORD != 0)
+  {
+    result.words.back() &= (Word(1) << (bits % BITS_PER_WORD)) - 1;
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename MaskFunction>
+Chromosome mix(const Chromosome& c1, const Chromosome& c2, MaskFunction mask)
+{
+  assert(c2.size >= c1.size);
+  Chromosome result(c1.size);
+  std::size_t wordCount = result.words.size();
+  for (std::size_t w = 0; w < wordCount; ++w)
+  {
+    Word m = mask(w);
+    result.words[w] = (c1.words[w] & ~m) | (c2.words[w] & m);
+  }
+  if (c1.size % BITS_PER_WORD != 0 && wordCount > 0)
+  {
+    result.words.back() &= (Word(1) << (c1.size % BITS_PER_WORD)) - 1;
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+BitFlipMutation<Phenotype>::BitFlipMutation(float bitMutationProbability, uint32_t seed)
+  : bitMutationProbability_(bitMutationProbability),
+    random_(seed),
+    distance_(std::min(1.0, std::max<double>(bitMutationProbability,
+                                             std::numeric_limits<double>::min())))
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+void BitFlipMutation<Phenotype>::mutateInPlace(std::pair<Phenotype, Genotype>& i,
+                                               const Codec<Phenotype, Genotype>& codec,
+                                               MutatedRegion* region)
+{
+  if (bitMutationProbability_ <= 0) return;
+
+  std::vector<Chromosome>& chromosomes = i.second.chromosomes;
+
+  for (std::size_t c = 0; c < chromosomes.size(); ++c)
+  {
+    Chromosome& chromosome = chromosomes[c];
+    std::size_t length = chromosome.size;
+    std::size_t first = length;
+    std::size_t last = 0;
+
+    // gather the flips of each word in a mask and apply them together
+    std::size_t currentWord = 0;
+    Word mask = 0;
+    for (std::size_t pos = distance_(random_);
+         pos < length;
+         pos += 1 + distance_(random_))
+    {
+      std::size_t w = pos / BITS_PER_WORD;
+      if (w != currentWord)
+      {
+        chromosome.words[currentWord] ^= mask;
+        currentWord = w;
+        mask = 0;
+      }
+      mask |= Word(1) << (pos % BITS_PER_WORD);
+      first = std::min(first, pos);
+      last = pos;
+    }
+    if (mask != 0) chromosome.words[currentWord] ^= mask;
+
+    if (first < length) reportMutation(region, c, first, last + 1);
+  }
+
+  i.first = codec.decode(i.second);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+NPointCrossover<Phenotype>::NPointCrossover(std::size_t numberOfPoints, uint32_t seed)
+  : numberOfPoints_(numberOfPoints), random_(seed)
 {
-  //TODO
+  // do nothing
 }
 
-/*****************************************************************************/
-std::unique_ptr<Genotype> BitFlipMutation::mutate(const Genotype&)
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+std::pair<Phenotype, Genotype>
+NPointCrossover<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                    const std::pair<Phenotype, Genotype>& i2,
+                                    const Codec<Phenotype, Genotype>& codec)
 {
-  //TODO
+  const std::vector<Chromosome>& c1 = i1.second.chromosomes;
+  const std::vector<Chromosome>& c2 = i2.second.chromosomes;
+  assert(c1.size() == c2.size());
+
+  std::vector<Chromosome> chromosomes;
+  chromosomes.reserve(c1.size());
+  std::vector<std::size_t> cuts(numberOfPoints_);
+
+  for (std::size_t c = 0; c < c1.size(); ++c)
+  {
+    std::size_t length = c1[c].size;
+    std::uniform_int_distribution<std::size_t> position(1, length > 1 ? length - 1 : 1);
+    for (std::size_t& cut : cuts) cut = position(random_);
+    std::sort(cuts.begin(), cuts.end());
+
+    // each cut toggles the source of the bits from it onwards
+    std::size_t nextCut = 0;
+    Word fill = 0;
+    chromosomes.push_back(mix(c1[c], c2[c], [&](std::size_t w)
+    {
+      Word m = fill;
+      while (nextCut < cuts.size() && cuts[nextCut] < (w + 1) * BITS_PER_WORD)
+      {
+        m ^= ~Word(0) << (cuts[nextCut] % BITS_PER_WORD);
+        fill = ~fill;
+        ++nextCut;
+      }
+      return m;
+    }));
+  }
+
+  Genotype combinedGenotype{std::move(chromosomes)};
+  Phenotype combinedPhenotype = codec.decode(combinedGenotype);
+  return std::make_pair(std::move(combinedPhenotype), std::move(combinedGenotype));
 }
 
-/*****************************************************************************/
-OnePointCrossover::OnePointCrossover ()
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+UniformCrossover<Phenotype>::UniformCrossover(uint32_t seed)
+  : random_(seed)
 {
-  //TODO
+  // do nothing
 }
 
-/*****************************************************************************/
-std::unique_ptr<Genotype> OnePointCrossover::combine(const Genotype&, const Genotype&)
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+std::pair<Phenotype, Genotype>
+UniformCrossover<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                     const std::pair<Phenotype, Genotype>& i2,
+                                     const Codec<Phenotype, Genotype>& codec)
 {
-  //TODO
+  const std::vector<Chromosome>& c1 = i1.second.chromosomes;
+  const std::vector<Chromosome>& c2 = i2.second.chromosomes;
+  assert(c1.size() == c2.size());
+
+  std::vector<Chromosome> chromosomes;
+  chromosomes.reserve(c1.size());
+  for (std::size_t c = 0; c < c1.size(); ++c)
+  {
+    chromosomes.push_back(mix(c1[c], c2[c], [this](std::size_t)
+    {
+      return Word(random_());
+    }));
+  }
+
+  Genotype combinedGenotype{std::move(chromosomes)};
+  Phenotype combinedPhenotype = codec.decode(combinedGenotype);
+  return std::make_pair(std::move(combinedPhenotype), std::move(combinedGenotype));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void LocusDiversity::clear()
+{
+  ones_.clear();
+  lengths_.clear();
+  individuals_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void LocusDiversity::add(const Genotype& genotype)
+{
+  std::size_t count = genotype.chromosomes.size();
+  if (count > ones_.size())
+  {
+    ones_.resize(count);
+    lengths_.resize(count);
+  }
+  for (std::size_t c = 0; c < count; ++c)
+  {
+    const Chromosome& chromosome = genotype.chromosomes[c];
+    ones_[c].add(chromosome.words.data(), chromosome.words.size());
+    lengths_[c].push_back(chromosome.size);
+  }
+  ++individuals_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline Diversity LocusDiversity::estimate()
+{
+  Diversity result;
+  if (individuals_ < 2) return result;
+
+  // at a locus with m individuals, 'ones' of them with a one, ones * (m - ones)
+  // pairs differ
+  double differences = 0, entropySum = 0;
+  std::size_t loci = 0;
+  for (std::size_t c = 0; c < ones_.size(); ++c)
+  {
+    std::vector<std::size_t> counts = ones_[c].counts();
+    std::vector<std::size_t> covering = coverage(lengths_[c]);
+    for (std::size_t k = 0; k < covering.size(); ++k)
+    {
+      std::size_t symbols[2] = {counts[k], covering[k] - counts[k]};
+      differences += double(symbols[0]) * symbols[1];
+      entropySum += entropy(symbols, 2, covering[k]);
+      ++loci;
+    }
+  }
+
+  result.meanDistance = differences / (individuals_ * (individuals_ - 1) / 2.0);
+  if (loci > 0) result.entropy = entropySum / loci;
+  return result;
 }
 
-}}
+}}}
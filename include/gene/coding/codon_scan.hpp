@@ -0,0 +1,377 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef DNA_CODON_SCAN_HEADER_SEEN__
+#define DNA_CODON_SCAN_HEADER_SEEN__
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace gene { namespace coding { namespace dna {
+
+typedef PackedBases::Word Word;
+
+/******************************************************************************
+ * Aminoacid of a codon. It is also the value of the 6 bits that the codon
+ * takes in a PackedBases word.
+ *****************************************************************************/
+constexpr Aminoacid codonValue(const Codon& codon)
+{
+  return static_cast<uint8_t>(codon[0])
+         + static_cast<uint8_t>(codon[1]) * NUMBER_OF_BASES
+         + static_cast<uint8_t>(codon[2]) * NUMBER_OF_BASES * NUMBER_OF_BASES;
+}
+
+/******************************************************************************
+ * Classification of the 64 codons, indexed by aminoacid.
+ *****************************************************************************/
+struct CodonTable
+{
+  bool start[64];
+  bool stop[64];
+};
+
+constexpr CodonTable makeCodonTable()
+{
+  CodonTable table{};
+  for (std::size_t k = 0; k < START_CODONS.size(); ++k)
+  {
+    table.start[codonValue(START_CODONS[k])] = true;
+  }
+  for (std::size_t k = 0; k < STOP_CODONS.size(); ++k)
+  {
+    table.stop[codonValue(STOP_CODONS[k])] = true;
+  }
+  return table;
+}
+
+constexpr CodonTable CODON_TABLE = makeCodonTable();
+
+/******************************************************************************
+ * Scan masks use one bit per base: the codon starting at base 64*k + i is
+ * flagged by bit i of mask word k. The stop codons of each reading frame
+ * are further packed to one bit per codon of the frame.
+ *****************************************************************************/
+const Word EVEN_BITS = 0x5555555555555555ULL;
+
+constexpr Word everyThirdBit(std::size_t residue)
+{
+  Word mask = 0;
+  for (std::size_t bit = residue; bit < 64; bit += CODON_SIZE)
+  {
+    mask |= Word(1) << bit;
+  }
+  return mask;
+}
+
+// Number of bits whose index is congruent to 0, 1 and 2 modulo CODON_SIZE
+const std::size_t THIRD_COUNTS[CODON_SIZE] = {(64 + 2) / 3, (64 + 1) / 3, 64 / 3};
+
+///////////////////////////////////////////////////////////////////////////////
+inline unsigned lowestSetBit(Word w)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(w);
+#else
+  unsigned k = 0;
+  while ((w & 1) == 0) { w >>= 1; ++k; }
+  return k;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Even bits of x packed into the low half, with shifts that vectorize over
+// arrays of words
+inline Word evenBits(Word x)
+{
+  x &= EVEN_BITS;
+  x = (x | (x >> 1)) & 0x3333333333333333ULL;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+  return (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+}
+
+/******************************************************************************
+ * Extraction of the bits of a word at the set bits of a fixed mask, packed
+ * into the low bits. Without BMI2, it is the parallel suffix compress of
+ * Hacker's Delight, whose masks depend on 'selected' only and are computed
+ * once: bits are moved right by 1, 2, 4, ... 32 places in turn.
+ *****************************************************************************/
+struct BitExtraction
+{
+  Word selected;
+  Word moving[6];
+};
+
+constexpr BitExtraction makeBitExtraction(Word selected)
+{
+  BitExtraction extraction{selected, {}};
+  Word zeros = ~selected << 1;   // zeros to the right of each bit
+  for (unsigned i = 0; i < 6; ++i)
+  {
+    Word odd = zeros ^ (zeros << 1);
+    odd ^= odd << 2;
+    odd ^= odd << 4;
+    odd ^= odd << 8;
+    odd ^= odd << 16;
+    odd ^= odd << 32;
+    Word moving = odd & selected;
+    extraction.moving[i] = moving;
+    selected = (selected ^ moving) | (moving >> (1 << i));
+    zeros &= ~odd;
+  }
+  return extraction;
+}
+
+inline Word extractBits(Word x, const BitExtraction& extraction)
+{
+#if defined(__BMI2__)
+  return _pext_u64(x, extraction.selected);
+#else
+  x &= extraction.selected;
+  for (unsigned i = 0; i < 6; ++i)
+  {
+    Word t = x & extraction.moving[i];
+    x = (x ^ t) | (t >> (1 << i));
+  }
+  return x;
+#endif
+}
+
+// Extraction of the bits whose index is congruent to 0, 1 and 2 modulo
+// CODON_SIZE
+constexpr BitExtraction THIRD_BITS[CODON_SIZE] = {makeBitExtraction(everyThirdBit(0)),
+                                                  makeBitExtraction(everyThirdBit(1)),
+                                                  makeBitExtraction(everyThirdBit(2))};
+
+///////////////////////////////////////////////////////////////////////////////
+// Bases holding b, given the low and high bits of 64 bases
+inline Word basesEqual(Word low, Word high, Base b)
+{
+  uint8_t v = static_cast<uint8_t>(b);
+  return (v & 1 ? low : ~low) & (v & 2 ? high : ~high);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bases where one of the codons starts, given the low and high bits of the
+// bases shifted by 0, 1 and 2
+template<std::size_t N>
+inline Word matchCodons(const Word* low, const Word* high,
+                        const std::array<Codon, N>& codons)
+{
+  Word result = 0;
+  for (const Codon& codon : codons)
+  {
+    result |= basesEqual(low[0], high[0], codon[0])
+              & basesEqual(low[1], high[1], codon[1])
+              & basesEqual(low[2], high[2], codon[2]);
+  }
+  return result;
+}
+
+/******************************************************************************
+ * Computes the low and high bits of the bases of the PackedBases words
+ * [first, last), 'first' being even, into 'low' and 'high': bit i of
+ * element k is that of base 64*k + i of the range. Bases past the end
+ * count as G, which neither starts nor stops a gene.
+ *****************************************************************************/
+inline void basePlanes(const PackedBases& bases,
+                       std::size_t first,
+                       std::size_t last,
+                       Word* low,
+                       Word* high)
+{
+  std::size_t wordCount = bases.wordCount();
+  for (std::size_t w = first; w < last; )
+  {
+    std::size_t k = (w - first) / 2;
+    if (w >= wordCount)
+    {
+      std::fill(low + k, low + (last - first + 1) / 2, 0);
+      std::fill(high + k, high + (last - first + 1) / 2, 0);
+      return;
+    }
+
+    // go over runs of words stored contiguously, a pair at a time
+    const Word* words = bases.wordData(w);
+    std::size_t run = std::min(bases.contiguousWords(w), last - w);
+    std::size_t pairs = (run + 1) / 2;
+    for (std::size_t j = 0; j < run / 2; ++j)
+    {
+      Word x = words[2 * j];
+      Word y = words[2 * j + 1];
+      low[k + j] = evenBits(x) | evenBits(y) << 32;
+      high[k + j] = evenBits(x >> 1) | evenBits(y >> 1) << 32;
+    }
+    if (run % 2 == 1)
+    {
+      // the last word of the bases, or of the range
+      Word x = words[run - 1];
+      low[k + run / 2] = evenBits(x);
+      high[k + run / 2] = evenBits(x >> 1);
+    }
+    w += 2 * pairs;
+  }
+}
+
+/******************************************************************************
+ * Computes the start and stop codon masks of 'count' words of 64 bases
+ * into startMasks and stopMasks, from their base planes and those of the
+ * next word (count + 1 elements of 'low' and 'high').
+ *****************************************************************************/
+inline void codonMasks(const Word* low,
+                       const Word* high,
+                       std::size_t count,
+                       Word* startMasks,
+                       Word* stopMasks)
+{
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    Word l[CODON_SIZE] = {low[k],
+                          (low[k] >> 1) | (low[k + 1] << 63),
+                          (low[k] >> 2) | (low[k + 1] << 62)};
+    Word h[CODON_SIZE] = {high[k],
+                          (high[k] >> 1) | (high[k + 1] << 63),
+                          (high[k] >> 2) | (high[k + 1] << 62)};
+    startMasks[k] = matchCodons(l, h, START_CODONS);
+    stopMasks[k] = matchCodons(l, h, STOP_CODONS);
+  }
+}
+
+/******************************************************************************
+ * Finds start codons and in-frame stop codons of a chromosome. The codon
+ * masks are computed lazily for one block of BLOCK_BASES bases at a time,
+ * with a bit per candidate: one per base for start codons, and one per
+ * codon of each reading frame for stop codons. A word then covers 64
+ * candidates, so that most searches end in the first word they look at.
+ * Searches are expected to move forward; going back recomputes the block.
+ * Only codons starting before limit() are considered, which matches the
+ * bound historically used by decodeGenes.
+ *****************************************************************************/
+struct CodonScanner
+{
+  // PackedBases words of a block: an even number, for basePlanes, holding
+  // a multiple of 64 * CODON_SIZE bases, so that every frame fills whole
+  // words of stop bits
+  static const std::size_t WORDS_PER_BLOCK = 192;
+  static const std::size_t BLOCK_BASES = WORDS_PER_BLOCK * PackedBases::BASES_PER_WORD;
+  static const std::size_t START_WORDS = BLOCK_BASES / 64;
+  static const std::size_t STOP_WORDS = START_WORDS / CODON_SIZE;
+
+  CodonScanner(const PackedBases& bases)
+    : bases_(bases),
+      limit_(bases.size() > CODON_SIZE ? bases.size() - CODON_SIZE : 0),
+      blockBegin_(std::numeric_limits<std::size_t>::max() - BLOCK_BASES)
+  {
+    // do nothing
+  }
+
+  std::size_t limit() const { return limit_; }
+
+  // First start codon at or after 'from', or limit() if there is none
+  std::size_t nextStart(std::size_t from)
+  {
+    for (; from < limit_; from = blockBegin_ + BLOCK_BASES)
+    {
+      std::size_t local = select(from);
+      std::size_t k = local / 64;
+      Word m = startBits_[k] & (~Word(0) << (local % 64));
+      Word n = startBits_[k + 1];
+      if ((m | n) != 0)
+      {
+        std::size_t bit = m != 0 ? lowestSetBit(m) : 64 + lowestSetBit(n);
+        return std::min(blockBegin_ + 64 * k + bit, limit_);
+      }
+      for (k += 2; k < START_WORDS; ++k)
+      {
+        if (startBits_[k] != 0)
+        {
+          return std::min(blockBegin_ + 64 * k + lowestSetBit(startBits_[k]), limit_);
+        }
+      }
+    }
+    return limit_;
+  }
+
+  // First stop codon at or after 'from' in the same reading frame as
+  // position 'frameOf', or limit() if there is none
+  std::size_t nextStop(std::size_t from, std::size_t frameOf)
+  {
+    // blocks start in frame 0, so codon c of a frame is at base 3 * c + frame
+    std::size_t frame = frameOf % CODON_SIZE;
+    const Word* bits = stopBits_[frame];
+    for (; from < limit_; from = blockBegin_ + BLOCK_BASES)
+    {
+      std::size_t local = select(from);
+      std::size_t codon = local / CODON_SIZE;
+      codon += local - CODON_SIZE * codon > frame ? 1 : 0;
+      std::size_t k = codon / 64;
+      if (k == STOP_WORDS) continue;
+      Word m = bits[k] & (~Word(0) << (codon % 64));
+      while (m == 0 && ++k < STOP_WORDS) m = bits[k];
+      if (m != 0)
+      {
+        std::size_t pos = blockBegin_ + CODON_SIZE * (64 * k + lowestSetBit(m)) + frame;
+        return std::min(pos, limit_);
+      }
+    }
+    return limit_;
+  }
+
+  private:
+
+    // Offset of pos in its block, computing the block if needed (no
+    // position is in the initial one)
+    std::size_t select(std::size_t pos)
+    {
+      if (pos - blockBegin_ >= BLOCK_BASES) compute(pos - pos % BLOCK_BASES);
+      return pos - blockBegin_;
+    }
+
+    void compute(std::size_t begin)
+    {
+      blockBegin_ = begin;
+      std::size_t first = begin / PackedBases::BASES_PER_WORD;
+      Word low[START_WORDS + 1];
+      Word high[START_WORDS + 1];
+      Word stops[START_WORDS];
+      basePlanes(bases_, first, first + WORDS_PER_BLOCK + 2, low, high);
+      codonMasks(low, high, START_WORDS, startBits_, stops);
+      startBits_[START_WORDS] = 0;
+
+      // three words hold 64 codons of each frame, frame f being at the bits
+      // of residue f, f + 2 and f + 1 of the successive words
+      for (std::size_t k = 0; k < STOP_WORDS; ++k)
+      {
+        const Word* bits = stops + CODON_SIZE * k;
+        for (std::size_t frame = 0; frame < CODON_SIZE; ++frame)
+        {
+          std::size_t r0 = frame;
+          std::size_t r1 = (frame + 2) % CODON_SIZE;
+          std::size_t r2 = (frame + 1) % CODON_SIZE;
+          stopBits_[frame][k] = extractBits(bits[0], THIRD_BITS[r0])
+                                | extractBits(bits[1], THIRD_BITS[r1]) << THIRD_COUNTS[r0]
+                                | extractBits(bits[2], THIRD_BITS[r2])
+                                  << (THIRD_COUNTS[r0] + THIRD_COUNTS[r1]);
+        }
+      }
+    }
+
+    const PackedBases& bases_;
+    const std::size_t limit_;
+    std::size_t blockBegin_;
+    Word startBits_[START_WORDS + 1];
+    Word stopBits_[CODON_SIZE][STOP_WORDS];
+};
+
+}}}
+
+#endif
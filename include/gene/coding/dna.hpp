@@ -9,8 +9,14 @@
 #include <array>
 #include <memory>
 #include <random>
+#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <initializer_list>
 
 #include "gene/policies.hpp"
+#include "gene/statistics.hpp"
 
 namespace gene { namespace coding { namespace dna {
 
@@ -29,14 +35,14 @@ typedef std::array<Base, CODON_SIZE> Codon;
 /******************************************************************************
  * Codons marking the start sequence of a gene.
  *****************************************************************************/
-const std::vector<Codon> START_CODONS = {Codon{{ Base::A, Base::T, Base::G }}};
+constexpr std::array<Codon, 1> START_CODONS = {{Codon{{ Base::A, Base::T, Base::G }}}};
 
 /******************************************************************************
  * Codons marking the stop sequence of a gene.
  *****************************************************************************/
-const std::vector<Codon> STOP_CODONS = {Codon{{ Base::T, Base::A, Base::A }},
-                                        Codon{{ Base::T, Base::A, Base::G }},
-                                        Codon{{ Base::T, Base::G, Base::A }}};
+constexpr std::array<Codon, 3> STOP_CODONS = {{Codon{{ Base::T, Base::A, Base::A }},
+                                               Codon{{ Base::T, Base::A, Base::G }},
+                                               Codon{{ Base::T, Base::G, Base::A }}}};
 
 /******************************************************************************
  * 
@@ -44,12 +50,376 @@ const std::vector<Codon> STOP_CODONS = {Codon{{ Base::T, Base::A, Base::A }},
 typedef uint8_t Aminoacid; // from 0 to 63 (i.e. 4^3 - 1)
 typedef std::vector<Aminoacid> DecodedGene;
 
+/******************************************************************************
+ * Sequence of bases packed at 2 bits per base, i.e. 32 bases per 64-bit word.
+ * Base k lives in bits [2*(k%32), 2*(k%32)+2) of word k/32. The bits past
+ * the last base are always zero, so whole words can be compared and copied.
+ *
+ * Words are grouped in reference counted chunks of CHUNK_WORDS words that
+ * are shared among copies and copied on write, so copying a sequence or
+ * appending chunk-aligned runs of another one only copies pointers.
+ * Sequences sharing chunks must not be modified from different threads.
+ *****************************************************************************/
+struct PackedBases
+{
+  typedef uint64_t Word;
+  static const std::size_t BASES_PER_WORD = 32;
+  static const std::size_t BITS_PER_BASE = 2;
+  static const std::size_t CHUNK_WORDS = 64;
+  static const std::size_t BASES_PER_CHUNK = CHUNK_WORDS * BASES_PER_WORD;
+
+  /****************************************************************************
+   * Proxy returned by the non-const operator[].
+   ***************************************************************************/
+  struct reference
+  {
+    reference(PackedBases& bases, std::size_t pos) : bases_(bases), pos_(pos) { }
+    operator Base() const { return bases_.get(pos_); }
+    reference& operator=(Base b) { bases_.set(pos_, b); return *this; }
+    reference& operator=(const reference& r) { return *this = Base(r); }
+
+    private:
+      PackedBases& bases_;
+      std::size_t pos_;
+  };
+
+  /****************************************************************************
+   * Random access iterator over the (read only) bases.
+   ***************************************************************************/
+  struct const_iterator
+  {
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Base value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Base* pointer;
+    typedef Base reference;
+
+    const_iterator() : bases_(nullptr), pos_(0) { }
+    const_iterator(const PackedBases* bases, std::size_t pos)
+      : bases_(bases), pos_(pos) { }
+
+    Base operator*() const { return bases_->get(pos_); }
+    Base operator[](difference_type n) const { return bases_->get(pos_ + n); }
+    std::size_t position() const { return pos_; }
+
+    const_iterator& operator++() { ++pos_; return *this; }
+    const_iterator& operator--() { --pos_; return *this; }
+    const_iterator operator++(int) { const_iterator r(*this); ++pos_; return r; }
+    const_iterator operator--(int) { const_iterator r(*this); --pos_; return r; }
+    const_iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    const_iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(bases_, pos_ + n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(bases_, pos_ - n); }
+    difference_type operator-(const const_iterator& o) const { return difference_type(pos_) - difference_type(o.pos_); }
+
+    bool operator==(const const_iterator& o) const { return pos_ == o.pos_; }
+    bool operator!=(const const_iterator& o) const { return pos_ != o.pos_; }
+    bool operator<(const const_iterator& o) const { return pos_ < o.pos_; }
+    bool operator>(const const_iterator& o) const { return pos_ > o.pos_; }
+    bool operator<=(const const_iterator& o) const { return pos_ <= o.pos_; }
+    bool operator>=(const const_iterator& o) const { return pos_ >= o.pos_; }
+
+    private:
+      const PackedBases* bases_;
+      std::size_t pos_;
+  };
+
+  struct Chunk
+  {
+    Word words[CHUNK_WORDS];
+  };
+
+  PackedBases() : size_(0) { }
+
+  PackedBases(const std::vector<Base>& bases);
+
+  // Sequence of 'count' bases stored in the given chunks, which may be
+  // shared with other sequences or point into a mapped file. The words and
+  // bits past the last base must be zero.
+  PackedBases(std::vector<std::shared_ptr<Chunk>> chunks, std::size_t count);
+
+  PackedBases(std::initializer_list<Base> bases);
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Number of words holding the bases and read access to them
+  std::size_t wordCount() const { return wordsFor(size_); }
+
+  Word word(std::size_t w) const
+  {
+    return chunks_[w / CHUNK_WORDS]->words[w % CHUNK_WORDS];
+  }
+
+  // Pointer to word w, valid for contiguousWords(w) words
+  const Word* wordData(std::size_t w) const
+  {
+    return chunks_[w / CHUNK_WORDS]->words + w % CHUNK_WORDS;
+  }
+
+  std::size_t contiguousWords(std::size_t w) const
+  {
+    return std::min(CHUNK_WORDS - w % CHUNK_WORDS, wordCount() - w);
+  }
+
+  Base get(std::size_t pos) const
+  {
+    return static_cast<Base>((word(pos / BASES_PER_WORD)
+                              >> (BITS_PER_BASE * (pos % BASES_PER_WORD))) & 3);
+  }
+
+  void set(std::size_t pos, Base b)
+  {
+    Word& w = mutableWord(pos / BASES_PER_WORD);
+    std::size_t shift = BITS_PER_BASE * (pos % BASES_PER_WORD);
+    w = (w & ~(Word(3) << shift)) | (Word(static_cast<uint8_t>(b)) << shift);
+  }
+
+  Base operator[](std::size_t pos) const { return get(pos); }
+  reference operator[](std::size_t pos) { return reference(*this, pos); }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  void reserve(std::size_t count)
+  {
+    chunks_.reserve((count + BASES_PER_CHUNK - 1) / BASES_PER_CHUNK);
+  }
+
+  void clear() { chunks_.clear(); size_ = 0; }
+
+  // Grows with Base::G (all bits zero) or drops the trailing bases
+  void resize(std::size_t count);
+
+  void push_back(Base b);
+
+  // Appends the bases [from, to) of other. Chunks that line up in both
+  // sequences are shared, the rest is copied a word at a time.
+  void append(const PackedBases& other, std::size_t from, std::size_t to);
+
+  // 64 bits starting at the given bit offset; zero past the end
+  Word bitsAt(std::size_t bit) const;
+
+  // Chunks holding the words, CHUNK_WORDS words each
+  std::size_t chunkCount() const { return chunks_.size(); }
+  const std::shared_ptr<Chunk>& chunk(std::size_t k) const { return chunks_[k]; }
+
+  // Number of chunks shared with other sequences
+  std::size_t sharedChunks() const;
+
+  bool operator==(const PackedBases& o) const;
+
+  bool operator!=(const PackedBases& o) const { return !(*this == o); }
+
+  private:
+
+    static std::size_t wordsFor(std::size_t count)
+    {
+      return (count + BASES_PER_WORD - 1) / BASES_PER_WORD;
+    }
+
+    // Word w, copying its chunk first if it is shared
+    Word& mutableWord(std::size_t w)
+    {
+      std::shared_ptr<Chunk>& chunk = chunks_[w / CHUNK_WORDS];
+      if (chunk.use_count() > 1) chunk = std::make_shared<Chunk>(*chunk);
+      return chunk->words[w % CHUNK_WORDS];
+    }
+
+    // Makes room for 'count' bases, adding zeroed chunks
+    void grow(std::size_t count);
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    std::size_t size_;
+};
+
+/******************************************************************************
+ * Read only view of the aminoacids of a gene in a GeneTable.
+ *****************************************************************************/
+struct GeneView
+{
+  typedef const Aminoacid* const_iterator;
+
+  GeneView(const Aminoacid* data, std::size_t size) : data_(data), size_(size) { }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const Aminoacid* data() const { return data_; }
+
+  Aminoacid operator[](std::size_t k) const { return data_[k]; }
+  Aminoacid front() const { return data_[0]; }
+  Aminoacid back() const { return data_[size_ - 1]; }
+
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  bool operator==(const GeneView& o) const
+  {
+    return size_ == o.size_ && std::equal(data_, data_ + size_, o.data_);
+  }
+
+  bool operator!=(const GeneView& o) const { return !(*this == o); }
+
+  private:
+    const Aminoacid* data_;
+    std::size_t size_;
+};
+
+/******************************************************************************
+ * Genes of a chromosome in two flat arrays: the aminoacids of all of them,
+ * one gene after the other, and the offset of each gene in them followed
+ * by the end of the last one. Genes are accessed as GeneViews, which are
+ * valid until the table is modified.
+ * clear() keeps the storage, so a table that is reused stops allocating
+ * once it has grown to the size needed.
+ *****************************************************************************/
+struct GeneTable
+{
+  /****************************************************************************
+   * Random access iterator over the genes.
+   ***************************************************************************/
+  struct const_iterator
+  {
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef GeneView value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const GeneView* pointer;
+    typedef GeneView reference;
+
+    const_iterator() : table_(nullptr), k_(0) { }
+    const_iterator(const GeneTable* table, std::size_t k) : table_(table), k_(k) { }
+
+    GeneView operator*() const { return (*table_)[k_]; }
+    GeneView operator[](difference_type n) const { return (*table_)[k_ + n]; }
+
+    const_iterator& operator++() { ++k_; return *this; }
+    const_iterator& operator--() { --k_; return *this; }
+    const_iterator operator++(int) { const_iterator r(*this); ++k_; return r; }
+    const_iterator operator--(int) { const_iterator r(*this); --k_; return r; }
+    const_iterator& operator+=(difference_type n) { k_ += n; return *this; }
+    const_iterator& operator-=(difference_type n) { k_ -= n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(table_, k_ + n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(table_, k_ - n); }
+    difference_type operator-(const const_iterator& o) const { return difference_type(k_) - difference_type(o.k_); }
+
+    bool operator==(const const_iterator& o) const { return k_ == o.k_; }
+    bool operator!=(const const_iterator& o) const { return k_ != o.k_; }
+    bool operator<(const const_iterator& o) const { return k_ < o.k_; }
+    bool operator>(const const_iterator& o) const { return k_ > o.k_; }
+    bool operator<=(const const_iterator& o) const { return k_ <= o.k_; }
+    bool operator>=(const const_iterator& o) const { return k_ >= o.k_; }
+
+    private:
+      const GeneTable* table_;
+      std::size_t k_;
+  };
+
+  GeneTable() : offsets_(1, 0) { }
+
+  std::size_t size() const { return offsets_.size() - 1; }
+  bool empty() const { return offsets_.size() == 1; }
+
+  GeneView operator[](std::size_t k) const
+  {
+    return GeneView(aminoacids_.data() + offsets_[k], offsets_[k + 1] - offsets_[k]);
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  void clear()
+  {
+    aminoacids_.clear();
+    offsets_.resize(1);
+  }
+
+  // Adds a gene of 'length' aminoacids and returns where to write them
+  Aminoacid* addGene(std::size_t length)
+  {
+    std::size_t offset = aminoacids_.size();
+    aminoacids_.resize(offset + length);
+    offsets_.push_back(offset + length);
+    return aminoacids_.data() + offset;
+  }
+
+  // Adds genes of the given lengths and returns where to write their
+  // aminoacids, one gene after the other
+  Aminoacid* addGenes(const std::vector<std::size_t>& lengths)
+  {
+    std::size_t offset = aminoacids_.size();
+    std::size_t end = offset;
+    offsets_.reserve(offsets_.size() + lengths.size());
+    for (std::size_t length : lengths)
+    {
+      end += length;
+      offsets_.push_back(end);
+    }
+    aminoacids_.resize(end);
+    return aminoacids_.data() + offset;
+  }
+
+  // Appends the genes [first, last) of another table
+  void append(const GeneTable& other, std::size_t first, std::size_t last);
+
+  // Replaces the genes [first, last) with those of another table
+  void replace(std::size_t first, std::size_t last, const GeneTable& genes);
+
+  const std::vector<Aminoacid>& aminoacids() const { return aminoacids_; }
+  const std::vector<std::size_t>& offsets() const { return offsets_; }
+
+  bool operator==(const GeneTable& o) const
+  {
+    return aminoacids_ == o.aminoacids_ && offsets_ == o.offsets_;
+  }
+
+  bool operator!=(const GeneTable& o) const { return !(*this == o); }
+
+  private:
+    std::vector<Aminoacid> aminoacids_;
+    std::vector<std::size_t> offsets_;
+};
+
+/******************************************************************************
+ * Genes decoded from a chromosome, kept so that they can be updated
+ * incrementally. starts[k] and stops[k] are the positions of the start and
+ * stop codons of genes[k].
+ *****************************************************************************/
+struct DecodeCache
+{
+  GeneTable genes;
+  std::vector<std::size_t> starts;
+  std::vector<std::size_t> stops;
+};
+
 /******************************************************************************
  * PoD representing a chromosome.
+ * The genes decoded by decodeGenes are cached in it and shared among its
+ * copies. While 'dirty', the bases in [dirtyBegin, dirtyEnd) may have
+ * changed since the genes were decoded. Code that modifies the bases must
+ * report the modified positions through markDirty, or call clearDecoded if
+ * the chromosome changes wholesale.
  *****************************************************************************/
 struct Chromosome
 {
-  std::vector<Base> bases;
+  PackedBases bases;
+  mutable std::shared_ptr<DecodeCache> decoded;
+  mutable bool dirty = false;
+  mutable std::size_t dirtyBegin = 0;
+  mutable std::size_t dirtyEnd = 0;
+
+  void markDirty(std::size_t begin, std::size_t end)
+  {
+    if (!decoded || begin >= end) return;
+    dirtyBegin = dirty ? std::min(dirtyBegin, begin) : begin;
+    dirtyEnd = dirty ? std::max(dirtyEnd, end) : end;
+    dirty = true;
+  }
+
+  void clearDecoded()
+  {
+    decoded.reset();
+    dirty = false;
+  }
 
   //FIXME: this should not be necessary but a seemingly bug in GCC makes it so.
   //TODO: check in future versions of GCC.
@@ -57,7 +427,11 @@ struct Chromosome
 
   Chromosome(Chromosome&& other) = default;
 
-  Chromosome(std::vector<Base> b) : bases{std::move(b)} { }
+  Chromosome(const std::vector<Base>& b) : bases(b) { }
+
+  Chromosome(PackedBases b) : bases(std::move(b)) { }
+
+  Chromosome& operator=(const Chromosome& rhs) = default;
 
   //FIXME: this should not be necessary but a seemingly bug in GCC makes it so.
   //TODO: check in future versions of GCC.
@@ -66,55 +440,188 @@ struct Chromosome
 
 /******************************************************************************
  * PoD representing the genotype of an individual.
- * Immutable sequence of chromosomes.
+ * Sequence of chromosomes. Mutation strategies modify it in place.
  *****************************************************************************/
 struct Genotype
 {
-  const std::vector<Chromosome> chromosomes;
+  std::vector<Chromosome> chromosomes;
+
+  Genotype(const Genotype& g) = default;
 
   Genotype(Genotype&& g) = default;
 
   Genotype(std::vector<Chromosome> c) : chromosomes(std::move(c)) { }
 
-  Genotype& operator=(Genotype&& rhs) = delete;
+  Genotype& operator=(const Genotype& rhs) = default;
+
+  Genotype& operator=(Genotype&& rhs) = default;
 };
 
 /****************************************************************************
  * Implementation of Combination that performs N point crossover.
+ * Each parent contributes a gamete made by meiosis: its chromosomes are
+ * taken as homologous pairs (0, 1), (2, 3)... and each pair is recombined,
+ * in random order, into one chromosome. The child has the gametes of both
+ * parents, so it has as many chromosomes as each of them.
+ * Here a chromosome takes its bases alternately from each homolog,
+ * switching at numberOfPoints random positions, and has the length of the
+ * homolog it ends with. Runs of bases are copied a word at a time, and
+ * whole chunks are shared with the homologs instead.
+ ***************************************************************************/
+template<typename Phenotype>
+struct NPointCrossover : public CombinationStrategy<Phenotype, Genotype>
+{
+  NPointCrossover(std::size_t numberOfPoints, uint32_t seed);
+
+  NPointCrossover(const NPointCrossover&) = delete;
+
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
+
+  private:
+    const std::size_t numberOfPoints_;
+    std::mt19937_64 random_;
+    std::vector<std::size_t> cuts_;
+};
+
+/****************************************************************************
+ * Implementation of Combination that performs one point crossover, see
+ * NPointCrossover.
  ***************************************************************************/
-struct SimpleCrossover : public CombinationStrategy<Genotype>
+template<typename Phenotype>
+struct SimpleCrossover : public NPointCrossover<Phenotype>
+{
+  SimpleCrossover(uint32_t seed) : NPointCrossover<Phenotype>(1, seed) { }
+};
+
+/****************************************************************************
+ * Implementation of Combination that performs uniform crossover, with the
+ * meiosis of NPointCrossover.
+ * Each base of a chromosome comes from either homolog with probability
+ * 1/2, up to the length of the shorter one; the rest come from the second
+ * homolog. The bases are mixed a word at a time with random masks, and the
+ * chunks past the shorter homolog are shared with the second one.
+ ***************************************************************************/
+template<typename Phenotype>
+struct UniformCrossover : public CombinationStrategy<Phenotype, Genotype>
+{
+  UniformCrossover(uint32_t seed);
+
+  UniformCrossover(const UniformCrossover&) = delete;
+
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
+
+  private: std::mt19937_64 random_;
+};
+
+/****************************************************************************
+ * Implementation of Combination that swaps a segment, with the meiosis of
+ * NPointCrossover.
+ * A chromosome is the first homolog with a random segment replaced by the
+ * same segment of the second one. The segment starts and ends at chunk
+ * boundaries (or at the end of both homologs, if they have the same
+ * length), so the child shares all its chunks with them and is made
+ * without copying bases. Homologs shorter than a chunk swap a segment of
+ * any bounds instead.
+ ***************************************************************************/
+template<typename Phenotype>
+struct SegmentSwapCrossover : public CombinationStrategy<Phenotype, Genotype>
 {
-  SimpleCrossover(uint32_t seed);
+  SegmentSwapCrossover(uint32_t seed);
 
-  SimpleCrossover(const SimpleCrossover&) = delete;
+  SegmentSwapCrossover(const SegmentSwapCrossover&) = delete;
 
-  Genotype combine(const Genotype&, const Genotype&) override;
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
 
-  private: std::mt19937 random_;
+  private: std::mt19937_64 random_;
 };
 
 /****************************************************************************
  * Implementation of MutationStrategy for DNA coded Genotypes.
+ * Each base is replaced by a random one with the given percentage of
+ * probability. Only the mutated bases are visited: the distance between
+ * consecutive mutations is drawn from a geometric distribution.
+ * The mutated region reports, for each chromosome, the span between the
+ * first and the last replaced base.
  ***************************************************************************/
 template<typename Phenotype>
 struct BaseMutation : MutationStrategy<Phenotype, Genotype>
 {
   BaseMutation(float percentageOfBasesToMutate, uint32_t seed);
 
-  std::pair<Phenotype, Genotype>
-          mutate(Phenotype,
-                 Genotype,
-                 const Codec<Phenotype, Genotype>&) override;
+  void mutateInPlace(std::pair<Phenotype, Genotype>&,
+                     const Codec<Phenotype, Genotype>&,
+                     MutatedRegion* region = nullptr) override;
   private:
     const float percentageOfBasesToMutate_;
     std::mt19937 random_;
-    std::uniform_real_distribution<> distribution_;
+    std::geometric_distribution<std::size_t> distance_;
 };
 
 /****************************************************************************
- * 
+ * Genes of a chromosome: sequences of aminoacids from a start codon to the
+ * next in-frame stop codon, both included.
+ * The result is cached in the chromosome. When only part of it is dirty,
+ * just the genes around the dirty range are decoded again. Decoding the
+ * same chromosome from several threads at once is not supported.
+ ***************************************************************************/
+const GeneTable& decodeGenes (const Chromosome& chromosome);
+
+/****************************************************************************
+ * Genes of a chromosome, decoded into a table provided by the caller
+ * instead of the cache (which is copied if it is up to date). Reusing the
+ * table, decoding does not allocate once it is large enough.
+ ***************************************************************************/
+void decodeGenes (const Chromosome& chromosome, GeneTable& genes);
+
+/****************************************************************************
+ * Diversity of the population in a single pass over the packed bases.
+ * The bases of each locus are counted with bit-sliced LocusCounters, which
+ * gives the exact mean Hamming distance between two individuals and the
+ * mean entropy of the loci (loci past the end of a chromosome of one of
+ * the individuals do not count). As chromosomes of different lengths are
+ * not aligned, the sets of k-mers of 'kmerSize' bases (at most 32) are
+ * compared too: a MinHash sketch of 'buckets' buckets (one permutation
+ * hashing) is made per individual, and the mean Jaccard distance is
+ * estimated over 'pairs' random pairs (all of them if there are fewer).
+ * A 'pairs' of 0 skips the k-mers.
  ***************************************************************************/
-std::vector<DecodedGene> decodeGenes (const Chromosome& chromosome);
+struct GenotypeDiversity : public DiversityEstimator<Genotype>
+{
+  GenotypeDiversity(std::size_t kmerSize = 16,
+                    std::size_t buckets = 64,
+                    std::size_t pairs = 1000,
+                    uint32_t seed = std::random_device{}());
+
+  void clear() override;
+  void add(const Genotype& genotype) override;
+  Diversity estimate() override;
+
+  private:
+
+    void sketch(const PackedBases& bases, uint64_t* signature) const;
+    double kmerDistance(std::size_t i, std::size_t j) const;
+
+    const std::size_t kmerSize_;
+    const std::size_t buckets_;
+    const std::size_t pairs_;
+    std::mt19937 generator_;
+
+    // counters of A, T and C per chromosome; G are the rest
+    std::vector<std::array<LocusCounter, 3>> counters_;
+    std::vector<std::vector<std::size_t>> lengths_;  // one per chromosome
+    std::vector<uint64_t> indicators_;               // scratch for add()
+    std::vector<uint64_t> signatures_;               // buckets_ per individual
+    std::size_t individuals_;
+};
 
 }}}
 
@@ -3,6 +3,11 @@
 // (see accompanying file COPYING)
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "gene/coding/codon_scan.hpp"
 
 namespace gene { namespace coding { namespace dna {
 
@@ -14,80 +19,519 @@ Base randomBase(std::mt19937& random)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-std::vector<Chromosome> meiosis (const Genotype& g, std::mt19937& random)
+inline PackedBases::PackedBases(const std::vector<Base>& bases)
+  : size_(0)
+{
+  reserve(bases.size());
+  for (Base b : bases) push_back(b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PackedBases::PackedBases(std::initializer_list<Base> bases)
+  : size_(0)
+{
+  reserve(bases.size());
+  for (Base b : bases) push_back(b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PackedBases::PackedBases(std::vector<std::shared_ptr<Chunk>> chunks,
+                                std::size_t count)
+  : chunks_(std::move(chunks)), size_(count)
+{
+  assert(chunks_.size() == (count + BASES_PER_CHUNK - 1) / BASES_PER_CHUNK);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PackedBases::grow(std::size_t count)
+{
+  while (chunks_.size() * BASES_PER_CHUNK < count)
+  {
+    chunks_.push_back(std::make_shared<Chunk>());
+  }
+  size_ = count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PackedBases::resize(std::size_t count)
+{
+  if (count >= size_)
+  {
+    grow(count);
+    return;
+  }
+
+  chunks_.resize((count + BASES_PER_CHUNK - 1) / BASES_PER_CHUNK);
+  size_ = count;
+
+  // clear the bits past the new end in the last chunk
+  std::size_t words = wordsFor(count);
+  if (words % CHUNK_WORDS != 0)
+  {
+    mutableWord(words - 1);
+    Chunk& chunk = *chunks_.back();
+    std::fill(chunk.words + words % CHUNK_WORDS, chunk.words + CHUNK_WORDS, 0);
+  }
+  std::size_t tail = count % BASES_PER_WORD;
+  if (tail != 0)
+  {
+    mutableWord(words - 1) &= (Word(1) << (BITS_PER_BASE * tail)) - 1;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PackedBases::push_back(Base b)
+{
+  grow(size_ + 1);
+  set(size_ - 1, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PackedBases::Word PackedBases::bitsAt(std::size_t bit) const
+{
+  std::size_t w = bit / 64;
+  std::size_t offset = bit % 64;
+  std::size_t count = wordCount();
+  if (w >= count) return 0;
+  Word result = word(w) >> offset;
+  if (offset != 0 && w + 1 < count)
+  {
+    result |= word(w + 1) << (64 - offset);
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PackedBases::append(const PackedBases& other,
+                                std::size_t from,
+                                std::size_t to)
+{
+  assert(from <= to && to <= other.size_);
+
+  while (from < to)
+  {
+    // share whole chunks at the same offset in both sequences
+    if (size_ % BASES_PER_CHUNK == 0
+        && from % BASES_PER_CHUNK == 0
+        && (to - from >= BASES_PER_CHUNK || to == other.size_))
+    {
+      std::size_t n = to - from < BASES_PER_CHUNK ? to - from : BASES_PER_CHUNK;
+      chunks_.push_back(other.chunks_[from / BASES_PER_CHUNK]);
+      size_ += n;
+      from += n;
+      continue;
+    }
+
+    // copy up to the next chunk boundary of the source
+    std::size_t n = std::min(to - from, BASES_PER_CHUNK - from % BASES_PER_CHUNK);
+    std::size_t srcBit = BITS_PER_BASE * from;
+    std::size_t dstBit = BITS_PER_BASE * size_;
+    std::size_t remaining = BITS_PER_BASE * n;
+    grow(size_ + n);
+
+    // unused bits are zero, so each 64-bit window can be OR-ed in place
+    while (remaining > 0)
+    {
+      std::size_t bits = std::min<std::size_t>(remaining, 64);
+      Word window = other.bitsAt(srcBit);
+      if (bits < 64) window &= (Word(1) << bits) - 1;
+
+      std::size_t w = dstBit / 64;
+      std::size_t offset = dstBit % 64;
+      mutableWord(w) |= window << offset;
+      if (offset != 0 && offset + bits > 64)
+      {
+        mutableWord(w + 1) |= window >> (64 - offset);
+      }
+
+      srcBit += bits;
+      dstBit += bits;
+      remaining -= bits;
+    }
+    from += n;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t PackedBases::sharedChunks() const
+{
+  return std::count_if(chunks_.begin(), chunks_.end(),
+                       [](const std::shared_ptr<Chunk>& c)
+                       { return c.use_count() > 1; });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline bool PackedBases::operator==(const PackedBases& o) const
+{
+  if (size_ != o.size_) return false;
+  for (std::size_t k = 0; k < chunks_.size(); ++k)
+  {
+    if (chunks_[k] == o.chunks_[k]) continue;
+    if (!std::equal(chunks_[k]->words,
+                    chunks_[k]->words + CHUNK_WORDS,
+                    o.chunks_[k]->words)) return false;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void GeneTable::append(const GeneTable& other, std::size_t first, std::size_t last)
+{
+  std::size_t from = other.offsets_[first];
+  std::size_t base = aminoacids_.size();
+  aminoacids_.insert(aminoacids_.end(),
+                     other.aminoacids_.begin() + from,
+                     other.aminoacids_.begin() + other.offsets_[last]);
+  for (std::size_t k = first + 1; k <= last; ++k)
+  {
+    offsets_.push_back(base + other.offsets_[k] - from);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void GeneTable::replace(std::size_t first, std::size_t last, const GeneTable& genes)
+{
+  std::size_t begin = offsets_[first];
+  std::size_t end = offsets_[last];
+  std::size_t added = genes.aminoacids_.size();
+
+  // make room for the aminoacids, or drop the extra ones, then copy them
+  if (added > end - begin)
+  {
+    aminoacids_.insert(aminoacids_.begin() + end, added - (end - begin), 0);
+  }
+  else
+  {
+    aminoacids_.erase(aminoacids_.begin() + begin + added, aminoacids_.begin() + end);
+  }
+  std::copy(genes.aminoacids_.begin(), genes.aminoacids_.end(), aminoacids_.begin() + begin);
+
+  // the same with the offsets, then move those of the genes after them
+  std::size_t count = genes.size();
+  if (count > last - first)
+  {
+    offsets_.insert(offsets_.begin() + last + 1, count - (last - first), 0);
+  }
+  else
+  {
+    offsets_.erase(offsets_.begin() + first + 1 + count, offsets_.begin() + last + 1);
+  }
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    offsets_[first + 1 + k] = begin + genes.offsets_[k + 1];
+  }
+  if (added != end - begin)
+  {
+    for (std::size_t k = first + 1 + count; k < offsets_.size(); ++k)
+    {
+      offsets_[k] = offsets_[k] - end + begin + added;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sets the decoded genes of a child made of the bases of 'head' before
+// 'begin', of 'tail' from 'end' on, and of either in between: the genes of
+// each lying entirely on its side, with [begin, end) marked as dirty.
+inline void spliceDecoded(const Chromosome& head,
+                          const Chromosome& tail,
+                          std::size_t begin,
+                          std::size_t end,
+                          Chromosome& child)
+{
+  child.clearDecoded();
+  if (!head.decoded && !tail.decoded) return;
+
+  DecodeCache result;
+  std::size_t length = child.bases.size();
+
+  // genes are sorted by position, so those kept are a prefix of the head
+  // and a suffix of the tail
+  if (head.decoded)
+  {
+    const DecodeCache& genes = *head.decoded;
+    std::size_t count = 0;
+    for (; count < genes.genes.size(); ++count)
+    {
+      std::size_t stop = genes.stops[count] + CODON_SIZE;
+      if (stop > begin || stop >= length) break;
+      if (head.dirty && stop > head.dirtyBegin) break;
+    }
+    result.genes.append(genes.genes, 0, count);
+    result.starts.assign(genes.starts.begin(), genes.starts.begin() + count);
+    result.stops.assign(genes.stops.begin(), genes.stops.begin() + count);
+  }
+
+  if (tail.decoded)
+  {
+    const DecodeCache& genes = *tail.decoded;
+    std::size_t first = 0;
+    for (; first < genes.genes.size(); ++first)
+    {
+      if (genes.starts[first] < end) continue;
+      if (tail.dirty && genes.starts[first] < tail.dirtyEnd) continue;
+      break;
+    }
+    result.genes.append(genes.genes, first, genes.genes.size());
+    result.starts.insert(result.starts.end(), genes.starts.begin() + first, genes.starts.end());
+    result.stops.insert(result.stops.end(), genes.stops.begin() + first, genes.stops.end());
+  }
+
+  child.decoded = std::make_shared<DecodeCache>(std::move(result));
+  child.dirty = true;
+  child.dirtyBegin = begin;
+  child.dirtyEnd = end;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Gamete of a genotype: each pair of homologous chromosomes (2k, 2k+1),
+// taken in random order, recombined into one chromosome
+template<typename Random, typename Recombine>
+std::vector<Chromosome> meiosis (const Genotype& g, Random& random, Recombine recombine)
 {
   std::vector<Chromosome> result;
   std::size_t count = g.chromosomes.size() / 2;
+  result.reserve(count);
 
   for (std::size_t k = 0; k < count; ++k)
   {
     std::uniform_int_distribution<std::size_t> order(0, 1);
-    bool b = order(random) == 1;
+    std::size_t first = order(random);
 
-    const Chromosome& c1 = g.chromosomes[k * (b? 1:2)];
-    const Chromosome& c2 = g.chromosomes[k * (b? 2:1)];
+    const Chromosome& c1 = g.chromosomes[2 * k + first];
+    const Chromosome& c2 = g.chromosomes[2 * k + 1 - first];
+    result.push_back(recombine(c1, c2));
+  }
+  return result;
+}
 
-    std::size_t chromosomeSize = std::min(c1.bases.size(), c2.bases.size());
-    std::uniform_int_distribution<std::size_t> dist(0, chromosomeSize);
-    std::size_t whereToCut = dist(random);
+///////////////////////////////////////////////////////////////////////////////
+// Child made of the gametes of both parents
+template<typename Phenotype, typename Random, typename Recombine>
+std::pair<Phenotype, Genotype> fertilize (const std::pair<Phenotype, Genotype>& i1,
+                                          const std::pair<Phenotype, Genotype>& i2,
+                                          const Codec<Phenotype, Genotype>& codec,
+                                          Random& random,
+                                          Recombine recombine)
+{
+  std::vector<Chromosome> m1 = meiosis(i1.second, random, recombine);
+  std::vector<Chromosome> m2 = meiosis(i2.second, random, recombine);
 
-    std::vector<Base> mixed;
-    mixed.insert(mixed.end(), c1.bases.begin(), c1.bases.begin() + whereToCut);
-    mixed.insert(mixed.end(), c2.bases.begin() + whereToCut, c2.bases.end());
+  m1.insert(m1.end(),
+            make_move_iterator(m2.begin()),
+            make_move_iterator(m2.end()));
 
-    Chromosome c{std::move(mixed)};
-    result.push_back(std::move(c));
+  Genotype combinedGenotype{std::move(m1)};
+  Phenotype combinedPhenotype = codec.decode(combinedGenotype);
+  return std::make_pair(std::move(combinedPhenotype), std::move(combinedGenotype));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Chromosome taking its bases alternately from c1 and c2, switching at the
+// sorted cuts, none past the end of either
+inline Chromosome recombineAt (const Chromosome& c1,
+                               const Chromosome& c2,
+                               const std::vector<std::size_t>& cuts)
+{
+  if (cuts.empty()) return c1;
+
+  const Chromosome* homologs[2] = {&c1, &c2};
+  const Chromosome& tail = *homologs[cuts.size() % 2];
+
+  PackedBases mixed;
+  mixed.reserve(tail.bases.size());
+  std::size_t from = 0;
+  for (std::size_t k = 0; k < cuts.size(); ++k)
+  {
+    mixed.append(homologs[k % 2]->bases, from, cuts[k]);
+    from = cuts[k];
   }
-  return std::move(result);
+  mixed.append(tail.bases, from, tail.bases.size());
+
+  Chromosome child{std::move(mixed)};
+  spliceDecoded(c1, tail, cuts.front(), cuts.back(), child);
+  return child;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+NPointCrossover<Phenotype>::NPointCrossover(std::size_t numberOfPoints, uint32_t seed)
+  : numberOfPoints_(numberOfPoints), random_(seed), cuts_(numberOfPoints)
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+std::pair<Phenotype, Genotype>
+NPointCrossover<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                    const std::pair<Phenotype, Genotype>& i2,
+                                    const Codec<Phenotype, Genotype>& codec)
+{
+  return fertilize(i1, i2, codec, random_, [this](const Chromosome& c1, const Chromosome& c2)
+  {
+    std::size_t length = std::min(c1.bases.size(), c2.bases.size());
+    std::uniform_int_distribution<std::size_t> position(0, length);
+    for (std::size_t& cut : cuts_) cut = position(random_);
+    std::sort(cuts_.begin(), cuts_.end());
+    return recombineAt(c1, c2, cuts_);
+  });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-SimpleCrossover::SimpleCrossover(uint32_t seed)
+template<typename Phenotype>
+UniformCrossover<Phenotype>::UniformCrossover(uint32_t seed)
   : random_(seed)
 {
   // do nothing
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-Genotype SimpleCrossover::combine(const Genotype& g1,
-                                  const Genotype& g2)
+template<typename Phenotype>
+std::pair<Phenotype, Genotype>
+UniformCrossover<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                     const std::pair<Phenotype, Genotype>& i2,
+                                     const Codec<Phenotype, Genotype>& codec)
 {
-  std::vector<Chromosome> m1 = meiosis(g1, random_);
-  std::vector<Chromosome> m2 = meiosis(g2, random_);
+  return fertilize(i1, i2, codec, random_, [this](const Chromosome& c1, const Chromosome& c2)
+  {
+    typedef PackedBases::Word Word;
+    typedef PackedBases::Chunk Chunk;
+    const std::size_t CHUNK_WORDS = PackedBases::CHUNK_WORDS;
 
-  m1.insert(m1.end(),
-            make_move_iterator(m2.begin()),
-            make_move_iterator(m2.end()));
+    const PackedBases& b1 = c1.bases;
+    const PackedBases& b2 = c2.bases;
+    std::size_t length = std::min(b1.size(), b2.size());
+    std::size_t words = (length + PackedBases::BASES_PER_WORD - 1) / PackedBases::BASES_PER_WORD;
+    std::size_t tail = length % PackedBases::BASES_PER_WORD;
 
-  Genotype combinedGenotype{std::move(m1)};
-  return std::move(combinedGenotype);
+    // the masks come from a splitmix64 sequence seeded from random_, much
+    // cheaper per word than the Mersenne Twister
+    uint64_t state = random_();
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    chunks.reserve(b2.chunkCount());
+    for (std::size_t k = 0; k < b2.chunkCount(); ++k)
+    {
+      std::size_t first = k * CHUNK_WORDS;
+      if (first >= words)
+      {
+        chunks.push_back(b2.chunk(k));
+        continue;
+      }
+
+      const Word* w1 = b1.chunk(k)->words;
+      const Word* w2 = b2.chunk(k)->words;
+      std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+      std::size_t mixed = words - first < CHUNK_WORDS ? words - first : CHUNK_WORDS;
+      for (std::size_t w = 0; w < mixed; ++w)
+      {
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t h = state;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+
+        // one random bit per base, copied to both of its bits
+        Word m = (h & 0x5555555555555555ULL) * 3;
+        if (first + w + 1 == words && tail != 0)
+        {
+          m &= (Word(1) << (PackedBases::BITS_PER_BASE * tail)) - 1;
+        }
+        chunk->words[w] = (w1[w] & m) | (w2[w] & ~m);
+      }
+      std::copy(w2 + mixed, w2 + CHUNK_WORDS, chunk->words + mixed);
+      chunks.push_back(std::move(chunk));
+    }
+
+    Chromosome child{PackedBases(std::move(chunks), b2.size())};
+    spliceDecoded(c1, c2, 0, length, child);
+    return child;
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+SegmentSwapCrossover<Phenotype>::SegmentSwapCrossover(uint32_t seed)
+  : random_(seed)
+{
+  // do nothing
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 template<typename Phenotype>
 std::pair<Phenotype, Genotype>
-BaseMutation<Phenotype>::mutate(Phenotype i,
-                                Genotype g,
-                                const Codec<Phenotype, Genotype>& codec)
+SegmentSwapCrossover<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                         const std::pair<Phenotype, Genotype>& i2,
+                                         const Codec<Phenotype, Genotype>& codec)
+{
+  return fertilize(i1, i2, codec, random_, [this](const Chromosome& c1, const Chromosome& c2)
+  {
+    std::size_t length = std::min(c1.bases.size(), c2.bases.size());
+    std::size_t unit = length >= PackedBases::BASES_PER_CHUNK ? PackedBases::BASES_PER_CHUNK : 1;
+
+    // boundaries are the multiples of the unit, and the end if it is the
+    // same in both homologs
+    std::size_t boundaries = length / unit + 1;
+    bool end = c1.bases.size() == c2.bases.size() && length % unit != 0;
+    if (end) ++boundaries;
+    if (boundaries < 2) return c1;
+
+    std::uniform_int_distribution<std::size_t> boundary(0, boundaries - 1);
+    std::size_t a = boundary(random_);
+    std::size_t b = boundary(random_);
+    while (b == a) b = boundary(random_);
+    if (a > b) std::swap(a, b);
+    std::size_t begin = a * unit;
+    std::size_t finish = end && b == boundaries - 1 ? length : b * unit;
+
+    PackedBases mixed;
+    mixed.reserve(c1.bases.size());
+    mixed.append(c1.bases, 0, begin);
+    mixed.append(c2.bases, begin, finish);
+    mixed.append(c1.bases, finish, c1.bases.size());
+
+    Chromosome child{std::move(mixed)};
+    spliceDecoded(c1, c1, begin, finish, child);
+    return child;
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+void BaseMutation<Phenotype>::mutateInPlace(std::pair<Phenotype, Genotype>& i,
+                                            const Codec<Phenotype, Genotype>& codec,
+                                            MutatedRegion* region)
 {
-  std::vector<Chromosome> chromosomes;
+  if (percentageOfBasesToMutate_ <= 0) return;
+
+  std::vector<Chromosome>& chromosomes = i.second.chromosomes;
 
-  for(const Chromosome& original : g.chromosomes)
+  for (std::size_t c = 0; c < chromosomes.size(); ++c)
   {
-    std::vector<Base> mutatedBases;
-    mutatedBases.reserve(original.bases.size());
-    for (const Base& originalBase : original.bases)
+    PackedBases& bases = chromosomes[c].bases;
+    std::size_t length = bases.size();
+    std::size_t first = length;
+    std::size_t last = 0;
+
+    // jump straight from one mutated base to the next one
+    for (std::size_t pos = distance_(random_);
+         pos < length;
+         pos += 1 + distance_(random_))
     {
-      bool doMutate = distribution_(random_) < percentageOfBasesToMutate_;
-      mutatedBases.push_back(doMutate ? randomBase(random_) : originalBase);
+      bases.set(pos, randomBase(random_));
+      first = std::min(first, pos);
+      last = pos;
     }
 
-    chromosomes.push_back(std::move(mutatedBases));
+    if (first < length)
+    {
+      chromosomes[c].markDirty(first, last + 1);
+      reportMutation(region, c, first, last + 1);
+    }
   }
 
-  Genotype mutatedGenotype =std::move(chromosomes);
-  Phenotype mutatedPhenotype = codec.decode(mutatedGenotype);
-  return std::make_pair(std::move(mutatedPhenotype), std::move(mutatedGenotype));
+  i.first = codec.decode(i.second);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -95,14 +539,36 @@ template<typename Phenotype>
 BaseMutation<Phenotype>::BaseMutation(float percentageOfBasesToMutate, uint32_t seed)
   : percentageOfBasesToMutate_(percentageOfBasesToMutate),
     random_(seed),
-    distribution_(0.0, 100.0)
+    distance_(std::min(1.0, std::max(percentageOfBasesToMutate / 100.0,
+                                     std::numeric_limits<double>::min())))
 {
   // do nothing
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-bool isCodon(std::vector<Base>::const_iterator it,
-             const std::vector<Codon>& codons)
+template<typename iterator>
+Aminoacid decodeCodon(iterator it)
+{
+  return static_cast<uint8_t>(*it) * 1
+         + static_cast<uint8_t>(*(it+1)) * NUMBER_OF_BASES
+         + static_cast<uint8_t>(*(it+2)) * NUMBER_OF_BASES * NUMBER_OF_BASES;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Codon decodeCodon(Aminoacid a)
+{
+  uint8_t b1 = a / (NUMBER_OF_BASES*NUMBER_OF_BASES);
+  uint8_t b2 = (a % (NUMBER_OF_BASES*NUMBER_OF_BASES)) / NUMBER_OF_BASES;
+  uint8_t b3 = a - b1 - b2;
+  return std::move(Codon{{static_cast<Base>(b1),
+                          static_cast<Base>(b2),
+                          static_cast<Base>(b3)}});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Codons>
+bool isCodon(PackedBases::const_iterator it,
+             const Codons& codons)
 {
   auto func = [=](const Codon& codon)
                  { return codon[0] == *it
@@ -115,72 +581,452 @@ bool isCodon(std::vector<Base>::const_iterator it,
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-bool isStartCodon(std::vector<Base>::const_iterator it)
+// The eight 6-bit fields at the bottom of x, one per byte
+inline PackedBases::Word spreadFields(PackedBases::Word x)
 {
-  return isCodon(it, START_CODONS);
+#if defined(__BMI2__)
+  return _pdep_u64(x, 0x3F3F3F3F3F3F3F3FULL);
+#else
+  x = (x & 0x0000000000FFFFFFULL) | (x & 0x0000FFFFFF000000ULL) << 8;
+  x = (x & 0x00000FFF00000FFFULL) | (x & 0x00FFF00000FFF000ULL) << 4;
+  return (x & 0x003F003F003F003FULL) | (x & 0x0FC00FC00FC00FC0ULL) << 2;
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-bool isStopCodon(std::vector<Base>::const_iterator it)
+// Aminoacids of 'count' consecutive codons starting at pos, written to out,
+// past which 'room' >= count bytes may be written. Consecutive codons are
+// consecutive 6-bit fields of the packed bases, so they are unpacked eight
+// at a time by spreading 48-bit windows into the bytes of a word. On little
+// endian targets the windows are read straight from the chunks while there
+// is room for whole ones; elsewhere, ten codons are taken at a time.
+inline void unpackCodons(const PackedBases& bases,
+                         std::size_t pos,
+                         std::size_t count,
+                         Aminoacid* out,
+                         std::size_t room)
 {
-  return isCodon(it, STOP_CODONS);
+  std::size_t bit = PackedBases::BITS_PER_BASE * pos;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // most genes are short enough to take a fixed number of windows, which
+  // saves mispredicting the end of the loop
+  const std::size_t SHORT_WINDOWS = 8;
+  std::size_t byte = bit % 64 / 8;
+  if (count <= 8 * SHORT_WINDOWS && room >= 8 * SHORT_WINDOWS
+      && byte + 6 * SHORT_WINDOWS + 2
+         <= sizeof(PackedBases::Word) * bases.contiguousWords(bit / 64))
+  {
+    const char* bytes = reinterpret_cast<const char*>(bases.wordData(bit / 64)) + byte;
+    for (std::size_t k = 0; k < SHORT_WINDOWS; ++k)
+    {
+      PackedBases::Word window;
+      std::memcpy(&window, bytes + 6 * k, 8);
+      window = spreadFields(window >> bit % 8);
+      std::memcpy(out + 8 * k, &window, 8);
+    }
+    return;
+  }
+
+  while (count > 0)
+  {
+    // the windows read from the current chunk
+    std::size_t w = bit / 64;
+    byte = bit % 64 / 8;
+    std::size_t available = sizeof(PackedBases::Word) * bases.contiguousWords(w);
+    std::size_t windows = byte + 8 <= available ? (available - byte - 2) / 6 : 0;
+    windows = std::min(std::min(windows, (count + 7) / 8), room / 8);
+    const char* bytes = reinterpret_cast<const char*>(bases.wordData(w)) + byte;
+    for (std::size_t k = 0; k < windows; ++k)
+    {
+      PackedBases::Word window;
+      std::memcpy(&window, bytes + 6 * k, 8);
+      window = spreadFields(window >> bit % 8);
+      std::memcpy(out + 8 * k, &window, 8);
+    }
+    std::size_t done = std::min(8 * windows, count);
+    if (done == count) return;
+    out += done;
+    room -= done;
+    count -= done;
+    bit += 6 * done;
+
+    // one window across chunks, or the last one without room for all of it
+    PackedBases::Word window = spreadFields(bases.bitsAt(bit));
+    done = std::min<std::size_t>(count, 8);
+    std::memcpy(out, &window, done);
+    out += done;
+    room -= done;
+    count -= done;
+    bit += 6 * done;
+  }
+#else
+  const std::size_t CODONS_PER_WINDOW = 64 / (PackedBases::BITS_PER_BASE * CODON_SIZE);
+  while (count > 0)
+  {
+    PackedBases::Word window = bases.bitsAt(bit);
+    std::size_t n = std::min(count, CODONS_PER_WINDOW);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      out[k] = static_cast<Aminoacid>((window >> (6 * k)) & 63);
+    }
+    out += n;
+    count -= n;
+    bit += 6 * n;
+  }
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-template<typename iterator>
-Aminoacid decodeCodon(iterator it)
+// Appends to the table the genes between the given start and stop codons.
+// They are added at once, so that each gene may be unpacked in whole
+// windows spilling over the next ones, which are written after it.
+inline void unpackGenes(const PackedBases& bases,
+                        const std::vector<std::size_t>& starts,
+                        const std::vector<std::size_t>& stops,
+                        GeneTable& genes)
 {
-  return static_cast<uint8_t>(*it) * 1
-         + static_cast<uint8_t>(*(it+1)) * NUMBER_OF_BASES
-         + static_cast<uint8_t>(*(it+2)) * NUMBER_OF_BASES * NUMBER_OF_BASES;
+  std::vector<std::size_t> lengths(starts.size());
+  for (std::size_t k = 0; k < starts.size(); ++k)
+  {
+    lengths[k] = (stops[k] - starts[k]) / CODON_SIZE + 1;
+  }
+  Aminoacid* out = genes.addGenes(lengths);
+  Aminoacid* end = out + std::accumulate(lengths.begin(), lengths.end(), std::size_t(0));
+  for (std::size_t k = 0; k < starts.size(); ++k)
+  {
+    unpackCodons(bases, starts[k], lengths[k], out, end - out);
+    out += lengths[k];
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-Codon decodeCodon(Aminoacid a)
+bool isStartCodon(PackedBases::const_iterator it)
 {
-  uint8_t b1 = a / (NUMBER_OF_BASES*NUMBER_OF_BASES);
-  uint8_t b2 = (a % (NUMBER_OF_BASES*NUMBER_OF_BASES)) / NUMBER_OF_BASES;
-  uint8_t b3 = a - b1 - b2;
-  return std::move(Codon{{static_cast<Base>(b1),
-                          static_cast<Base>(b2),
-                          static_cast<Base>(b3)}});
+  return CODON_TABLE.start[decodeCodon(it)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool isStopCodon(PackedBases::const_iterator it)
+{
+  return CODON_TABLE.stop[decodeCodon(it)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Replaces the elements [first, last) of v with those of replacement
+template<typename T>
+void replaceRange(std::vector<T>& v,
+                  std::size_t first,
+                  std::size_t last,
+                  std::vector<T>& replacement)
+{
+  std::size_t common = std::min(last - first, replacement.size());
+  std::move(replacement.begin(), replacement.begin() + common, v.begin() + first);
+  v.erase(v.begin() + first + common, v.begin() + last);
+  v.insert(v.begin() + first + common,
+           std::make_move_iterator(replacement.begin() + common),
+           std::make_move_iterator(replacement.end()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline const GeneTable& decodeGenes (const Chromosome& chromosome)
+{
+  if (chromosome.decoded && !chromosome.dirty) return chromosome.decoded->genes;
+
+  if (!chromosome.decoded)
+  {
+    chromosome.decoded = std::make_shared<DecodeCache>();
+    chromosome.dirtyBegin = 0;
+    chromosome.dirtyEnd = chromosome.bases.size();
+  }
+  else if (chromosome.decoded.use_count() > 1)
+  {
+    // the genes are shared with copies of this chromosome
+    chromosome.decoded = std::make_shared<DecodeCache>(*chromosome.decoded);
+  }
+
+  DecodeCache& cache = *chromosome.decoded;
+  std::size_t cached = cache.genes.size();
+  std::size_t dirtyBegin = chromosome.dirtyBegin;
+  std::size_t dirtyEnd = chromosome.dirtyEnd;
+
+  // genes ending before the dirty range are kept as they are
+  std::size_t kept = std::partition_point(cache.stops.begin(), cache.stops.end(),
+                                          [=](std::size_t stop)
+                                          { return stop + CODON_SIZE <= dirtyBegin; })
+                     - cache.stops.begin();
+
+  // Rescan from the stop codon of the last kept gene, where the previous
+  // scan resumed. Once past the dirty range, the scan synchronizes with the
+  // previous one when reaching one of its start codons or stop codons, and
+  // the remaining cached genes are reused.
+  const PackedBases& bases = chromosome.bases;
+  CodonScanner scanner(bases);
+  std::size_t limit = scanner.limit();
+  std::size_t reuseFrom = cached;
+  std::size_t startCandidate = kept;
+  std::size_t stopCandidate = kept;
+
+  GeneTable genes;
+  std::vector<std::size_t> starts;
+  std::vector<std::size_t> stops;
+
+  for (std::size_t pos = scanner.nextStart(kept > 0 ? cache.stops[kept - 1] : 0);
+       pos < limit;
+       pos = scanner.nextStart(pos))
+  {
+    if (pos >= dirtyEnd)
+    {
+      while (startCandidate < cached && cache.starts[startCandidate] < pos) ++startCandidate;
+      if (startCandidate < cached && cache.starts[startCandidate] == pos)
+      {
+        reuseFrom = startCandidate;
+        break;
+      }
+    }
+
+    std::size_t stop = scanner.nextStop(pos + CODON_SIZE, pos);
+
+    // an unterminated gene ends the chromosome
+    if (stop >= limit) break;
+
+    // found a gene!
+    starts.push_back(pos);
+    stops.push_back(stop);
+
+    // the next gene may begin right at the stop codon
+    pos = stop;
+
+    if (pos >= dirtyEnd)
+    {
+      while (stopCandidate < cached && cache.stops[stopCandidate] < pos) ++stopCandidate;
+      if (stopCandidate < cached && cache.stops[stopCandidate] == pos)
+      {
+        reuseFrom = stopCandidate + 1;
+        break;
+      }
+    }
+  }
+
+  unpackGenes(bases, starts, stops, genes);
+  if (kept == 0 && reuseFrom == cached) std::swap(cache.genes, genes);
+  else cache.genes.replace(kept, reuseFrom, genes);
+  replaceRange(cache.starts, kept, reuseFrom, starts);
+  replaceRange(cache.stops, kept, reuseFrom, stops);
+  chromosome.dirty = false;
+  return cache.genes;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-std::vector<DecodedGene> decodeGenes (const Chromosome& chromosome)
+inline void decodeGenes (const Chromosome& chromosome, GeneTable& genes)
 {
-  std::vector<DecodedGene> result;
-  size_t chromosomeLength = chromosome.bases.size();
+  if (chromosome.decoded && !chromosome.dirty)
+  {
+    genes = chromosome.decoded->genes;
+    return;
+  }
 
-  // traverse the whole chromosome looking for genes
-  for (size_t pos = 0; pos < chromosomeLength - CODON_SIZE; ++pos)
+  genes.clear();
+  const PackedBases& bases = chromosome.bases;
+  CodonScanner scanner(bases);
+  std::size_t limit = scanner.limit();
+  std::vector<std::size_t> starts;
+  std::vector<std::size_t> stops;
+  for (std::size_t pos = scanner.nextStart(0); pos < limit; pos = scanner.nextStart(pos))
   {
-    std::vector<Base>::const_iterator it1 = chromosome.bases.begin() + pos;
+    std::size_t stop = scanner.nextStop(pos + CODON_SIZE, pos);
+
+    // an unterminated gene ends the chromosome
+    if (stop >= limit) break;
+    starts.push_back(pos);
+    stops.push_back(stop);
+
+    // the next gene may begin right at the stop codon
+    pos = stop;
+  }
+  unpackGenes(bases, starts, stops, genes);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline GenotypeDiversity::GenotypeDiversity(std::size_t kmerSize,
+                                            std::size_t buckets,
+                                            std::size_t pairs,
+                                            uint32_t seed)
+  : kmerSize_(std::min<std::size_t>(std::max<std::size_t>(kmerSize, 1), 32)),
+    buckets_(std::max<std::size_t>(buckets, 1)),
+    pairs_(pairs),
+    generator_(seed),
+    individuals_(0)
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void GenotypeDiversity::clear()
+{
+  counters_.clear();
+  lengths_.clear();
+  signatures_.clear();
+  individuals_ = 0;
+}
 
-    if (!isStartCodon(it1)) continue;  // skip until start codon
+///////////////////////////////////////////////////////////////////////////////
+inline void GenotypeDiversity::add(const Genotype& genotype)
+{
+  typedef PackedBases::Word Word;
+  const Word EVEN = 0x5555555555555555ULL;
 
-    DecodedGene gene;
-    gene.push_back(decodeCodon(it1));
+  std::size_t count = genotype.chromosomes.size();
+  if (count > counters_.size())
+  {
+    counters_.resize(count);
+    lengths_.resize(count);
+  }
 
-    // decode codons until stop mark 
-    for (pos += CODON_SIZE;
-         pos < chromosomeLength - CODON_SIZE;
-         pos += CODON_SIZE)
+  // Indicator of each base at the even bits of a word; those of two
+  // consecutive words are interleaved in one, so that counter bit b of
+  // word j is base b / 2 of word 2 * j + b % 2
+  for (std::size_t c = 0; c < count; ++c)
+  {
+    const PackedBases& bases = genotype.chromosomes[c].bases;
+    std::size_t words = bases.wordCount();
+    std::size_t pairs = (words + 1) / 2;
+    indicators_.assign(3 * pairs, 0);
+    for (std::size_t w = 0; w < words; ++w)
+    {
+      Word word = bases.word(w);
+      Word low = word & EVEN;
+      Word high = (word >> 1) & EVEN;
+      std::size_t shift = w % 2;
+      indicators_[w / 2] |= (low & ~high) << shift;              // A
+      indicators_[pairs + w / 2] |= (high & ~low) << shift;      // T
+      indicators_[2 * pairs + w / 2] |= (low & high) << shift;   // C
+    }
+    for (std::size_t b = 0; b < 3; ++b)
+    {
+      counters_[c][b].add(indicators_.data() + b * pairs, pairs);
+    }
+    lengths_[c].push_back(bases.size());
+  }
+
+  if (pairs_ > 0)
+  {
+    signatures_.resize(signatures_.size() + buckets_, std::numeric_limits<uint64_t>::max());
+    uint64_t* signature = signatures_.data() + signatures_.size() - buckets_;
+    for (const Chromosome& chromosome : genotype.chromosomes)
     {
-      std::vector<Base>::const_iterator it2 = chromosome.bases.begin() + pos;
-      gene.push_back(std::move(decodeCodon(it2)));
+      sketch(chromosome.bases, signature);
+    }
+  }
+  ++individuals_;
+}
 
-      if (!isStopCodon(it2)) continue;
+///////////////////////////////////////////////////////////////////////////////
+// Keeps in each bucket the lowest hash of the k-mers falling in it
+inline void GenotypeDiversity::sketch(const PackedBases& bases, uint64_t* signature) const
+{
+  std::size_t size = bases.size();
+  if (size < kmerSize_) return;
+
+  uint64_t mask = kmerSize_ == 32 ? ~uint64_t(0) : (uint64_t(1) << (2 * kmerSize_)) - 1;
+  std::size_t top = 2 * (kmerSize_ - 1);
+  uint64_t kmer = 0;
+  std::size_t pos = 0;
+  for (std::size_t w = 0; w < bases.wordCount(); ++w)
+  {
+    PackedBases::Word word = bases.word(w);
+    for (std::size_t k = 0; k < PackedBases::BASES_PER_WORD && pos < size; ++k, ++pos)
+    {
+      kmer = ((kmer >> 2) | ((word & 3) << top)) & mask;
+      word >>= 2;
+      if (pos + 1 < kmerSize_) continue;
 
-      // found a gene!
-      result.push_back(std::move(gene));
+      // splitmix64 finalizer
+      uint64_t h = kmer + 0x9e3779b97f4a7c15ULL;
+      h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+      uint64_t& bucket = signature[h % buckets_];
+      bucket = std::min(bucket, h);
+    }
+  }
+}
 
-      // leave 'pos' so that the next loop of the outer for points properly
-      pos--;
-      break;
-    } 
+///////////////////////////////////////////////////////////////////////////////
+// One minus the estimated Jaccard similarity of the k-mers of two
+// individuals: the fraction of the buckets used by either in which they
+// agree
+inline double GenotypeDiversity::kmerDistance(std::size_t i, std::size_t j) const
+{
+  const uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
+  const uint64_t* a = signatures_.data() + i * buckets_;
+  const uint64_t* b = signatures_.data() + j * buckets_;
+  std::size_t used = 0, equal = 0;
+  for (std::size_t k = 0; k < buckets_; ++k)
+  {
+    if (a[k] == EMPTY && b[k] == EMPTY) continue;
+    ++used;
+    if (a[k] == b[k]) ++equal;
+  }
+  return used == 0 ? 0 : 1 - double(equal) / used;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline Diversity GenotypeDiversity::estimate()
+{
+  Diversity result;
+  std::size_t n = individuals_;
+  if (n < 2) return result;
+
+  // at a locus with m individuals, of which c[b] have base b, the pairs
+  // that differ are (m^2 - sum of c[b]^2) / 2
+  double differences = 0, entropySum = 0;
+  std::size_t loci = 0;
+  for (std::size_t c = 0; c < counters_.size(); ++c)
+  {
+    std::array<std::vector<std::size_t>, 3> counts;
+    for (std::size_t b = 0; b < 3; ++b) counts[b] = counters_[c][b].counts();
+    std::vector<std::size_t> covering = coverage(lengths_[c]);
+    for (std::size_t k = 0; k < covering.size(); ++k)
+    {
+      std::size_t word = k / PackedBases::BASES_PER_WORD;
+      std::size_t bit = (word / 2) * 64 + 2 * (k % PackedBases::BASES_PER_WORD) + word % 2;
+      std::size_t symbols[4] = {counts[0][bit], counts[1][bit], counts[2][bit], 0};
+      symbols[3] = covering[k] - symbols[0] - symbols[1] - symbols[2];
+      double same = 0;
+      for (std::size_t s : symbols) same += double(s) * s;
+      differences += (double(covering[k]) * covering[k] - same) / 2;
+      entropySum += entropy(symbols, 4, covering[k]) / 2;
+      ++loci;
+    }
+  }
+  result.meanDistance = differences / (n * (n - 1) / 2.0);
+  if (loci > 0) result.entropy = entropySum / loci;
+
+  if (pairs_ > 0)
+  {
+    double sum = 0;
+    std::size_t count = 0;
+    if (n * (n - 1) / 2 <= pairs_)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        for (std::size_t j = i + 1; j < n; ++j, ++count) sum += kmerDistance(i, j);
+      }
+    }
+    else
+    {
+      std::uniform_int_distribution<std::size_t> first(0, n - 1), second(0, n - 2);
+      for (; count < pairs_; ++count)
+      {
+        std::size_t i = first(generator_);
+        std::size_t j = second(generator_);
+        if (j >= i) ++j;
+        sum += kmerDistance(i, j);
+      }
+    }
+    result.kmerDistance = sum / count;
   }
-  return std::move(result);
+  return result;
 }
 
 }}}
@@ -0,0 +1,127 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef DNA_IO_HEADER_SEEN__
+#define DNA_IO_HEADER_SEEN__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <stdexcept>
+
+#include "gene/coding/dna.hpp"
+
+namespace gene { namespace coding { namespace dna {
+
+/******************************************************************************
+ * File format for populations of DNA genotypes.
+ * Every field is a 64-bit word in native byte order, so the file can be
+ * mapped in memory and its chromosome chunks used in place:
+ *
+ *   header:   FILE_MAGIC, FILE_VERSION
+ *   records:  one per genotype, see below
+ *   index:    offset of each record, count, offset of the index,
+ *             INDEX_MAGIC
+ *
+ * A record holds the index of its reference genotype (NO_REFERENCE for
+ * keyframes), the number of chromosomes, and for each chromosome its number
+ * of bases, its encoding and its data:
+ *   RAW_CHROMOSOME:   its PackedBases chunks, the last one zero padded.
+ *   DELTA_CHROMOSOME: for each chunk, a mask with bit k set when word k
+ *                     differs from the same chromosome of the reference,
+ *                     followed by the XOR of the differing words.
+ * In a converged population most chunks of most genotypes take one word.
+ *****************************************************************************/
+const uint64_t FILE_MAGIC = 0x31414e44454e4547ULL;   // "GENEDNA1"
+const uint64_t INDEX_MAGIC = 0x31584449454e4547ULL;  // "GENEIDX1"
+const uint64_t FILE_VERSION = 1;
+const uint64_t NO_REFERENCE = ~uint64_t(0);
+const uint64_t RAW_CHROMOSOME = 0;
+const uint64_t DELTA_CHROMOSOME = 1;
+
+/******************************************************************************
+ * Streaming writer of a population file.
+ * Genotypes are written as they come; only the latest keyframe and the
+ * index are kept in memory. Every keyframeInterval-th genotype is stored
+ * raw and the following ones as deltas against it, chromosome by chromosome
+ * whenever that is smaller.
+ *****************************************************************************/
+struct PopulationWriter
+{
+  PopulationWriter(const std::string& path, std::size_t keyframeInterval = 16);
+
+  PopulationWriter(const PopulationWriter&) = delete;
+
+  void write(const Genotype&);
+
+  // Writes the index; called by the destructor if not called before
+  void close();
+
+  ~PopulationWriter();
+
+  private:
+
+    void writeWord(uint64_t);
+    void writeRaw(const PackedBases&);
+    bool writeDelta(const PackedBases&, const PackedBases& reference);
+
+    std::ofstream file_;
+    const std::size_t keyframeInterval_;
+    std::vector<uint64_t> offsets_;
+    uint64_t offset_;
+    Genotype keyframe_;
+    uint64_t keyframeIndex_;
+    bool closed_;
+};
+
+/******************************************************************************
+ * Reader of a population file, mapped in memory.
+ * Genotypes are read individually without touching the rest of the file, so
+ * the population may be larger than the available memory. Raw chunks, and
+ * delta chunks equal to those of their reference, point into the mapping
+ * instead of being copied; the mapping stays alive while any of them does.
+ *****************************************************************************/
+struct PopulationReader
+{
+  PopulationReader(const std::string& path);
+
+  PopulationReader(const PopulationReader&) = delete;
+
+  std::size_t size() const { return offsets_.size(); }
+
+  Genotype read(std::size_t index) const;
+
+  private:
+
+    struct Mapping;
+
+    const uint64_t* record(std::size_t index) const;
+
+    std::shared_ptr<Mapping> mapping_;
+    const uint64_t* words_;
+    std::size_t wordCount_;          // of the records, up to the index
+    std::vector<uint64_t> offsets_;
+};
+
+/******************************************************************************
+ * Writes all the genotypes of a population to a file.
+ *****************************************************************************/
+template<typename Phenotype>
+void writePopulation(const std::string& path,
+                     const Population<Phenotype, Genotype>& population,
+                     std::size_t keyframeInterval = 16);
+
+/******************************************************************************
+ * Reads a population from a file, decoding the phenotypes with the codec.
+ *****************************************************************************/
+template<typename Phenotype>
+Population<Phenotype, Genotype> readPopulation(const std::string& path,
+                                               const Codec<Phenotype, Genotype>& codec);
+
+}}}
+
+#include "gene/coding/dna_io_impl.hpp"
+
+#endif
@@ -0,0 +1,372 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gene { namespace coding { namespace dna {
+
+typedef PackedBases::Chunk Chunk;
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t chunksFor(std::size_t bases)
+{
+  return (bases + PackedBases::BASES_PER_CHUNK - 1) / PackedBases::BASES_PER_CHUNK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PopulationWriter::PopulationWriter(const std::string& path,
+                                          std::size_t keyframeInterval)
+  : file_(path, std::ios::binary | std::ios::trunc),
+    keyframeInterval_(std::max<std::size_t>(keyframeInterval, 1)),
+    offset_(0),
+    keyframe_(std::vector<Chromosome>()),
+    keyframeIndex_(NO_REFERENCE),
+    closed_(false)
+{
+  if (!file_) throw std::runtime_error("cannot open " + path);
+  writeWord(FILE_MAGIC);
+  writeWord(FILE_VERSION);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PopulationWriter::writeWord(uint64_t w)
+{
+  file_.write(reinterpret_cast<const char*>(&w), sizeof(w));
+  if (!file_) throw std::runtime_error("error writing population file");
+  offset_ += sizeof(w);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PopulationWriter::writeRaw(const PackedBases& bases)
+{
+  std::size_t wordCount = bases.wordCount();
+  for (std::size_t w = 0; w < bases.chunkCount() * PackedBases::CHUNK_WORDS; ++w)
+  {
+    writeWord(w < wordCount ? bases.word(w) : 0);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes the delta of bases against reference, of the same size, unless it
+// would take more space than the raw chunks
+inline bool PopulationWriter::writeDelta(const PackedBases& bases,
+                                         const PackedBases& reference)
+{
+  std::size_t wordCount = bases.wordCount();
+  std::size_t chunkCount = bases.chunkCount();
+
+  std::vector<uint64_t> masks(chunkCount, 0);
+  std::size_t deltaWords = chunkCount;
+  for (std::size_t k = 0; k < chunkCount; ++k)
+  {
+    if (bases.chunk(k) == reference.chunk(k)) continue;
+    std::size_t end = std::min((k + 1) * PackedBases::CHUNK_WORDS, wordCount);
+    for (std::size_t w = k * PackedBases::CHUNK_WORDS; w < end; ++w)
+    {
+      if (bases.word(w) == reference.word(w)) continue;
+      masks[k] |= uint64_t(1) << (w % PackedBases::CHUNK_WORDS);
+      ++deltaWords;
+    }
+  }
+  if (deltaWords >= chunkCount * PackedBases::CHUNK_WORDS) return false;
+
+  writeWord(DELTA_CHROMOSOME);
+  for (std::size_t k = 0; k < chunkCount; ++k)
+  {
+    writeWord(masks[k]);
+    for (uint64_t m = masks[k]; m != 0; m &= m - 1)
+    {
+      std::size_t w = k * PackedBases::CHUNK_WORDS + lowestSetBit(m);
+      writeWord(bases.word(w) ^ reference.word(w));
+    }
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PopulationWriter::write(const Genotype& genotype)
+{
+  if (closed_) throw std::logic_error("population file already closed");
+
+  uint64_t index = offsets_.size();
+  bool keyframe = index % keyframeInterval_ == 0;
+  const std::vector<Chromosome>& chromosomes = genotype.chromosomes;
+  const std::vector<Chromosome>& reference = keyframe_.chromosomes;
+
+  offsets_.push_back(offset_);
+  writeWord(keyframe ? NO_REFERENCE : keyframeIndex_);
+  writeWord(chromosomes.size());
+
+  for (std::size_t c = 0; c < chromosomes.size(); ++c)
+  {
+    const PackedBases& bases = chromosomes[c].bases;
+    writeWord(bases.size());
+
+    if (!keyframe
+        && c < reference.size()
+        && reference[c].bases.size() == bases.size()
+        && writeDelta(bases, reference[c].bases)) continue;
+
+    writeWord(RAW_CHROMOSOME);
+    writeRaw(bases);
+  }
+
+  if (keyframe)
+  {
+    keyframe_ = genotype;
+    keyframeIndex_ = index;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void PopulationWriter::close()
+{
+  if (closed_) return;
+  closed_ = true;
+
+  uint64_t indexOffset = offset_;
+  for (uint64_t offset : offsets_) writeWord(offset);
+  writeWord(offsets_.size());
+  writeWord(indexOffset);
+  writeWord(INDEX_MAGIC);
+  file_.close();
+  if (!file_) throw std::runtime_error("error closing population file");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PopulationWriter::~PopulationWriter()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {
+    // destructors must not throw; call close() to get the error
+  }
+}
+
+/******************************************************************************
+ * Private writable mapping of a whole file: chunks pointing into it can be
+ * modified in place by their last owner without touching the file.
+ *****************************************************************************/
+struct PopulationReader::Mapping
+{
+  void* data;
+  std::size_t size;
+
+  Mapping(const std::string& path) : data(MAP_FAILED), size(0)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      size = info.st_size;
+      data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+  }
+
+  Mapping(const Mapping&) = delete;
+
+  ~Mapping() { ::munmap(data, size); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline PopulationReader::PopulationReader(const std::string& path)
+  : mapping_(std::make_shared<Mapping>(path)),
+    words_(static_cast<const uint64_t*>(mapping_->data)),
+    wordCount_(mapping_->size / sizeof(uint64_t))
+{
+  if (wordCount_ < 5
+      || words_[0] != FILE_MAGIC
+      || words_[1] != FILE_VERSION
+      || words_[wordCount_ - 1] != INDEX_MAGIC)
+  {
+    throw std::runtime_error(path + " is not a population file");
+  }
+
+  // the index must follow the records and end the file, and every record
+  // start within the records
+  uint64_t count = words_[wordCount_ - 3];
+  uint64_t indexBytes = words_[wordCount_ - 2];
+  uint64_t indexOffset = indexBytes / sizeof(uint64_t);
+  if (indexBytes % sizeof(uint64_t) != 0
+      || indexOffset < 2
+      || count > wordCount_
+      || indexOffset + count + 3 != wordCount_)
+  {
+    throw std::runtime_error(path + " has a corrupt index");
+  }
+  offsets_.assign(words_ + indexOffset, words_ + indexOffset + count);
+  for (uint64_t offset : offsets_)
+  {
+    if (offset % sizeof(uint64_t) != 0
+        || offset / sizeof(uint64_t) < 2
+        || offset / sizeof(uint64_t) >= indexOffset)
+    {
+      throw std::runtime_error(path + " has a corrupt index");
+    }
+  }
+  wordCount_ = indexOffset;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline const uint64_t* PopulationReader::record(std::size_t index) const
+{
+  if (index >= offsets_.size()) throw std::out_of_range("no such genotype");
+  return words_ + offsets_[index] / sizeof(uint64_t);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Every length read from the file is checked against the words left before
+// the index, and delta chromosomes against the size of their reference, so
+// that a corrupt or truncated file throws instead of reading out of bounds
+inline Genotype PopulationReader::read(std::size_t index) const
+{
+  const uint64_t* end = words_ + wordCount_;
+  auto check = [end](const uint64_t* p, std::size_t words)
+  {
+    if (words > std::size_t(end - p)) throw std::runtime_error("truncated population file");
+  };
+  // chunks of a chromosome of 'size' bases at p, which must have at least
+  // one word per chunk left
+  auto chunksAt = [&check, end](const uint64_t* p, uint64_t size)
+  {
+    if (size / PackedBases::BASES_PER_CHUNK > std::size_t(end - p))
+    {
+      throw std::runtime_error("truncated population file");
+    }
+    std::size_t chunkCount = chunksFor(size);
+    check(p, chunkCount);
+    return chunkCount;
+  };
+  auto alias = [this](const uint64_t* p)
+  {
+    Chunk* chunk = reinterpret_cast<Chunk*>(const_cast<uint64_t*>(p));
+    return std::shared_ptr<Chunk>(mapping_, chunk);
+  };
+
+  // raw chunks and size of the chromosomes of the reference genotype
+  const uint64_t* p = record(index);
+  check(p, 2);
+  std::vector<const uint64_t*> referenceChunks;
+  std::vector<uint64_t> referenceSizes;
+  if (p[0] != NO_REFERENCE)
+  {
+    if (p[0] >= offsets_.size()) throw std::runtime_error("invalid reference genotype");
+    const uint64_t* r = record(p[0]);
+    check(r, 2);
+    uint64_t count = r[1];
+    r += 2;
+    if (count > std::size_t(end - r) / 2) throw std::runtime_error("truncated population file");
+    for (std::size_t c = 0; c < count; ++c)
+    {
+      check(r, 2);
+      if (r[1] != RAW_CHROMOSOME) throw std::runtime_error("reference is not a keyframe");
+      std::size_t words = chunksAt(r + 2, r[0]) * PackedBases::CHUNK_WORDS;
+      check(r + 2, words);
+      referenceChunks.push_back(r + 2);
+      referenceSizes.push_back(r[0]);
+      r += 2 + words;
+    }
+  }
+
+  uint64_t count = p[1];
+  p += 2;
+  if (count > std::size_t(end - p) / 2) throw std::runtime_error("truncated population file");
+  std::vector<Chromosome> chromosomes;
+  chromosomes.reserve(count);
+  for (std::size_t c = 0; c < count; ++c)
+  {
+    check(p, 2);
+    uint64_t size = p[0];
+    uint64_t encoding = p[1];
+    p += 2;
+    std::size_t chunkCount = chunksAt(p, size);
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    chunks.reserve(chunkCount);
+    if (encoding == RAW_CHROMOSOME)
+    {
+      check(p, chunkCount * PackedBases::CHUNK_WORDS);
+      for (std::size_t k = 0; k < chunkCount; ++k)
+      {
+        chunks.push_back(alias(p));
+        p += PackedBases::CHUNK_WORDS;
+      }
+    }
+    else if (encoding == DELTA_CHROMOSOME && c < referenceChunks.size())
+    {
+      if (referenceSizes[c] != size)
+      {
+        throw std::runtime_error("delta chromosome differs in size from its reference");
+      }
+      const uint64_t* reference = referenceChunks[c];
+      for (std::size_t k = 0; k < chunkCount; ++k)
+      {
+        check(p, 1);
+        uint64_t mask = *p++;
+        if (mask == 0)
+        {
+          chunks.push_back(alias(reference));
+        }
+        else
+        {
+          std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+          std::copy(reference, reference + PackedBases::CHUNK_WORDS, chunk->words);
+          for (; mask != 0; mask &= mask - 1)
+          {
+            check(p, 1);
+            chunk->words[lowestSetBit(mask)] ^= *p++;
+          }
+          chunks.push_back(std::move(chunk));
+        }
+        reference += PackedBases::CHUNK_WORDS;
+      }
+    }
+    else
+    {
+      throw std::runtime_error("invalid chromosome encoding");
+    }
+    chromosomes.emplace_back(PackedBases(std::move(chunks), size));
+  }
+  return Genotype(std::move(chromosomes));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+void writePopulation(const std::string& path,
+                     const Population<Phenotype, Genotype>& population,
+                     std::size_t keyframeInterval)
+{
+  PopulationWriter writer(path, keyframeInterval);
+  for (const auto& individual : population) writer.write(individual.second);
+  writer.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+Population<Phenotype, Genotype> readPopulation(const std::string& path,
+                                               const Codec<Phenotype, Genotype>& codec)
+{
+  PopulationReader reader(path);
+  Population<Phenotype, Genotype> result;
+  result.reserve(reader.size());
+  for (std::size_t k = 0; k < reader.size(); ++k)
+  {
+    Genotype genotype = reader.read(k);
+    Phenotype phenotype = codec.decode(genotype);
+    result.emplace_back(std::move(phenotype), std::move(genotype));
+  }
+  return result;
+}
+
+}}}
@@ -0,0 +1,129 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef DNA_STORE_HEADER_SEEN__
+#define DNA_STORE_HEADER_SEEN__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include "gene/coding/dna.hpp"
+
+namespace gene { namespace coding { namespace dna {
+
+/******************************************************************************
+ * Out-of-core storage for the genotypes of populations larger than the
+ * available memory.
+ * Genotypes are stored in fixed-size records, each with room for the chunks
+ * of 'chromosomeSizes.size()' chromosomes of up to chromosomeSizes[c] bases.
+ * Records are allocated in segment files of 'segmentRecords' records (about
+ * 64 MiB if 0) created in 'directory' and mapped shared in memory, so the
+ * kernel writes their pages back and drops them under memory pressure. The
+ * files are unlinked as soon as they are mapped: the store is scratch
+ * space, see dna_io.hpp to keep populations.
+ *
+ * A stored genotype is an ordinary Genotype whose chunks point into its
+ * record, so it works with every operator; a record is freed when the last
+ * of its chunks is released, and the free ones are reused lowest first so
+ * that the genotypes stored together stay together. Chunks copied on write
+ * (e.g. by a mutation) and chunks shared with other records (e.g. after a
+ * crossover) live in memory until the genotype is stored again. The genes
+ * decoded are not kept, as they take more memory than the bases.
+ *
+ * Not thread safe, but the stored genotypes may be released from any
+ * thread, and the store may be destroyed before them.
+ *****************************************************************************/
+struct GenotypeStore
+{
+  static const std::size_t NOT_STORED = std::numeric_limits<std::size_t>::max();
+
+  GenotypeStore(const std::string& directory,
+                const std::vector<std::size_t>& chromosomeSizes,
+                std::size_t segmentRecords = 0);
+
+  GenotypeStore(const GenotypeStore&) = delete;
+  GenotypeStore& operator=(const GenotypeStore&) = delete;
+
+  // The genotype, with its bases in a record of the store. Throws
+  // std::length_error if it does not fit in a record.
+  Genotype store(const Genotype& genotype);
+
+  // Stores in place the genotypes of the population that are not yet
+  template<typename Phenotype>
+  void store(Population<Phenotype, Genotype>& population);
+
+  // Record holding the whole genotype, or NOT_STORED
+  std::size_t record(const Genotype& genotype) const;
+
+  // Indices of the population ordered by record, those not stored last
+  template<typename Phenotype>
+  std::vector<PopulationIndex> order(const Population<Phenotype, Genotype>& population) const;
+
+  // Hints the kernel to read the records [first, last) in advance, or to
+  // drop their pages (those not shared with other records) from memory
+  void prefetch(std::size_t first, std::size_t last) const;
+  void evict(std::size_t first, std::size_t last) const;
+
+  std::size_t recordBytes() const;
+  std::size_t records() const;    // records in the segments
+  std::size_t used() const;       // records holding a genotype
+
+  private:
+
+    struct State;
+    struct Release;
+
+    void advise(std::size_t first, std::size_t last, int advice, bool inner) const;
+
+    std::shared_ptr<State> state_;
+    std::vector<std::size_t> offsets_;     // first chunk of each chromosome
+};
+
+/****************************************************************************
+ * Combination storing the children of another one as they are made, so
+ * that the offspring of a GeneticAlgorithm is not held in memory.
+ ***************************************************************************/
+template<typename Phenotype>
+struct StoringCombination : public CombinationStrategy<Phenotype, Genotype>
+{
+  StoringCombination(CombinationStrategy<Phenotype, Genotype>& combination,
+                     GenotypeStore& store);
+
+  std::pair<Phenotype, Genotype>
+          combine(const std::pair<Phenotype, Genotype>&,
+                  const std::pair<Phenotype, Genotype>&,
+                  const Codec<Phenotype, Genotype>&) override;
+
+  private:
+    CombinationStrategy<Phenotype, Genotype>& combination_;
+    GenotypeStore& store_;
+};
+
+/****************************************************************************
+ * Fitness function streaming a stored population through another one in
+ * record order, 'batchSize' individuals at a time: the records of the next
+ * batch are prefetched while one is evaluated, and evicted after it.
+ ***************************************************************************/
+template<typename Phenotype>
+struct StreamingFitness : public FitnessFunction<Phenotype, Genotype>
+{
+  StreamingFitness(FitnessFunction<Phenotype, Genotype>& function,
+                   const GenotypeStore& store,
+                   std::size_t batchSize = 1024);
+
+  PopulationFitness calculate(const Population<Phenotype, Genotype>& population) override;
+
+  private:
+    FitnessFunction<Phenotype, Genotype>& function_;
+    const GenotypeStore& store_;
+    const std::size_t batchSize_;
+};
+
+}}}
+
+#include "gene/coding/dna_store_impl.hpp"
+
+#endif
@@ -0,0 +1,392 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace gene { namespace coding { namespace dna {
+
+/******************************************************************************
+ * Segments and free records of a GenotypeStore, shared with the records in
+ * use so that it outlives the store if they do.
+ *****************************************************************************/
+struct GenotypeStore::State
+{
+  std::string directory;
+  std::size_t recordBytes;
+  std::size_t segmentRecords;
+  std::size_t segmentBytes;     // rounded up to whole pages
+  std::size_t pageBytes;
+  std::vector<char*> segments;
+
+  std::mutex mutex;             // guards the free records and the count
+  std::priority_queue<std::size_t, std::vector<std::size_t>,
+                      std::greater<std::size_t>> free;
+  std::size_t used = 0;
+
+  State() = default;
+
+  State(const State&) = delete;
+
+  ~State()
+  {
+    for (char* segment : segments) ::munmap(segment, segmentBytes);
+  }
+
+  char* address(std::size_t record) const
+  {
+    return segments[record / segmentRecords] + record % segmentRecords * recordBytes;
+  }
+
+  // Maps a new segment and adds its records to the free ones; called with
+  // the mutex held
+  void grow()
+  {
+    std::string path = directory + "/gene-store-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = ::mkstemp(name.data());
+    if (fd < 0) throw std::runtime_error("cannot create a segment in " + directory);
+    ::unlink(name.data());
+
+    // allocating the blocks now fails here, instead of with a SIGBUS when
+    // a record is written on a full disk
+    int error = ::posix_fallocate(fd, 0, segmentBytes);
+    void* data = MAP_FAILED;
+    if (error == 0)
+    {
+      data = ::mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) error = errno;
+    }
+    ::close(fd);
+    if (error != 0)
+    {
+      throw std::runtime_error("cannot map a segment: " + std::string(std::strerror(error)));
+    }
+
+    std::size_t first = segments.size() * segmentRecords;
+    segments.push_back(static_cast<char*>(data));
+    for (std::size_t r = first; r < first + segmentRecords; ++r) free.push(r);
+  }
+
+  std::size_t allocate()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free.empty()) grow();
+    std::size_t record = free.top();
+    free.pop();
+    ++used;
+    return record;
+  }
+};
+
+/******************************************************************************
+ * Deleter of the record shared by the chunks of a stored genotype.
+ *****************************************************************************/
+struct GenotypeStore::Release
+{
+  std::shared_ptr<State> state;
+  std::size_t record;
+
+  void operator()(void*) const
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->free.push(record);
+    --state->used;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline GenotypeStore::GenotypeStore(const std::string& directory,
+                                    const std::vector<std::size_t>& chromosomeSizes,
+                                    std::size_t segmentRecords)
+  : state_(std::make_shared<State>())
+{
+  offsets_.push_back(0);
+  for (std::size_t size : chromosomeSizes)
+  {
+    std::size_t chunks = (size + PackedBases::BASES_PER_CHUNK - 1) / PackedBases::BASES_PER_CHUNK;
+    offsets_.push_back(offsets_.back() + chunks);
+  }
+
+  long page = ::sysconf(_SC_PAGESIZE);
+  state_->directory = directory;
+  state_->pageBytes = page > 0 ? page : 4096;
+  state_->recordBytes = std::max<std::size_t>(offsets_.back(), 1) * sizeof(PackedBases::Chunk);
+  state_->segmentRecords = segmentRecords > 0
+                           ? segmentRecords
+                           : std::max<std::size_t>(1, (std::size_t(64) << 20) / state_->recordBytes);
+  std::size_t bytes = state_->segmentRecords * state_->recordBytes;
+  state_->segmentBytes = (bytes + state_->pageBytes - 1) / state_->pageBytes * state_->pageBytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline Genotype GenotypeStore::store(const Genotype& genotype)
+{
+  const std::vector<Chromosome>& chromosomes = genotype.chromosomes;
+  if (chromosomes.size() + 1 > offsets_.size())
+  {
+    throw std::length_error("too many chromosomes for the records of the store");
+  }
+  for (std::size_t c = 0; c < chromosomes.size(); ++c)
+  {
+    if (chromosomes[c].bases.chunkCount() > offsets_[c + 1] - offsets_[c])
+    {
+      throw std::length_error("chromosome too long for the records of the store");
+    }
+  }
+
+  std::size_t record = state_->allocate();
+  std::shared_ptr<void> lease(state_->address(record), Release{state_, record});
+  PackedBases::Chunk* chunks = static_cast<PackedBases::Chunk*>(lease.get());
+
+  // the bits past the last base are zero in every chunk, so whole chunks
+  // are copied
+  std::vector<Chromosome> result;
+  result.reserve(chromosomes.size());
+  for (std::size_t c = 0; c < chromosomes.size(); ++c)
+  {
+    const PackedBases& bases = chromosomes[c].bases;
+    std::vector<std::shared_ptr<PackedBases::Chunk>> stored;
+    stored.reserve(bases.chunkCount());
+    for (std::size_t k = 0; k < bases.chunkCount(); ++k)
+    {
+      PackedBases::Chunk* chunk = chunks + offsets_[c] + k;
+      std::memcpy(chunk, bases.chunk(k).get(), sizeof(PackedBases::Chunk));
+      stored.emplace_back(lease, chunk);
+    }
+    result.emplace_back(PackedBases(std::move(stored), bases.size()));
+  }
+  return Genotype(std::move(result));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+void GenotypeStore::store(Population<Phenotype, Genotype>& population)
+{
+  for (auto& individual : population)
+  {
+    if (record(individual.second) == NOT_STORED)
+    {
+      individual.second = store(individual.second);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t GenotypeStore::record(const Genotype& genotype) const
+{
+  const State& state = *state_;
+  std::size_t record = NOT_STORED;
+  uintptr_t begin = 0;
+  uintptr_t end = 0;
+  for (const Chromosome& chromosome : genotype.chromosomes)
+  {
+    const PackedBases& bases = chromosome.bases;
+    for (std::size_t k = 0; k < bases.chunkCount(); ++k)
+    {
+      uintptr_t p = reinterpret_cast<uintptr_t>(bases.chunk(k).get());
+      if (record == NOT_STORED)
+      {
+        // the first chunk tells the record, the rest must be in it
+        for (std::size_t s = 0; s < state.segments.size(); ++s)
+        {
+          uintptr_t segment = reinterpret_cast<uintptr_t>(state.segments[s]);
+          std::size_t offset = p - segment;
+          if (p < segment || offset >= state.segmentRecords * state.recordBytes) continue;
+          record = s * state.segmentRecords + offset / state.recordBytes;
+          begin = reinterpret_cast<uintptr_t>(state.address(record));
+          end = begin + state.recordBytes;
+          break;
+        }
+        if (record == NOT_STORED) return NOT_STORED;
+      }
+      else if (p < begin || p >= end)
+      {
+        return NOT_STORED;
+      }
+    }
+  }
+  return record;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+std::vector<PopulationIndex>
+GenotypeStore::order(const Population<Phenotype, Genotype>& population) const
+{
+  std::vector<std::pair<std::size_t, PopulationIndex>> keys;
+  keys.reserve(population.size());
+  for (PopulationIndex k = 0; k < population.size(); ++k)
+  {
+    keys.emplace_back(record(population[k].second), k);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<PopulationIndex> result;
+  result.reserve(keys.size());
+  for (const auto& key : keys) result.push_back(key.second);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Applies the advice to the pages of the records [first, last), segment by
+// segment; only to the pages entirely within them if 'inner'
+inline void GenotypeStore::advise(std::size_t first, std::size_t last,
+                                  int advice, bool inner) const
+{
+  const State& state = *state_;
+  last = std::min(last, records());
+  while (first < last)
+  {
+    std::size_t end = std::min(last, (first / state.segmentRecords + 1) * state.segmentRecords);
+    uintptr_t from = reinterpret_cast<uintptr_t>(state.address(first));
+    uintptr_t to = reinterpret_cast<uintptr_t>(state.address(end - 1)) + state.recordBytes;
+    uintptr_t page = state.pageBytes;
+    if (inner)
+    {
+      from = (from + page - 1) / page * page;
+      to = to / page * page;
+    }
+    else
+    {
+      from = from / page * page;
+      to = (to + page - 1) / page * page;
+    }
+    // only hints: errors are ignored
+    if (from < to) ::madvise(reinterpret_cast<void*>(from), to - from, advice);
+    first = end;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void GenotypeStore::prefetch(std::size_t first, std::size_t last) const
+{
+  advise(first, last, MADV_WILLNEED, false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Dropping the pages of a shared mapping does not lose their contents:
+// they are read again from the page cache or the file when touched
+inline void GenotypeStore::evict(std::size_t first, std::size_t last) const
+{
+  advise(first, last, MADV_DONTNEED, true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t GenotypeStore::recordBytes() const
+{
+  return state_->recordBytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t GenotypeStore::records() const
+{
+  return state_->segments.size() * state_->segmentRecords;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t GenotypeStore::used() const
+{
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->used;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+StoringCombination<Phenotype>::StoringCombination(
+                           CombinationStrategy<Phenotype, Genotype>& combination,
+                           GenotypeStore& store)
+  : combination_(combination), store_(store)
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+std::pair<Phenotype, Genotype>
+StoringCombination<Phenotype>::combine(const std::pair<Phenotype, Genotype>& i1,
+                                       const std::pair<Phenotype, Genotype>& i2,
+                                       const Codec<Phenotype, Genotype>& codec)
+{
+  std::pair<Phenotype, Genotype> child = combination_.combine(i1, i2, codec);
+  child.second = store_.store(child.second);
+  return child;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+StreamingFitness<Phenotype>::StreamingFitness(
+                             FitnessFunction<Phenotype, Genotype>& function,
+                             const GenotypeStore& store,
+                             std::size_t batchSize)
+  : function_(function),
+    store_(store),
+    batchSize_(std::max<std::size_t>(batchSize, 1))
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype>
+PopulationFitness StreamingFitness<Phenotype>::calculate(
+                           const Population<Phenotype, Genotype>& population)
+{
+  std::vector<PopulationIndex> order = store_.order(population);
+  std::size_t count = order.size();
+
+  // records [first, last) of the individuals order[begin, end); as they
+  // are in record order, those not stored are at the end
+  auto records = [&](std::size_t begin, std::size_t end)
+  {
+    std::size_t first = store_.record(population[order[begin]].second);
+    std::size_t last = first;
+    for (std::size_t k = end; k-- > begin && first != GenotypeStore::NOT_STORED; )
+    {
+      last = store_.record(population[order[k]].second);
+      if (last != GenotypeStore::NOT_STORED) break;
+    }
+    if (first == GenotypeStore::NOT_STORED) return std::make_pair(first, first);
+    return std::make_pair(first, last + 1);
+  };
+
+  PopulationFitness fitness(count);
+  std::pair<std::size_t, std::size_t> next = count > 0
+                                             ? records(0, std::min(count, batchSize_))
+                                             : std::make_pair(std::size_t(0), std::size_t(0));
+  if (next.first != GenotypeStore::NOT_STORED) store_.prefetch(next.first, next.second);
+
+  Population<Phenotype, Genotype> batch;
+  for (std::size_t begin = 0; begin < count; begin += batchSize_)
+  {
+    std::size_t end = std::min(count, begin + batchSize_);
+    std::pair<std::size_t, std::size_t> current = next;
+    if (end < count)
+    {
+      next = records(end, std::min(count, end + batchSize_));
+      if (next.first != GenotypeStore::NOT_STORED) store_.prefetch(next.first, next.second);
+    }
+
+    batch.clear();
+    for (std::size_t k = begin; k < end; ++k) batch.push_back(population[order[k]]);
+    PopulationFitness batchFitness = function_.calculate(batch);
+    for (std::size_t k = begin; k < end; ++k) fitness[order[k]] = batchFitness.at(k - begin);
+
+    batch.clear();
+    if (current.first != GenotypeStore::NOT_STORED) store_.evict(current.first, current.second);
+  }
+  return fitness;
+}
+
+}}}
@@ -8,9 +8,14 @@
 #include <cmath>
 #include <random>
 
+#include "gene/async.hpp"
 #include "gene/policies.hpp"
 #include "gene/selection.hpp"
 #include "gene/mating.hpp"
+#include "gene/statistics.hpp"
+#include "gene/evstrat/kernels.hpp"
+#include "gene/evstrat/normal.hpp"
+#include "gene/evstrat/population.hpp"
 
 namespace gene{ namespace evstrat {
 
@@ -21,62 +26,117 @@ struct EvolutionParams
 {
   std::vector<double> value;
   std::vector<double> sigma;
+
+  // Fitness of the individual, valid while 'evaluated' is set. Operators
+  // that change value or sigma clear it.
+  FitnessType fitness = 0;
+  bool evaluated = false;
 };
 
+// Loci used to report the mutated parts of EvolutionParams
+const std::size_t VALUE_LOCUS = 0;
+const std::size_t SIGMA_LOCUS = 1;
+
 using Individual = gene::Individual<Void, EvolutionParams>;
 using Codec = gene::Codec<Void, EvolutionParams>;
 using Population = gene::Population<Void, EvolutionParams>;
 using FitnessFunction = gene::FitnessFunction<Void, EvolutionParams>;
+using AsyncFitnessFunction = gene::AsyncFitnessFunction<Void, EvolutionParams>;
 using MutationStrategy = gene::MutationStrategy<Void, EvolutionParams>;
 using CombinationStrategy = gene::CombinationStrategy<Void, EvolutionParams>;
+using GenerationObserver = gene::GenerationObserver<Void, EvolutionParams>;
+
+///////////////////////////////////////////////////////////////////////////////
+// Interfaces of the operators that can also work on the rows of a
+// SoaPopulation, given as pointers to the values and sigmas of individuals
+struct RowMutation
+{
+  virtual void mutateRow(double* value, double* sigma) = 0;
+  virtual ~RowMutation() { }
+};
+
+struct RowCombination
+{
+  virtual void combine(const double* value1, const double* sigma1,
+                       const double* value2, const double* sigma2,
+                       double* value, double* sigma,
+                       std::size_t n, std::size_t nSigma) = 0;
+  virtual ~RowCombination() { }
+};
+
+struct RowFitness
+{
+  virtual PopulationFitness calculate(const SoaPopulation&) = 0;
+
+  // Fitness of rows [begin, end) into out. Engines that evaluate in
+  // parallel call it concurrently on disjoint ranges, so it must be thread
+  // safe for them; by default it evaluates a copy of the rows.
+  virtual void calculate(const SoaPopulation& population,
+                         std::size_t begin,
+                         std::size_t end,
+                         FitnessType* out)
+  {
+    SoaPopulation rows(end - begin, population.dimension(), population.sigmaCount());
+    for (std::size_t k = begin; k < end; ++k) rows.copyIndividual(k - begin, population, k);
+    PopulationFitness fitness = calculate(rows);
+    std::copy(fitness.begin(), fitness.end(), out);
+  }
+
+  virtual ~RowFitness() { }
+};
 
 ///////////////////////////////////////////////////////////////////////////////
-struct UncorrelatedOneStep : public MutationStrategy
+struct UncorrelatedOneStep : public MutationStrategy, public RowMutation
 {
   const double n_; 
   const double min_;
   const double max_;
   const double epsilon0_;
   const double tau_;
-  std::mt19937 g_;
-  std::normal_distribution<> normal_;
+  NormalGenerator normal_;
+  std::vector<double> z_;
 
   UncorrelatedOneStep(std::size_t n,
                       double minValue = std::numeric_limits<double>::min(),
                       double maxValue = std::numeric_limits<double>::max(),
                       double epsilon0 = 0.1,
-                      double tauProportionality = 1.0)
+                      double tauProportionality = 1.0,
+                      uint32_t seed = std::random_device{}())
     : n_(n),
       min_(minValue),
       max_(maxValue),
       epsilon0_(epsilon0),
       tau_(tauProportionality / std::sqrt(n_)),
-      g_ (std::random_device{}()),
-      normal_ (0.0, 1.0)
+      normal_ (seed),
+      z_ (n)
   {
     // do nothing
   }
 
-  Individual mutate(Individual individual, const Codec& codec) override
+  void mutateRow(double* value, double* sigma) override
   {
-    EvolutionParams& evParams = individual.second;    
-    double& oldSigma = evParams.sigma[0];
-    double newSigma = std::max(epsilon0_, oldSigma * exp(tau_ * normal_(g_)));
+    double newSigma = std::max(epsilon0_, sigma[0] * std::exp(tau_ * normal_()));
     newSigma = std::min(newSigma, (max_ - min_) / 2);
 
-    for (std::size_t i = 0; i < n_; ++i)
-    {
-      double& oldValue = evParams.value[i];
-      double newValue = std::max(std::min(oldValue + newSigma * normal_(g_), max_), min_);
-      evParams.value[i] = newValue;
-    }
-    evParams.sigma[0] = newSigma;
-    return std::move(individual);
+    normal_.fill(z_.data(), z_.size());
+    perturb(value, newSigma, z_.data(), z_.size(), min_, max_);
+    sigma[0] = newSigma;
+  }
+
+  void mutateInPlace(Individual& individual,
+                     const Codec&,
+                     MutatedRegion* region = nullptr) override
+  {
+    EvolutionParams& evParams = individual.second;    
+    mutateRow(evParams.value.data(), evParams.sigma.data());
+    evParams.evaluated = false;
+    reportMutation(region, VALUE_LOCUS, 0, n_);
+    reportMutation(region, SIGMA_LOCUS, 0, 1);
   }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-struct UncorrelatedNSteps : public MutationStrategy
+struct UncorrelatedNSteps : public MutationStrategy, public RowMutation
 {
   const double n_; 
   const double min_; 
@@ -84,87 +144,209 @@ struct UncorrelatedNSteps : public MutationStrategy
   const double epsilon0_;
   const double tau_;
   const double tauPrime_;
-  std::mt19937 g_;
-  std::normal_distribution<> normal_;
+  NormalGenerator normal_;
+  std::vector<double> z_;
 
   UncorrelatedNSteps(std::size_t n,
                      double minValue = std::numeric_limits<double>::min(),
                      double maxValue = std::numeric_limits<double>::max(),
                      double epsilon0 = 0.1,
-                     double tauProportionality = 1.0)
+                     double tauProportionality = 1.0,
+                     uint32_t seed = std::random_device{}())
     : n_(n),
       min_(minValue),
       max_(maxValue),
       epsilon0_(epsilon0),
       tau_(tauProportionality / std::sqrt(2*n_)),
       tauPrime_(tauProportionality / std::sqrt(2*std::sqrt(n_))),
-      g_ (std::random_device{}()),
-      normal_ (0.0, 1.0)
+      normal_ (seed),
+      z_ (3 * n)
   {
     // do nothing
   }
 
-  Individual mutate(Individual individual, const Codec& codec) override
+  void mutateRow(double* value, double* sigma) override
   {
-    EvolutionParams& evParams = individual.second;    
-
-    double baseMutation = tauPrime_ * normal_(g_);
+    std::size_t n = n_;
+    double baseMutation = tauPrime_ * normal_();
+
+    // z_ holds the samples for the sigmas, those for the values and the
+    // scratch space of the sigma kernel
+    normal_.fill(z_.data(), 2 * n);
+    selfAdaptSigmas(sigma, z_.data(), n, baseMutation, tau_,
+                    epsilon0_, (max_ - min_)/2, z_.data() + 2 * n);
+    perturb(value, sigma, z_.data() + n, n, min_, max_);
+  }
 
-    for (std::size_t i = 0; i < n_; ++i)
-    {
-      double& oldSigma = evParams.sigma[i];
-      double& oldValue = evParams.value[i];
-      double coordinateSpecificMutation = tau_* normal_(g_);
-      double newSigma = oldSigma * exp(baseMutation + coordinateSpecificMutation);
-      newSigma = std::min(std::max(epsilon0_, newSigma), (max_ - min_)/2);
-      double newValue = std::max(std::min(oldValue + newSigma * normal_(g_), max_), min_);
-      evParams.value[i] = newValue;
-      evParams.sigma[i] = newSigma;
-    }
-    return std::move(individual);
+  void mutateInPlace(Individual& individual,
+                     const Codec&,
+                     MutatedRegion* region = nullptr) override
+  {
+    EvolutionParams& evParams = individual.second;    
+    mutateRow(evParams.value.data(), evParams.sigma.data());
+    evParams.evaluated = false;
+    reportMutation(region, VALUE_LOCUS, 0, n_);
+    reportMutation(region, SIGMA_LOCUS, 0, n_);
   }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-struct LocalRecombination : public CombinationStrategy
-
+struct LocalRecombination : public CombinationStrategy, public RowCombination
 {
-  std::mt19937 g_;
-  std::bernoulli_distribution dist_;
+  std::mt19937_64 g_;
+
+  void combine(const double* value1, const double* sigma1,
+               const double* value2, const double* sigma2,
+               double* value, double* sigma,
+               std::size_t n, std::size_t nSigma) override
+  {
+    // Discrete recombination for the values
+    discreteRecombination(value1, value2, value, n, g_);
+
+    // Intermediary recombination for strategy params
+    intermediateRecombination(sigma1, sigma2, sigma, nSigma);
+  }
 
   Individual combine(const Individual& individual1,
                      const Individual& individual2,
-                     const Codec& codec) override
+                     const Codec&) override
   {
-    std::size_t n = individual1.second.value.size();
-    std::size_t nSigma = individual1.second.sigma.size();
+    const EvolutionParams& p1 = individual1.second;
+    const EvolutionParams& p2 = individual2.second;
     Individual result;
-    result.second.value.reserve(n);
-    result.second.sigma.reserve(nSigma);
+    result.second.value.resize(p1.value.size());
+    result.second.sigma.resize(p1.sigma.size());
+    combine(p1.value.data(), p1.sigma.data(),
+            p2.value.data(), p2.sigma.data(),
+            result.second.value.data(), result.second.sigma.data(),
+            p1.value.size(), p1.sigma.size());
+    return result;
+  }
+};
 
-    // Discrete recombination for the values
-    for (std::size_t k = 0; k < n; ++k)
+///////////////////////////////////////////////////////////////////////////////
+// Indices of the 'count' individuals with the highest fitness, best first
+inline std::vector<PopulationIndex> bestIndices(const PopulationFitness& fitness,
+                                                std::size_t count)
+{
+  std::vector<PopulationIndex> indices(fitness.size());
+  for (PopulationIndex k = 0; k < indices.size(); ++k) indices[k] = k;
+  count = std::min(count, indices.size());
+  std::partial_sort(indices.begin(), indices.begin() + count, indices.end(),
+                    [&fitness](PopulationIndex a, PopulationIndex b)
+                    { return fitness[a] > fitness[b]; });
+  indices.resize(count);
+  return indices;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Evaluates the individuals that do not carry their fitness yet. They are
+// moved to a separate population for the call when only some of them are
+// pending.
+inline void evaluate(FitnessFunction& function, Population& population)
+{
+  std::vector<PopulationIndex> pending;
+  for (PopulationIndex k = 0; k < population.size(); ++k)
+  {
+    if (!population[k].second.evaluated) pending.push_back(k);
+  }
+  if (pending.empty()) return;
+
+  PopulationFitness fitness;
+  if (pending.size() == population.size())
+  {
+    fitness = function.calculate(population);
+  }
+  else
+  {
+    Population subset; subset.reserve(pending.size());
+    for (PopulationIndex k : pending) subset.push_back(std::move(population[k]));
+    fitness = function.calculate(subset);
+    for (std::size_t i = 0; i < pending.size(); ++i)
     {
-      bool useFirst = dist_(g_);
-      result.second.value.push_back((useFirst? individual1 : individual2).second.value[k]);
+      population[pending[i]] = std::move(subset[i]);
     }
+  }
 
-    // Intermediary recombination for strategy params
-    for (std::size_t k = 0; k < nSigma; ++k)
+  for (std::size_t i = 0; i < pending.size(); ++i)
+  {
+    EvolutionParams& evParams = population[pending[i]].second;
+    evParams.fitness = fitness[i];
+    evParams.evaluated = true;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void evaluate(RowFitness& function, SoaPopulation& population)
+{
+  if (!population.evaluated()) population.fitness = function.calculate(population);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Moves the 'count' fittest individuals, which must be evaluated, out of
+// 'population', best first
+inline Population takeBest(Population&& population, std::size_t count)
+{
+  PopulationFitness fitness; fitness.reserve(population.size());
+  for (const Individual& individual : population) fitness.push_back(individual.second.fitness);
+
+  Population result; result.reserve(count);
+  for (PopulationIndex k : bestIndices(fitness, count))
+  {
+    result.push_back(std::move(population[k]));
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Diversity of the values from their per-coordinate variance, gathered in
+// one pass: the mean squared euclidean distance between two individuals is
+// twice the sum of the variances, times n / (n - 1).
+struct ValueDiversity : public gene::DiversityEstimator<EvolutionParams>
+{
+  void clear() override { coordinates_.clear(); individuals_ = 0; }
+
+  void add(const EvolutionParams& evParams) override
+  {
+    if (evParams.value.size() > coordinates_.size()) coordinates_.resize(evParams.value.size());
+    for (std::size_t j = 0; j < evParams.value.size(); ++j)
     {
-      double val = (individual1.second.sigma[k] + individual2.second.sigma[k]) / 2.0;
-      result.second.sigma.push_back(val);
+      coordinates_[j].add(evParams.value[j]);
     }
-    return std::move(result);
+    ++individuals_;
   }
+
+  gene::Diversity estimate() override
+  {
+    gene::Diversity result;
+    if (individuals_ < 2) return result;
+    double variance = 0;
+    for (const RunningStatistics& coordinate : coordinates_) variance += coordinate.variance();
+    result.meanDistance = 2 * variance * individuals_ / (individuals_ - 1);
+    return result;
+  }
+
+  private:
+    std::vector<RunningStatistics> coordinates_;
+    std::size_t individuals_ = 0;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
+// Survival policies evaluate only the individuals that do not carry their
+// fitness yet, and store it in them.
 struct SurvivalPolicy
 {
+  // Next generation, moved out of the previous one and the offspring
   virtual Population selectSurvivors (FitnessFunction& function,
-                                      const Population& previousGeneration,
-                                      const Population& offspring) = 0;
+                                      Population&& previousGeneration,
+                                      Population&& offspring) = 0;
+
+  // Individuals of the next generation, as indices into the previous
+  // generation followed by the offspring, whose rows are evaluated as
+  // needed
+  virtual std::vector<PopulationIndex> selectRows (RowFitness& function,
+                                                   SoaPopulation& previousGeneration,
+                                                   SoaPopulation& offspring) = 0;
   virtual ~SurvivalPolicy() { }
 };
 
@@ -172,18 +354,28 @@ struct SurvivalPolicy
 struct MuPlusLambda : public SurvivalPolicy
 {
   Population selectSurvivors (FitnessFunction& function,
-                              const Population& previousGeneration,
-                              const Population& offspring) override
+                              Population&& previousGeneration,
+                              Population&& offspring) override
   {
     std::size_t size = previousGeneration.size();
+    evaluate(function, previousGeneration);
+    evaluate(function, offspring);
 
-    Population together (previousGeneration);
-    together.insert(together.end(), offspring.begin(), offspring.end());
-    gene::PopulationFitness fitness = function.calculate(together);
+    previousGeneration.insert(previousGeneration.end(),
+                              std::make_move_iterator(offspring.begin()),
+                              std::make_move_iterator(offspring.end()));
+    return takeBest(std::move(previousGeneration), size);
+  }
 
-    gene::TruncationSelection<Void, EvolutionParams> truncation(size);
-    gene::Survivors survivors = std::move(truncation.selectSurvivors(together, fitness));
-    return std::move(truncation.select(std::move(together), survivors));
+  std::vector<PopulationIndex> selectRows (RowFitness& function,
+                                           SoaPopulation& previousGeneration,
+                                           SoaPopulation& offspring) override
+  {
+    evaluate(function, previousGeneration);
+    evaluate(function, offspring);
+    gene::PopulationFitness fitness (previousGeneration.fitness);
+    fitness.insert(fitness.end(), offspring.fitness.begin(), offspring.fitness.end());
+    return bestIndices(fitness, previousGeneration.size());
   }
 };
 
@@ -191,18 +383,31 @@ struct MuPlusLambda : public SurvivalPolicy
 struct MuCommaLambda : public SurvivalPolicy
 {
   Population selectSurvivors (FitnessFunction& function,
-                              const Population& previousGeneration,
-                              const Population& offspring) override
+                              Population&& previousGeneration,
+                              Population&& offspring) override
   {
     std::size_t size = previousGeneration.size();
-    gene::TruncationSelection<Void, EvolutionParams> truncation(size);
-    gene::PopulationFitness fitness = function.calculate(offspring);
-    gene::Survivors survivors = std::move(truncation.selectSurvivors(offspring, fitness));
-    Population offspringCopy (offspring);
-    return std::move(truncation.select(std::move(offspringCopy), survivors));
+    evaluate(function, offspring);
+    return takeBest(std::move(offspring), size);
+  }
+
+  std::vector<PopulationIndex> selectRows (RowFitness& function,
+                                           SoaPopulation& previousGeneration,
+                                           SoaPopulation& offspring) override
+  {
+    evaluate(function, offspring);
+    std::vector<PopulationIndex> rows =
+       bestIndices(offspring.fitness, previousGeneration.size());
+    for (PopulationIndex& row : rows) row += previousGeneration.size();
+    return rows;
   }
 };
 
+// conversions between the individual and the structure of arrays layouts,
+// defined below
+inline SoaPopulation toSoaPopulation(const Population& population);
+inline Population toPopulation(const SoaPopulation& population);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Void implementation of codec
 struct NullCodec : public Codec
@@ -212,7 +417,8 @@ struct NullCodec : public Codec
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-// Implements the evolution strategy optimization
+// Implements the evolution strategy optimization. The observer, if any,
+// sees each new generation with the fitness its individuals carry.
 struct EvolutionStrategies
 {
   private:
@@ -223,6 +429,21 @@ struct EvolutionStrategies
     MutationStrategy& mutationStrategy_;
     CombinationStrategy& combinationStrategy_;
     SurvivalPolicy& survivalPolicy_;
+    RowFitness* rowFitness_;
+    RowMutation* rowMutation_;
+    RowCombination* rowCombination_;
+    std::mt19937 g_;
+    GenerationObserver* observer_;
+
+    // Passes the survivors, which carry their fitness, to the observer
+    Population observe(Population&& population)
+    {
+      if (observer_ == nullptr) return std::move(population);
+      PopulationFitness fitness; fitness.reserve(population.size());
+      for (const Individual& individual : population) fitness.push_back(individual.second.fitness);
+      observer_->observe(population, fitness);
+      return std::move(population);
+    }
 
   public:
 
@@ -230,13 +451,19 @@ struct EvolutionStrategies
                          MutationStrategy& mutationStrategy,
                          CombinationStrategy& combinationStrategy,
                          SurvivalPolicy& survivalPolicy,
-                         std::size_t offspringCount)
+                         std::size_t offspringCount,
+                         GenerationObserver* observer = nullptr)
       : offspringCount_(offspringCount),
         matingStrategy_(offspringCount),
         fitnessFunction_(fitnessFunction),
         mutationStrategy_(mutationStrategy),
         combinationStrategy_(combinationStrategy),
-        survivalPolicy_(survivalPolicy) { /* do nothing */ }
+        survivalPolicy_(survivalPolicy),
+        rowFitness_(dynamic_cast<RowFitness*>(&fitnessFunction)),
+        rowMutation_(dynamic_cast<RowMutation*>(&mutationStrategy)),
+        rowCombination_(dynamic_cast<RowCombination*>(&combinationStrategy)),
+        g_(std::random_device{}()),
+        observer_(observer) { /* do nothing */ }
 
     Population iterate(Population&& population)
     {
@@ -266,14 +493,111 @@ struct EvolutionStrategies
       // Mutate offspring with probability 1.
       for (std::size_t k = 0; k < offspringCount_; ++k)
       {
-        offspring[k] = mutationStrategy_.mutate(offspring[k], nullCodec);
+        mutationStrategy_.mutateInPlace(offspring[k], nullCodec);
+      }
+
+      // Survivors are moved out of the population and the offspring
+      return observe(survivalPolicy_.selectSurvivors(fitnessFunction_,
+                                                     std::move(population),
+                                                     std::move(offspring)));
+    }
+
+    // Same as above with an asynchronous fitness function. Each offspring
+    // is submitted as soon as it is bred, so that its evaluation overlaps
+    // breeding the rest, and the survival policy finds them all evaluated.
+    Population iterate(Population&& population, AsyncFitnessFunction& fitnessFunction)
+    {
+      NullCodec nullCodec;
+      std::vector<std::pair<Individual*, std::future<FitnessType>>> pending;
+
+      for (Individual& individual : population)
+      {
+        if (!individual.second.evaluated)
+        {
+          pending.emplace_back(&individual, fitnessFunction.submit(individual));
+        }
+      }
+
+      PopulationFitness emptyFitness;
+      auto mating = matingStrategy_.mating(population, emptyFitness);
+
+      // reserved up front, as pending keeps pointers into it
+      std::size_t count = 0;
+      for (const auto& entry : mating) count += std::get<2>(entry);
+      Population offspring; offspring.reserve(count);
+      for (const auto& entry : mating)
+      {
+        const Individual& i1 = population[std::get<0>(entry)];
+        const Individual& i2 = population[std::get<1>(entry)];
+
+        for (std::size_t k = 0; k < std::get<2>(entry); ++k)
+        {
+          offspring.push_back(combinationStrategy_.combine(i1, i2, nullCodec));
+          mutationStrategy_.mutateInPlace(offspring.back(), nullCodec);
+          pending.emplace_back(&offspring.back(), fitnessFunction.submit(offspring.back()));
+        }
+      }
+
+      for (auto& entry : pending)
+      {
+        entry.first->second.fitness = entry.second.get();
+        entry.first->second.evaluated = true;
+      }
+
+      return observe(survivalPolicy_.selectSurvivors(fitnessFunction_,
+                                                     std::move(population),
+                                                     std::move(offspring)));
+    }
+
+    // Same as iterate(Population&&) on a SoaPopulation. The fitness
+    // function, mutation and combination must implement RowFitness,
+    // RowMutation and RowCombination.
+    SoaPopulation iterate(SoaPopulation&& population)
+    {
+      if (rowFitness_ == nullptr || rowMutation_ == nullptr || rowCombination_ == nullptr)
+      {
+        throw std::invalid_argument("operators do not support SoaPopulation");
+      }
+
+      std::size_t n = population.dimension();
+      std::size_t nSigma = population.sigmaCount();
+      std::uniform_int_distribution<std::size_t> parent(0, population.size() - 1);
+
+      // Combine random pairs and mutate the offspring with probability 1.
+      SoaPopulation offspring(offspringCount_, n, nSigma);
+      for (std::size_t k = 0; k < offspringCount_; ++k)
+      {
+        std::size_t index1 = parent(g_);
+        std::size_t index2 = parent(g_);
+        rowCombination_->combine(population.value(index1), population.sigma(index1),
+                                 population.value(index2), population.sigma(index2),
+                                 offspring.value(k), offspring.sigma(k),
+                                 n, nSigma);
+        rowMutation_->mutateRow(offspring.value(k), offspring.sigma(k));
       }
 
-      // Use offspring as base for the new population...
-      Population newPopulation =
-         survivalPolicy_.selectSurvivors(fitnessFunction_, population, offspring);
+      std::vector<PopulationIndex> rows =
+         survivalPolicy_.selectRows(*rowFitness_, population, offspring);
 
-      return std::move(newPopulation);
+      // survivors keep the fitness computed for them
+      SoaPopulation newPopulation(rows.size(), n, nSigma);
+      newPopulation.fitness.resize(rows.size());
+      for (std::size_t k = 0; k < rows.size(); ++k)
+      {
+        if (rows[k] < population.size())
+        {
+          newPopulation.copyIndividual(k, population, rows[k]);
+        }
+        else
+        {
+          newPopulation.copyIndividual(k, offspring, rows[k] - population.size());
+        }
+      }
+      if (observer_ != nullptr)
+      {
+        observer_->observe(toPopulation(newPopulation), newPopulation.fitness);
+      }
+      return newPopulation;
     }
 };
 
@@ -282,19 +606,41 @@ struct EvolutionStrategies
 // Adapts a normal function to the fitnessfunction interface
 using Function = std::function<double(const std::vector<double>&)>;
 struct FitnessAdapter : public gene::FitnessFunction<gene::evstrat::Void,
-                                              gene::evstrat::EvolutionParams>
+                                              gene::evstrat::EvolutionParams>,
+                        public RowFitness
 {
   using Population = gene::Population<gene::evstrat::Void, gene::evstrat::EvolutionParams>;
 
   Function function_;
 
   FitnessAdapter(Function f) : function_(f) { }
+
+  gene::PopulationFitness calculate(const SoaPopulation& population) override
+  {
+    gene::PopulationFitness fitness(population.size());
+    calculate(population, 0, population.size(), fitness.data());
+    return fitness;
+  }
+
+  // Thread safe as long as the function is
+  void calculate(const SoaPopulation& population,
+                 std::size_t begin,
+                 std::size_t end,
+                 FitnessType* out) override
+  {
+    std::vector<double> row(population.dimension());
+    for (std::size_t k = begin; k < end; ++k)
+    {
+      std::copy(population.value(k), population.value(k) + row.size(), row.begin());
+      out[k - begin] = -function_(row);
+    }
+  }
   
   gene::PopulationFitness calculate(const Population& population) override
   {
     gene::PopulationFitness fitness;
     fitness.reserve(population.size());
-    for (auto individual : population)
+    for (const auto& individual : population)
     {
       const gene::evstrat::EvolutionParams& evParams = individual.second;
       fitness.push_back(-function_(evParams.value));
@@ -305,14 +651,15 @@ struct FitnessAdapter : public gene::FitnessFunction<gene::evstrat::Void,
 
 ///////////////////////////////////////////////////////////////////////////////
 // generates a random population
-gene::evstrat::Population randomPopulation(std::size_t numVars,
-                                           std::size_t populationSize,
-                                           double minValue,
-                                           double maxValue,
-                                           double sigma,
-                                           std::size_t numSigmas)
+inline gene::evstrat::Population randomPopulation(std::size_t numVars,
+                                                  std::size_t populationSize,
+                                                  double minValue,
+                                                  double maxValue,
+                                                  double sigma,
+                                                  std::size_t numSigmas,
+                                                  uint32_t seed = std::mt19937::default_seed)
 {
-  std::mt19937 g;
+  std::mt19937 g(seed);
   std::uniform_real_distribution<double> random(minValue, maxValue);
 
   gene::evstrat::Population result; result.reserve(populationSize);
@@ -334,5 +681,47 @@ gene::evstrat::Population randomPopulation(std::size_t numVars,
   return std::move(result);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// conversions between the individual and the structure of arrays layouts
+inline SoaPopulation toSoaPopulation(const Population& population)
+{
+  std::size_t n = population.empty() ? 0 : population[0].second.value.size();
+  std::size_t nSigma = population.empty() ? 0 : population[0].second.sigma.size();
+  SoaPopulation result(population.size(), n, nSigma);
+  for (std::size_t k = 0; k < population.size(); ++k)
+  {
+    const EvolutionParams& evParams = population[k].second;
+    std::copy(evParams.value.begin(), evParams.value.end(), result.value(k));
+    std::copy(evParams.sigma.begin(), evParams.sigma.end(), result.sigma(k));
+  }
+  bool evaluated = std::all_of(population.begin(), population.end(),
+                               [](const Individual& i) { return i.second.evaluated; });
+  if (evaluated)
+  {
+    for (const Individual& individual : population)
+    {
+      result.fitness.push_back(individual.second.fitness);
+    }
+  }
+  return result;
+}
+
+inline Population toPopulation(const SoaPopulation& population)
+{
+  Population result(population.size());
+  for (std::size_t k = 0; k < population.size(); ++k)
+  {
+    EvolutionParams& evParams = result[k].second;
+    evParams.value.assign(population.value(k), population.value(k) + population.dimension());
+    evParams.sigma.assign(population.sigma(k), population.sigma(k) + population.sigmaCount());
+    if (population.evaluated())
+    {
+      evParams.fitness = population.fitness[k];
+      evParams.evaluated = true;
+    }
+  }
+  return result;
+}
+
 }}
 #endif
@@ -0,0 +1,444 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_CMAES_HEADER_SEEN__
+#define GENE_EVSTRAT_CMAES_HEADER_SEEN__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gene/evstrat.hpp"
+
+namespace gene{ namespace evstrat {
+
+///////////////////////////////////////////////////////////////////////////////
+// Householder reduction of a symmetric matrix to tridiagonal form, followed
+// by the QL algorithm (tred2 and tql2 from JAMA, in the public domain).
+// On input 'a' holds the matrix; on output its rows are the eigenvectors
+// and 'values' the corresponding eigenvalues, unsorted. The algorithms are
+// run on the transpose of JAMA's layout, which the symmetry of the input
+// allows, so that their inner loops go along contiguous rows.
+inline void symmetricEigen(Matrix& a, std::vector<double>& values)
+{
+  std::size_t n = a.rows();
+  std::vector<double>& d = values;
+  std::vector<double> e(n, 0.0);
+  d.assign(n, 0.0);
+  if (n == 0) return;
+
+  // tred2: a(j, k) below stands for V[k][j] in JAMA
+  for (std::size_t j = 0; j < n; ++j) d[j] = a(j, n - 1);
+
+  for (std::size_t i = n - 1; i > 0; --i)
+  {
+    double scale = 0.0;
+    double h = 0.0;
+    for (std::size_t k = 0; k < i; ++k) scale += std::abs(d[k]);
+
+    if (scale == 0.0)
+    {
+      e[i] = d[i - 1];
+      for (std::size_t j = 0; j < i; ++j)
+      {
+        d[j] = a(j, i - 1);
+        a(j, i) = 0.0;
+        a(i, j) = 0.0;
+      }
+    }
+    else
+    {
+      for (std::size_t k = 0; k < i; ++k)
+      {
+        d[k] /= scale;
+        h += d[k] * d[k];
+      }
+      double f = d[i - 1];
+      double g = std::sqrt(h);
+      if (f > 0) g = -g;
+      e[i] = scale * g;
+      h = h - f * g;
+      d[i - 1] = f - g;
+      for (std::size_t j = 0; j < i; ++j) e[j] = 0.0;
+
+      for (std::size_t j = 0; j < i; ++j)
+      {
+        f = d[j];
+        a(i, j) = f;
+        double* row = a.row(j);
+        g = e[j] + row[j] * f;
+        for (std::size_t k = j + 1; k < i; ++k)
+        {
+          g += row[k] * d[k];
+          e[k] += row[k] * f;
+        }
+        e[j] = g;
+      }
+
+      f = 0.0;
+      for (std::size_t j = 0; j < i; ++j)
+      {
+        e[j] /= h;
+        f += e[j] * d[j];
+      }
+      double hh = f / (h + h);
+      for (std::size_t j = 0; j < i; ++j) e[j] -= hh * d[j];
+
+      for (std::size_t j = 0; j < i; ++j)
+      {
+        f = d[j];
+        g = e[j];
+        double* row = a.row(j);
+        for (std::size_t k = j; k < i; ++k) row[k] -= (f * e[k] + g * d[k]);
+        d[j] = row[i - 1];
+        row[i] = 0.0;
+      }
+    }
+    d[i] = h;
+  }
+
+  // accumulate the transformations
+  for (std::size_t i = 0; i + 1 < n; ++i)
+  {
+    a(i, n - 1) = a(i, i);
+    a(i, i) = 1.0;
+    double h = d[i + 1];
+    double* next = a.row(i + 1);
+    if (h != 0.0)
+    {
+      for (std::size_t k = 0; k <= i; ++k) d[k] = next[k] / h;
+      for (std::size_t j = 0; j <= i; ++j)
+      {
+        double* row = a.row(j);
+        double g = 0.0;
+        for (std::size_t k = 0; k <= i; ++k) g += next[k] * row[k];
+        for (std::size_t k = 0; k <= i; ++k) row[k] -= g * d[k];
+      }
+    }
+    for (std::size_t k = 0; k <= i; ++k) next[k] = 0.0;
+  }
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    d[j] = a(j, n - 1);
+    a(j, n - 1) = 0.0;
+  }
+  a(n - 1, n - 1) = 1.0;
+  e[0] = 0.0;
+
+  // tql2
+  for (std::size_t i = 1; i < n; ++i) e[i - 1] = e[i];
+  e[n - 1] = 0.0;
+
+  double f = 0.0;
+  double tst1 = 0.0;
+  const double eps = std::numeric_limits<double>::epsilon();
+  for (std::size_t l = 0; l < n; ++l)
+  {
+    tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+    std::size_t m = l;
+    while (m < n && std::abs(e[m]) > eps * tst1) ++m;
+    if (m == n) m = n - 1;
+
+    if (m > l)
+    {
+      do
+      {
+        double g = d[l];
+        double p = (d[l + 1] - g) / (2.0 * e[l]);
+        double r = std::hypot(p, 1.0);
+        if (p < 0) r = -r;
+        d[l] = e[l] / (p + r);
+        d[l + 1] = e[l] * (p + r);
+        double dl1 = d[l + 1];
+        double h = g - d[l];
+        for (std::size_t i = l + 2; i < n; ++i) d[i] -= h;
+        f = f + h;
+
+        p = d[m];
+        double c = 1.0;
+        double c2 = c;
+        double c3 = c;
+        double el1 = e[l + 1];
+        double s = 0.0;
+        double s2 = 0.0;
+        for (std::size_t i = m; i-- > l; )
+        {
+          c3 = c2;
+          c2 = c;
+          s2 = s;
+          g = c * e[i];
+          h = c * p;
+          r = std::hypot(p, e[i]);
+          e[i + 1] = s * r;
+          s = e[i] / r;
+          c = p / r;
+          p = c * d[i] - s * g;
+          d[i + 1] = h + s * (c * g + s * d[i]);
+
+          double* v0 = a.row(i);
+          double* v1 = a.row(i + 1);
+          for (std::size_t k = 0; k < n; ++k)
+          {
+            double t = v1[k];
+            v1[k] = s * v0[k] + c * t;
+            v0[k] = c * v0[k] - s * t;
+          }
+        }
+        p = -s * s2 * c3 * el1 * e[l] / dl1;
+        e[l] = s * p;
+        d[l] = c * p;
+      }
+      while (std::abs(e[l]) > eps * tst1);
+    }
+    d[l] = d[l] + f;
+    e[l] = 0.0;
+  }
+}
+
+/******************************************************************************
+ * Covariance matrix adaptation evolution strategy, (mu/mu_w, lambda)-CMA-ES
+ * with cumulative step size control and rank-one plus rank-mu covariance
+ * updates, following Hansen's tutorial and its default parameters.
+ * The search distribution starts at start.value with step size
+ * start.sigma[0], and is reported back as EvolutionParams by
+ * distribution(). Fitness is maximized, as in the rest of the library
+ * (FitnessAdapter negates the function it wraps).
+ * Samples are drawn as rows of contiguous matrices, and the covariance is
+ * only decomposed every few generations, when the updates since the last
+ * decomposition add up to a noticeable change. The observer, if any, sees
+ * the samples of each generation once evaluated.
+ *****************************************************************************/
+struct CmaEs
+{
+  CmaEs(FitnessFunction& fitnessFunction,
+        const EvolutionParams& start,
+        std::size_t lambda = 0,
+        uint64_t seed = std::random_device{}(),
+        GenerationObserver* observer = nullptr)
+    : fitnessFunction_(fitnessFunction),
+      rowFitness_(dynamic_cast<RowFitness*>(&fitnessFunction)),
+      n_(start.value.size()),
+      lambda_(lambda != 0 ? lambda : 4 + std::size_t(3 * std::log(std::max(double(n_), 1.0)))),
+      mu_(lambda_ / 2),
+      weights_(mu_),
+      mean_(start.value),
+      sigma_(start.sigma.empty() ? 1.0 : start.sigma[0]),
+      pc_(n_, 0.0),
+      ps_(n_, 0.0),
+      c_(n_, n_),
+      b_(n_, n_),
+      d_(n_, 1.0),
+      z_(lambda_, n_),
+      steps_(mu_, n_),
+      samples_(lambda_, n_, 1),
+      generation_(0),
+      decomposedAt_(0),
+      bestFitness_(-std::numeric_limits<FitnessType>::infinity()),
+      normal_(seed),
+      observer_(observer)
+  {
+    if (n_ == 0) throw std::invalid_argument("empty start point");
+    if (lambda_ < 2) throw std::invalid_argument("lambda must be at least 2");
+
+    double n = n_;
+    for (std::size_t i = 0; i < mu_; ++i) weights_[i] = std::log(mu_ + 0.5) - std::log(i + 1.0);
+    double sum = std::accumulate(weights_.begin(), weights_.end(), 0.0);
+    double squares = 0.0;
+    for (double& w : weights_)
+    {
+      w /= sum;
+      squares += w * w;
+    }
+    mueff_ = 1.0 / squares;
+
+    cc_ = (4 + mueff_ / n) / (n + 4 + 2 * mueff_ / n);
+    cs_ = (mueff_ + 2) / (n + mueff_ + 5);
+    c1_ = 2 / ((n + 1.3) * (n + 1.3) + mueff_);
+    cmu_ = std::min(1 - c1_, 2 * (mueff_ - 2 + 1 / mueff_) / ((n + 2) * (n + 2) + mueff_));
+    damps_ = 1 + 2 * std::max(0.0, std::sqrt((mueff_ - 1) / (n + 1)) - 1) + cs_;
+    chiN_ = std::sqrt(n) * (1 - 1 / (4 * n) + 1 / (21 * n * n));
+
+    for (std::size_t i = 0; i < n_; ++i)
+    {
+      c_(i, i) = 1.0;
+      b_(i, i) = 1.0;
+    }
+  }
+
+  // Samples, evaluates and selects one generation, then adapts the
+  // distribution. Returns the fitness of the samples, in order.
+  const PopulationFitness& iterate()
+  {
+    std::size_t n = n_;
+    if (double(generation_ - decomposedAt_) > lambda_ / (c1_ + cmu_) / n / 10) decompose();
+
+    // x_k = mean + sigma * B * (D o z_k). Each eigenvector is loaded once
+    // and added to all the samples, which stay in cache
+    normal_.fill(z_.data(), z_.rows() * z_.stride());
+    for (std::size_t k = 0; k < lambda_; ++k)
+    {
+      std::copy(mean_.begin(), mean_.end(), samples_.value(k));
+      samples_.sigma(k)[0] = sigma_;
+    }
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      const double* eigenvector = b_.row(j);
+      double scale = sigma_ * d_[j];
+      for (std::size_t k = 0; k < lambda_; ++k)
+      {
+        double* x = samples_.value(k);
+        double zj = scale * z_(k, j);
+        for (std::size_t i = 0; i < n; ++i) x[i] += zj * eigenvector[i];
+      }
+    }
+
+    evaluate();
+    if (observer_ != nullptr) observer_->observe(toPopulation(samples_), fitness_);
+    std::vector<PopulationIndex> ranking = bestIndices(fitness_, mu_);
+    if (fitness_[ranking[0]] > bestFitness_)
+    {
+      bestFitness_ = fitness_[ranking[0]];
+      best_.assign(samples_.value(ranking[0]), samples_.value(ranking[0]) + n);
+    }
+
+    // weighted means of the selected steps y and of their samples z
+    std::vector<double> oldMean(mean_);
+    std::vector<double> zmean(n, 0.0);
+    std::fill(mean_.begin(), mean_.end(), 0.0);
+    for (std::size_t i = 0; i < mu_; ++i)
+    {
+      const double* x = samples_.value(ranking[i]);
+      const double* z = z_.row(ranking[i]);
+      for (std::size_t j = 0; j < n; ++j)
+      {
+        mean_[j] += weights_[i] * x[j];
+        zmean[j] += weights_[i] * z[j];
+      }
+    }
+
+    // step size path: C^(-1/2) * ymean = B * zmean
+    double csn = std::sqrt(cs_ * (2 - cs_) * mueff_);
+    for (double& p : ps_) p *= 1 - cs_;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      const double* eigenvector = b_.row(j);
+      for (std::size_t i = 0; i < n; ++i) ps_[i] += csn * zmean[j] * eigenvector[i];
+    }
+    double psNorm = std::sqrt(std::inner_product(ps_.begin(), ps_.end(), ps_.begin(), 0.0));
+    ++generation_;
+    bool hsig = psNorm / std::sqrt(1 - std::pow(1 - cs_, 2.0 * generation_)) / chiN_
+                < 1.4 + 2 / (n + 1.0);
+
+    // covariance path
+    double ccn = std::sqrt(cc_ * (2 - cc_) * mueff_);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      pc_[i] = (1 - cc_) * pc_[i] + (hsig ? ccn * (mean_[i] - oldMean[i]) / sigma_ : 0.0);
+    }
+
+    // rank-one and rank-mu updates, on the upper triangle only and a row of
+    // C at a time
+    double decay = 1 - c1_ - cmu_ + (hsig ? 0.0 : c1_ * cc_ * (2 - cc_));
+    for (std::size_t k = 0; k < mu_; ++k)
+    {
+      const double* x = samples_.value(ranking[k]);
+      double* y = steps_.row(k);
+      for (std::size_t i = 0; i < n; ++i) y[i] = (x[i] - oldMean[i]) / sigma_;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double* row = c_.row(i);
+      double pci = c1_ * pc_[i];
+      for (std::size_t j = i; j < n; ++j) row[j] = decay * row[j] + pci * pc_[j];
+      for (std::size_t k = 0; k < mu_; ++k)
+      {
+        const double* y = steps_.row(k);
+        double wyi = cmu_ * weights_[k] * y[i];
+        for (std::size_t j = i; j < n; ++j) row[j] += wyi * y[j];
+      }
+    }
+
+    sigma_ *= std::exp((cs_ / damps_) * (psNorm / chiN_ - 1));
+    return fitness_;
+  }
+
+  // Current search distribution: mean and overall step size
+  EvolutionParams distribution() const
+  {
+    EvolutionParams result;
+    result.value = mean_;
+    result.sigma.assign(1, sigma_);
+    return result;
+  }
+
+  // Samples of the last generation, with sigma set to the step size used
+  const SoaPopulation& samples() const { return samples_; }
+
+  const std::vector<double>& best() const { return best_; }
+  FitnessType bestFitness() const { return bestFitness_; }
+  std::size_t lambda() const { return lambda_; }
+  std::size_t generation() const { return generation_; }
+
+  private:
+
+    void evaluate()
+    {
+      if (rowFitness_ != nullptr)
+      {
+        fitness_ = rowFitness_->calculate(samples_);
+      }
+      else
+      {
+        fitness_ = fitnessFunction_.calculate(toPopulation(samples_));
+      }
+    }
+
+    // B and D from the eigendecomposition of C = B * D^2 * B^T
+    void decompose()
+    {
+      decomposedAt_ = generation_;
+      std::size_t n = n_;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        b_.copyRow(i, c_, i);
+        for (std::size_t j = 0; j < i; ++j) b_(i, j) = c_(j, i);
+      }
+      symmetricEigen(b_, d_);
+      for (double& d : d_) d = std::sqrt(std::max(d, std::numeric_limits<double>::min()));
+    }
+
+    FitnessFunction& fitnessFunction_;
+    RowFitness* rowFitness_;
+    const std::size_t n_;
+    const std::size_t lambda_;
+    const std::size_t mu_;
+    std::vector<double> weights_;
+    double mueff_, cc_, cs_, c1_, cmu_, damps_, chiN_;
+
+    std::vector<double> mean_;
+    double sigma_;
+    std::vector<double> pc_;
+    std::vector<double> ps_;
+    Matrix c_;    // covariance, upper triangle
+    Matrix b_;    // eigenvectors, as rows
+    std::vector<double> d_;    // square roots of the eigenvalues
+
+    Matrix z_;
+    Matrix steps_;    // selected steps y = (x - mean) / sigma
+    SoaPopulation samples_;
+    PopulationFitness fitness_;
+    std::size_t generation_;
+    std::size_t decomposedAt_;
+    std::vector<double> best_;
+    FitnessType bestFitness_;
+    NormalGenerator normal_;
+    GenerationObserver* observer_;
+};
+
+}}
+#endif
@@ -0,0 +1,279 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_DIFFERENTIAL_HEADER_SEEN__
+#define GENE_EVSTRAT_DIFFERENTIAL_HEADER_SEEN__
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gene/parallel.hpp"
+#include "gene/evstrat.hpp"
+
+namespace gene{ namespace evstrat {
+
+/******************************************************************************
+ * Differential evolution over the rows of a SoaPopulation (sigmas are not
+ * used). Variants:
+ *  - RAND_1_BIN: x_r1 + F * (x_r2 - x_r3)
+ *  - BEST_1_BIN: x_best + F * (x_r1 - x_r2)
+ *  - CURRENT_TO_PBEST_1_BIN: x_i + F_i * (x_pbest - x_i) + F_i * (x_r1 - x_r2),
+ *    with x_pbest among the best 'p' fraction of the population and x_r2
+ *    also drawn from an archive of replaced parents; F_i and CR_i are drawn
+ *    per individual around means adapted from the successful ones (JADE).
+ * all with binomial crossover. Trial vectors are generated into a
+ * contiguous buffer, evaluated in blocks on 'threads' threads (the hardware
+ * concurrency if 0) when the fitness function implements RowFitness, and
+ * replace their targets in place when they are at least as fit. Threads
+ * are started every generation, so objectives that take less than that
+ * to evaluate a population run faster with threads = 1. The observer, if
+ * any, sees the population after each generation.
+ *****************************************************************************/
+struct DifferentialEvolution
+{
+  enum Variant { RAND_1_BIN, BEST_1_BIN, CURRENT_TO_PBEST_1_BIN };
+
+  DifferentialEvolution(FitnessFunction& fitnessFunction,
+                        Variant variant = RAND_1_BIN,
+                        double minValue = std::numeric_limits<double>::lowest(),
+                        double maxValue = std::numeric_limits<double>::max(),
+                        double f = 0.5,
+                        double cr = 0.9,
+                        std::size_t threads = 0,
+                        uint64_t seed = std::random_device{}(),
+                        GenerationObserver* observer = nullptr)
+    : fitnessFunction_(fitnessFunction),
+      rowFitness_(dynamic_cast<RowFitness*>(&fitnessFunction)),
+      variant_(variant),
+      min_(minValue),
+      max_(maxValue),
+      f_(f),
+      cr_(cr),
+      p_(0.1),
+      c_(0.1),
+      threads_(threads == 0 ? hardwareThreads() : threads),
+      g_(seed),
+      words_(seed + 1),
+      normal_(seed + 2),
+      observer_(observer)
+  {
+    // do nothing
+  }
+
+  // Runs one generation, replacing individuals in place
+  SoaPopulation iterate(SoaPopulation&& population)
+  {
+    std::size_t size = population.size();
+    std::size_t n = population.dimension();
+    if (size < 4) throw std::invalid_argument("differential evolution needs 4 individuals");
+
+    if (!population.evaluated())
+    {
+      population.fitness.resize(size);
+      evaluate(population, population.fitness.data());
+    }
+    if (trials_.size() != size || trials_.dimension() != n)
+    {
+      trials_ = SoaPopulation(size, n, 0);
+      archive_ = SoaPopulation(size, n, 0);
+      archiveSize_ = 0;
+    }
+
+    generateTrials(population);
+    evaluate(trials_, trialFitness_.data());
+
+    // selection in place
+    successfulF_.clear();
+    successfulCR_.clear();
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      if (trialFitness_[i] < population.fitness[i]) continue;
+      if (trialFitness_[i] > population.fitness[i] && variant_ == CURRENT_TO_PBEST_1_BIN)
+      {
+        successfulF_.push_back(fs_[i]);
+        successfulCR_.push_back(crs_[i]);
+        archive(population, i);
+      }
+      population.values.copyRow(i, trials_.values, i);
+      population.fitness[i] = trialFitness_[i];
+    }
+    if (variant_ == CURRENT_TO_PBEST_1_BIN) adapt();
+    if (observer_ != nullptr) observer_->observe(toPopulation(population), population.fitness);
+    return std::move(population);
+  }
+
+  // Same as above on the individual layout, through conversions
+  Population iterate(Population&& population)
+  {
+    return toPopulation(iterate(toSoaPopulation(population)));
+  }
+
+  // Current F and CR, the adapted means for CURRENT_TO_PBEST_1_BIN
+  double f() const { return f_; }
+  double cr() const { return cr_; }
+
+  private:
+
+    // Fills trials_ from the population, with the F and CR of each trial in
+    // fs_ and crs_
+    void generateTrials(const SoaPopulation& population)
+    {
+      std::size_t size = population.size();
+      std::size_t n = population.dimension();
+      std::uniform_int_distribution<std::size_t> pick(0, size - 1);
+      std::uniform_int_distribution<std::size_t> coordinate(0, n == 0 ? 0 : n - 1);
+
+      randomWords_.resize(size * n);
+      words_.fill(randomWords_.data(), randomWords_.size());
+      trialFitness_.resize(size);
+      fs_.assign(size, f_);
+      crs_.assign(size, cr_);
+
+      std::vector<PopulationIndex> ranking;
+      std::size_t best = 0;
+      if (variant_ == BEST_1_BIN)
+      {
+        best = bestIndices(population.fitness, 1)[0];
+      }
+      else if (variant_ == CURRENT_TO_PBEST_1_BIN)
+      {
+        ranking = bestIndices(population.fitness,
+                              std::max<std::size_t>(2, std::size_t(p_ * size)));
+      }
+
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        std::size_t r1, r2, r3;
+        do r1 = pick(g_); while (r1 == i);
+        do r2 = pick(g_); while (r2 == i || r2 == r1);
+        do r3 = pick(g_); while (r3 == i || r3 == r1 || r3 == r2);
+
+        const double* target = population.value(i);
+        const double* a = population.value(r1);
+        const double* b = a;
+        const double* c = population.value(r2);
+        const double* d = population.value(r3);
+        double fa = 0;
+        if (variant_ == BEST_1_BIN)
+        {
+          a = b = population.value(best);
+          c = population.value(r1);
+          d = population.value(r2);
+        }
+        else if (variant_ == CURRENT_TO_PBEST_1_BIN)
+        {
+          sampleParameters(i);
+          std::uniform_int_distribution<std::size_t> pbest(0, ranking.size() - 1);
+          std::uniform_int_distribution<std::size_t> united(0, size + archiveSize_ - 1);
+          std::size_t r = united(g_);
+          while (r == i || r == r1) r = united(g_);
+
+          a = target;
+          b = population.value(ranking[pbest(g_)]);
+          fa = fs_[i];
+          c = population.value(r1);
+          d = r < size ? population.value(r) : archive_.value(r - size);
+        }
+
+        uint64_t threshold = uint64_t(crs_[i] * 9007199254740992.0);
+        differentialTrial(target, a, b, fa, c, d, fs_[i],
+                          randomWords_.data() + i * n, threshold, coordinate(g_),
+                          trials_.value(i), n, min_, max_);
+      }
+    }
+
+    // F_i from Cauchy(f_, 0.1) truncated to (0, 1], CR_i from N(cr_, 0.1)
+    // clamped to [0, 1]
+    void sampleParameters(std::size_t i)
+    {
+      std::cauchy_distribution<double> cauchy(f_, 0.1);
+      double f;
+      do f = cauchy(g_); while (f <= 0);
+      fs_[i] = std::min(f, 1.0);
+      crs_[i] = std::min(std::max(cr_ + 0.1 * normal_(), 0.0), 1.0);
+    }
+
+    // Moves the means towards the successful F (Lehmer mean) and CR
+    void adapt()
+    {
+      if (successfulF_.empty()) return;
+      double sum = 0, squares = 0, crSum = 0;
+      for (std::size_t k = 0; k < successfulF_.size(); ++k)
+      {
+        sum += successfulF_[k];
+        squares += successfulF_[k] * successfulF_[k];
+        crSum += successfulCR_[k];
+      }
+      f_ = (1 - c_) * f_ + c_ * squares / sum;
+      cr_ = (1 - c_) * cr_ + c_ * crSum / successfulCR_.size();
+    }
+
+    // Keeps parent i, about to be replaced, in the archive; once full,
+    // a random entry is overwritten
+    void archive(const SoaPopulation& population, std::size_t i)
+    {
+      std::size_t slot = archiveSize_;
+      if (archiveSize_ < archive_.size())
+      {
+        ++archiveSize_;
+      }
+      else
+      {
+        slot = std::uniform_int_distribution<std::size_t>(0, archiveSize_ - 1)(g_);
+      }
+      archive_.values.copyRow(slot, population.values, i);
+    }
+
+    void evaluate(const SoaPopulation& population, FitnessType* out)
+    {
+      if (rowFitness_ == nullptr)
+      {
+        PopulationFitness fitness = fitnessFunction_.calculate(toPopulation(population));
+        std::copy(fitness.begin(), fitness.end(), out);
+        return;
+      }
+
+      std::size_t size = population.size();
+      std::size_t blocks = std::min(threads_, size);
+      RowFitness& function = *rowFitness_;
+      parallelFor(blocks, blocks, [&](std::size_t block)
+      {
+        std::size_t begin = size * block / blocks;
+        std::size_t end = size * (block + 1) / blocks;
+        function.calculate(population, begin, end, out + begin);
+      });
+    }
+
+    FitnessFunction& fitnessFunction_;
+    RowFitness* rowFitness_;
+    const Variant variant_;
+    const double min_;
+    const double max_;
+    double f_;
+    double cr_;
+    const double p_;
+    const double c_;
+    const std::size_t threads_;
+
+    std::mt19937_64 g_;
+    CounterRandom words_;
+    NormalGenerator normal_;
+    GenerationObserver* observer_;
+    std::vector<uint64_t> randomWords_;
+
+    SoaPopulation trials_;
+    PopulationFitness trialFitness_;
+    std::vector<double> fs_;
+    std::vector<double> crs_;
+    std::vector<double> successfulF_;
+    std::vector<double> successfulCR_;
+    SoaPopulation archive_;
+    std::size_t archiveSize_ = 0;
+};
+
+}}
+#endif
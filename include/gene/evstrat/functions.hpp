@@ -0,0 +1,83 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_FUNCTIONS_HEADER_SEEN__
+#define GENE_EVSTRAT_FUNCTIONS_HEADER_SEEN__
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gene/evstrat.hpp"
+
+namespace gene{ namespace evstrat {
+
+/******************************************************************************
+ * Standard test functions to minimize through a FitnessAdapter, all with
+ * their minimum 0 at the origin except Rosenbrock's, at (1, ..., 1).
+ *****************************************************************************/
+inline double sphere(const std::vector<double>& x)
+{
+  double sum = 0;
+  for (double xi : x) sum += xi * xi;
+  return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline double rastrigin(const std::vector<double>& x)
+{
+  const double pi = std::acos(-1.0);
+  double sum = 10.0 * x.size();
+  for (double xi : x) sum += xi * xi - 10 * std::cos(2 * pi * xi);
+  return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline double rosenbrock(const std::vector<double>& x)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i + 1 < x.size(); ++i)
+  {
+    double a = x[i + 1] - x[i] * x[i];
+    double b = 1 - x[i];
+    sum += 100 * a * a + b * b;
+  }
+  return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline double ackley(const std::vector<double>& x)
+{
+  if (x.empty()) return 0;
+  const double pi = std::acos(-1.0);
+  double squares = 0, cosines = 0;
+  for (double xi : x)
+  {
+    squares += xi * xi;
+    cosines += std::cos(2 * pi * xi);
+  }
+  double n = x.size();
+  return -20 * std::exp(-0.2 * std::sqrt(squares / n)) - std::exp(cosines / n)
+         + 20 + std::exp(1.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Test function with its usual search domain in every coordinate
+struct TestFunction
+{
+  std::string name;
+  Function function;
+  double minValue;
+  double maxValue;
+};
+
+inline std::vector<TestFunction> standardFunctions()
+{
+  return {{"sphere", sphere, -5.12, 5.12},
+          {"rastrigin", rastrigin, -5.12, 5.12},
+          {"rosenbrock", rosenbrock, -2.048, 2.048},
+          {"ackley", ackley, -32.768, 32.768}};
+}
+
+}}
+#endif
@@ -0,0 +1,188 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_KERNELS_HEADER_SEEN__
+#define GENE_EVSTRAT_KERNELS_HEADER_SEEN__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace gene{ namespace evstrat {
+
+/******************************************************************************
+ * Kernels over contiguous arrays of coordinates used by the evolution
+ * strategies operators. Loops are written so that the compiler can
+ * vectorize them; exp uses AVX2 (four coordinates per step) when available.
+ *****************************************************************************/
+
+#if defined(__AVX2__)
+///////////////////////////////////////////////////////////////////////////////
+// exp(x) as 2^k * exp(r), with |r| <= ln(2)/2 and exp(r) from its Taylor
+// series up to degree 12, which is accurate to about 2 ulp. Arguments are
+// clamped to [-708, 709], where the result is a normal double.
+inline __m256d exp4(__m256d x)
+{
+  const double coefficients[] = {1.0 / 479001600, 1.0 / 39916800, 1.0 / 3628800,
+                                 1.0 / 362880, 1.0 / 40320, 1.0 / 5040, 1.0 / 720,
+                                 1.0 / 120, 1.0 / 24, 1.0 / 6, 1.0 / 2, 1.0, 1.0};
+
+  x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-708.0)), _mm256_set1_pd(709.0));
+  __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)),
+                              _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+
+  // ln(2) split in a part exact in k*ln2Hi and the rest
+  __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(6.93145751953125e-1)));
+  r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(1.42860682030941723212e-6)));
+
+  __m256d p = _mm256_set1_pd(coefficients[0]);
+  for (std::size_t i = 1; i < sizeof(coefficients) / sizeof(double); ++i)
+  {
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(coefficients[i]));
+  }
+
+  // 2^k: adding 1.5*2^52 leaves k + 1023 in the low bits of the mantissa,
+  // which are then shifted into the exponent
+  __m256d biased = _mm256_add_pd(k, _mm256_set1_pd(6755399441055744.0 + 1023));
+  __m256i scale = _mm256_slli_epi64(_mm256_castpd_si256(biased), 52);
+  return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// x[i] = exp(x[i]), with x[i] clamped to [-708, 709]
+inline void expInPlace(double* x, std::size_t n)
+{
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm256_storeu_pd(x + i, exp4(_mm256_loadu_pd(x + i)));
+  }
+#endif
+  for (; i < n; ++i) x[i] = std::exp(std::min(std::max(x[i], -708.0), 709.0));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Self-adaptation of per coordinate step sizes:
+// sigma[i] = clamp(sigma[i] * exp(base + tau * z[i]), minSigma, maxSigma).
+// 'scratch' must hold n doubles.
+inline void selfAdaptSigmas(double* sigma,
+                            const double* z,
+                            std::size_t n,
+                            double base,
+                            double tau,
+                            double minSigma,
+                            double maxSigma,
+                            double* scratch)
+{
+  for (std::size_t i = 0; i < n; ++i) scratch[i] = base + tau * z[i];
+  expInPlace(scratch, n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    sigma[i] = std::min(std::max(minSigma, sigma[i] * scratch[i]), maxSigma);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// value[i] = clamp(value[i] + sigma[i] * z[i], minValue, maxValue)
+inline void perturb(double* value,
+                    const double* sigma,
+                    const double* z,
+                    std::size_t n,
+                    double minValue,
+                    double maxValue)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    value[i] = std::max(std::min(value[i] + sigma[i] * z[i], maxValue), minValue);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// value[i] = clamp(value[i] + sigma * z[i], minValue, maxValue)
+inline void perturb(double* value,
+                    double sigma,
+                    const double* z,
+                    std::size_t n,
+                    double minValue,
+                    double maxValue)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    value[i] = std::max(std::min(value[i] + sigma * z[i], maxValue), minValue);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Discrete recombination: out[i] is a[i] or b[i] with probability 1/2 each.
+// Each 64-bit random word chooses the source of 64 coordinates.
+inline void discreteRecombination(const double* a,
+                                  const double* b,
+                                  double* out,
+                                  std::size_t n,
+                                  std::mt19937_64& random)
+{
+  for (std::size_t block = 0; block < n; block += 64)
+  {
+    uint64_t mask = random();
+    std::size_t end = std::min<std::size_t>(64, n - block);
+    for (std::size_t j = 0; j < end; ++j)
+    {
+      out[block + j] = ((mask >> j) & 1) ? a[block + j] : b[block + j];
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Differential evolution trial vector with binomial crossover. The mutant
+// is a[i] + fa * (b[i] - a[i]) + f * (c[i] - d[i]), clamped to
+// [minValue, maxValue]; out[i] takes it when words[i] >> 11 is below
+// 'threshold' (the crossover rate times 2^53) or i is 'forced', and
+// target[i] otherwise.
+inline void differentialTrial(const double* target,
+                              const double* a,
+                              const double* b,
+                              double fa,
+                              const double* c,
+                              const double* d,
+                              double f,
+                              const uint64_t* words,
+                              uint64_t threshold,
+                              std::size_t forced,
+                              double* out,
+                              std::size_t n,
+                              double minValue,
+                              double maxValue)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    double mutant = a[i] + fa * (b[i] - a[i]) + f * (c[i] - d[i]);
+    mutant = std::max(std::min(mutant, maxValue), minValue);
+    bool take = (words[i] >> 11) < threshold;
+    out[i] = take ? mutant : target[i];
+  }
+  if (forced < n)
+  {
+    double mutant = a[forced] + fa * (b[forced] - a[forced]) + f * (c[forced] - d[forced]);
+    out[forced] = std::max(std::min(mutant, maxValue), minValue);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Intermediate recombination: out[i] = (a[i] + b[i]) / 2
+inline void intermediateRecombination(const double* a,
+                                      const double* b,
+                                      double* out,
+                                      std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i) out[i] = (a[i] + b[i]) * 0.5;
+}
+
+}}
+#endif
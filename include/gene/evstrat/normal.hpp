@@ -0,0 +1,162 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_NORMAL_HEADER_SEEN__
+#define GENE_EVSTRAT_NORMAL_HEADER_SEEN__
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gene{ namespace evstrat {
+
+/******************************************************************************
+ * Counter based random generator: word k of the stream is a SplitMix64 hash
+ * of the key and k, so a buffer can be filled without any dependency
+ * between consecutive words and the loop vectorizes. It meets the
+ * UniformRandomBitGenerator requirements.
+ *****************************************************************************/
+struct CounterRandom
+{
+  typedef uint64_t result_type;
+
+  CounterRandom(uint64_t seed) : key_(mix(seed)), counter_(0) { }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+  result_type operator()() { return mix(key_ + GAMMA * ++counter_); }
+
+  void fill(uint64_t* out, std::size_t n)
+  {
+    uint64_t base = key_ + GAMMA * counter_;
+    for (std::size_t i = 0; i < n; ++i) out[i] = mix(base + GAMMA * (i + 1));
+    counter_ += n;
+  }
+
+  private:
+
+    static const uint64_t GAMMA = 0x9e3779b97f4a7c15ULL;
+
+    static uint64_t mix(uint64_t z)
+    {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+    uint64_t key_;
+    uint64_t counter_;
+};
+
+/******************************************************************************
+ * Generator of N(0,1) samples with the ziggurat method (256 layers).
+ * fill() works in two passes over a buffer of random words: the first one
+ * computes every sample assuming it falls inside its layer rectangle, which
+ * is the case 99% of the time and needs no branches; the second one redraws
+ * the few that do not.
+ *****************************************************************************/
+struct NormalGenerator
+{
+  static const std::size_t LAYERS = 256;
+
+  NormalGenerator(uint64_t seed) : random_(seed), next_(BUFFER_SIZE)
+  {
+    // layer boundaries for R and V of the 256 layer normal ziggurat
+    const double r = 3.6541528853610088;
+    const double v = 0.00492867323399;
+    x_[0] = v / density(r);
+    x_[1] = r;
+    for (std::size_t i = 2; i < LAYERS; ++i)
+    {
+      x_[i] = std::sqrt(-2 * std::log(v / x_[i - 1] + density(x_[i - 1])));
+    }
+    x_[LAYERS] = 0;
+    for (std::size_t i = 0; i <= LAYERS; ++i) f_[i] = density(x_[i]);
+  }
+
+  // Fills out[0..n) with N(0,1) samples
+  void fill(double* out, std::size_t n)
+  {
+    words_.resize(n);
+    random_.fill(words_.data(), n);
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      uint64_t w = words_[i];
+      out[i] = signedUniform(w) * x_[w & (LAYERS - 1)];
+    }
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      std::size_t layer = words_[i] & (LAYERS - 1);
+      if (std::abs(out[i]) >= x_[layer + 1]) out[i] = redraw(layer, out[i]);
+    }
+  }
+
+  double operator()()
+  {
+    if (next_ == BUFFER_SIZE)
+    {
+      fill(buffer_, BUFFER_SIZE);
+      next_ = 0;
+    }
+    return buffer_[next_++];
+  }
+
+  private:
+
+    static const std::size_t BUFFER_SIZE = 256;
+
+    static double density(double x) { return std::exp(-0.5 * x * x); }
+
+    // Uniform in [-1, 1) from the upper 53 bits of a word
+    static double signedUniform(uint64_t w)
+    {
+      return static_cast<double>(w >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+    }
+
+    // Uniform in (0, 1]
+    double uniform()
+    {
+      return (static_cast<double>(random_() >> 11) + 1) / 9007199254740992.0;
+    }
+
+    // Sample x drawn from 'layer' fell outside of its rectangle
+    double redraw(std::size_t layer, double x)
+    {
+      while (true)
+      {
+        if (layer == 0)
+        {
+          // tail beyond x_[1], by Marsaglia's method
+          double a, b;
+          do
+          {
+            a = -std::log(uniform()) / x_[1];
+            b = -std::log(uniform());
+          }
+          while (2 * b < a * a);
+          return x < 0 ? -(x_[1] + a) : x_[1] + a;
+        }
+
+        if (f_[layer + 1] + uniform() * (f_[layer] - f_[layer + 1]) < density(x)) return x;
+
+        uint64_t w = random_();
+        layer = w & (LAYERS - 1);
+        x = signedUniform(w) * x_[layer];
+        if (std::abs(x) < x_[layer + 1]) return x;
+      }
+    }
+
+    CounterRandom random_;
+    double x_[LAYERS + 1];
+    double f_[LAYERS + 1];
+    std::vector<uint64_t> words_;
+    double buffer_[BUFFER_SIZE];
+    std::size_t next_;
+};
+
+}}
+#endif
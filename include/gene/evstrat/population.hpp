@@ -0,0 +1,151 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_POPULATION_HEADER_SEEN__
+#define GENE_EVSTRAT_POPULATION_HEADER_SEEN__
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene{ namespace evstrat {
+
+/******************************************************************************
+ * Allocator of memory aligned to ALIGNMENT bytes, i.e. to a cache line and
+ * to the widest vector registers.
+ *****************************************************************************/
+const std::size_t ALIGNMENT = 64;
+
+template<typename T>
+struct AlignedAllocator
+{
+  typedef T value_type;
+
+  AlignedAllocator() = default;
+
+  template<typename U>
+  AlignedAllocator(const AlignedAllocator<U>&) { }
+
+  T* allocate(std::size_t n)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, ALIGNMENT, n * sizeof(T)) != 0) throw std::bad_alloc();
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, std::size_t) { std::free(p); }
+
+  template<typename U>
+  bool operator==(const AlignedAllocator<U>&) const { return true; }
+
+  template<typename U>
+  bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+using AlignedVector = std::vector<double, AlignedAllocator<double>>;
+
+/******************************************************************************
+ * Dense row major matrix of doubles. Rows are padded to a multiple of
+ * ALIGNMENT bytes, so every row starts aligned and vector kernels can work
+ * on whole rows. The padding is zero initialized.
+ *****************************************************************************/
+struct Matrix
+{
+  static const std::size_t ROW_ALIGNMENT = ALIGNMENT / sizeof(double);
+
+  Matrix() : rows_(0), cols_(0), stride_(0) { }
+
+  Matrix(std::size_t rows, std::size_t cols, double value = 0)
+    : rows_(rows),
+      cols_(cols),
+      stride_((cols + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT),
+      data_(rows * stride_, 0)
+  {
+    for (std::size_t i = 0; i < rows_; ++i) std::fill(row(i), row(i) + cols_, value);
+  }
+
+  std::size_t rows() const { return rows_; }
+  std::size_t cols() const { return cols_; }
+  std::size_t stride() const { return stride_; }
+
+  double* row(std::size_t i) { return data_.data() + i * stride_; }
+  const double* row(std::size_t i) const { return data_.data() + i * stride_; }
+
+  double& operator()(std::size_t i, std::size_t j) { return data_[i * stride_ + j]; }
+  double operator()(std::size_t i, std::size_t j) const { return data_[i * stride_ + j]; }
+
+  double* data() { return data_.data(); }
+  const double* data() const { return data_.data(); }
+
+  // Keeps the first rows, adding zeroed ones if needed
+  void resizeRows(std::size_t rows)
+  {
+    data_.resize(rows * stride_, 0);
+    rows_ = rows;
+  }
+
+  // Copies row j of 'other', which has the same columns, into row i
+  void copyRow(std::size_t i, const Matrix& other, std::size_t j)
+  {
+    std::memcpy(row(i), other.row(j), cols_ * sizeof(double));
+  }
+
+  private:
+
+    std::size_t rows_;
+    std::size_t cols_;
+    std::size_t stride_;
+    AlignedVector data_;
+};
+
+/******************************************************************************
+ * Structure of arrays layout of an evolution strategies population: row k
+ * of 'values' and row k of 'sigmas' are the object and strategy parameters
+ * of individual k. Kernels run over whole rows, and copying an individual
+ * is a pair of memcpy. 'fitness' is empty until the population is
+ * evaluated, and then holds the fitness of every individual.
+ *****************************************************************************/
+struct SoaPopulation
+{
+  Matrix values;
+  Matrix sigmas;
+  PopulationFitness fitness;
+
+  SoaPopulation() = default;
+
+  SoaPopulation(std::size_t size, std::size_t dimension, std::size_t sigmaCount)
+    : values(size, dimension), sigmas(size, sigmaCount) { }
+
+  std::size_t size() const { return values.rows(); }
+  std::size_t dimension() const { return values.cols(); }
+  std::size_t sigmaCount() const { return sigmas.cols(); }
+  bool evaluated() const { return fitness.size() == size(); }
+
+  double* value(std::size_t k) { return values.row(k); }
+  const double* value(std::size_t k) const { return values.row(k); }
+  double* sigma(std::size_t k) { return sigmas.row(k); }
+  const double* sigma(std::size_t k) const { return sigmas.row(k); }
+
+  // Copies individual j of 'other' into individual k, with its fitness if
+  // both populations carry one
+  void copyIndividual(std::size_t k, const SoaPopulation& other, std::size_t j)
+  {
+    values.copyRow(k, other.values, j);
+    sigmas.copyRow(k, other.sigmas, j);
+    if (!other.evaluated())
+    {
+      fitness.clear();
+    }
+    else if (k < fitness.size())
+    {
+      fitness[k] = other.fitness[j];
+    }
+  }
+};
+
+}}
+#endif
@@ -0,0 +1,275 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+#ifndef GENE_EVSTRAT_TUNING_HEADER_SEEN__
+#define GENE_EVSTRAT_TUNING_HEADER_SEEN__
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "gene/algorithm.hpp"
+#include "gene/selection.hpp"
+#include "gene/tuning.hpp"
+#include "gene/evstrat.hpp"
+#include "gene/evstrat/functions.hpp"
+
+namespace gene{ namespace evstrat {
+
+///////////////////////////////////////////////////////////////////////////////
+// Counts the evaluations made by another fitness function, and keeps the
+// best fitness it gave. Past the limit, individuals are not evaluated and
+// get the lowest fitness, so that selection drops them
+struct CountingFitness : public FitnessFunction
+{
+  CountingFitness(FitnessFunction& function)
+    : function_(function),
+      evaluations_(0),
+      limit_(std::numeric_limits<std::size_t>::max()),
+      best_(std::numeric_limits<FitnessType>::lowest())
+  {
+    // do nothing
+  }
+
+  PopulationFitness calculate(const Population& population) override
+  {
+    std::size_t remaining = limit_ - std::min(evaluations_, limit_);
+    PopulationFitness fitness;
+    if (population.size() <= remaining)
+    {
+      fitness = function_.calculate(population);
+    }
+    else if (remaining > 0)
+    {
+      fitness = function_.calculate(Population(population.begin(),
+                                               population.begin() + remaining));
+    }
+    evaluations_ += fitness.size();
+    for (FitnessType f : fitness) best_ = std::max(best_, f);
+    fitness.resize(population.size(), std::numeric_limits<FitnessType>::lowest());
+    return fitness;
+  }
+
+  std::size_t evaluations() const { return evaluations_; }
+  FitnessType best() const { return best_; }
+  void limit(std::size_t evaluations) { limit_ = evaluations; }
+
+  private:
+    FitnessFunction& function_;
+    std::size_t evaluations_;
+    std::size_t limit_;
+    FitnessType best_;
+};
+
+/******************************************************************************
+ * Parameters of an evolution strategy with local recombination, as tuned
+ * by EvolutionStrategiesRun.
+ *****************************************************************************/
+struct EvolutionStrategiesSettings
+{
+  std::size_t mu = 15;
+  std::size_t lambda = 100;
+  bool plus = false;          // (mu + lambda) instead of (mu, lambda)
+  bool nSteps = true;         // a step size per coordinate
+  double tau = 1;             // proportionality of the learning rates
+  double sigma = 1;           // initial step size
+  double epsilon0 = 1e-8;     // minimum step size
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Run of EvolutionStrategies minimizing a test function of 'dimension'
+// coordinates, from a random population
+struct EvolutionStrategiesRun : public TuningRun
+{
+  EvolutionStrategiesRun(const TestFunction& function,
+                         std::size_t dimension,
+                         const EvolutionStrategiesSettings& settings,
+                         uint32_t seed)
+    : adapter_(function.function),
+      fitness_(adapter_),
+      mutation_(makeMutation(function, dimension, settings, seed)),
+      survival_(makeSurvival(settings)),
+      strategies_(fitness_, *mutation_, combination_, *survival_, settings.lambda),
+      population_(randomPopulation(dimension, settings.mu, function.minValue,
+                                   function.maxValue, settings.sigma,
+                                   settings.nSteps ? dimension : 1, seed))
+  {
+    combination_.g_.seed(seed);
+  }
+
+  FitnessType advance(std::size_t evaluations) override
+  {
+    fitness_.limit(evaluations);
+    while (fitness_.evaluations() < evaluations)
+    {
+      population_ = strategies_.iterate(std::move(population_));
+    }
+    return fitness_.best();
+  }
+
+  std::size_t evaluations() const override { return fitness_.evaluations(); }
+
+  private:
+
+    static std::unique_ptr<MutationStrategy> makeMutation(
+                                      const TestFunction& function,
+                                      std::size_t dimension,
+                                      const EvolutionStrategiesSettings& settings,
+                                      uint32_t seed)
+    {
+      if (settings.nSteps)
+      {
+        return std::unique_ptr<MutationStrategy>(
+           new UncorrelatedNSteps(dimension, function.minValue, function.maxValue,
+                                  settings.epsilon0, settings.tau, seed));
+      }
+      return std::unique_ptr<MutationStrategy>(
+         new UncorrelatedOneStep(dimension, function.minValue, function.maxValue,
+                                 settings.epsilon0, settings.tau, seed));
+    }
+
+    static std::unique_ptr<SurvivalPolicy> makeSurvival(
+                                      const EvolutionStrategiesSettings& settings)
+    {
+      if (settings.mu == 0 || settings.lambda == 0 ||
+          (!settings.plus && settings.lambda < settings.mu))
+      {
+        throw std::invalid_argument("evolution strategy needs 0 < mu and lambda, "
+                                    "and mu <= lambda without plus");
+      }
+      if (settings.plus) return std::unique_ptr<SurvivalPolicy>(new MuPlusLambda());
+      return std::unique_ptr<SurvivalPolicy>(new MuCommaLambda());
+    }
+
+    FitnessAdapter adapter_;
+    CountingFitness fitness_;
+    std::unique_ptr<MutationStrategy> mutation_;
+    LocalRecombination combination_;
+    std::unique_ptr<SurvivalPolicy> survival_;
+    EvolutionStrategies strategies_;
+    Population population_;
+};
+
+/******************************************************************************
+ * Parameters of a GeneticAlgorithm on real coordinates (local recombination
+ * and one step size mutation), as tuned by GeneticAlgorithmRun. Survivors
+ * are the 'survivors' fittest, or the 'survivors' fittest of a tournament
+ * of 'tournamentSize' individuals if it is not 0.
+ *****************************************************************************/
+struct GeneticAlgorithmSettings
+{
+  std::size_t populationSize = 100;
+  float mutationRate = 0.5;
+  std::size_t survivors = 50;
+  std::size_t tournamentSize = 0;
+  std::size_t eliteSize = 2;
+  double tau = 1;
+  double sigma = 1;
+  double epsilon0 = 1e-8;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Run of a GeneticAlgorithm minimizing a test function of 'dimension'
+// coordinates, from a random population
+struct GeneticAlgorithmRun : public TuningRun
+{
+  GeneticAlgorithmRun(const TestFunction& function,
+                      std::size_t dimension,
+                      const GeneticAlgorithmSettings& settings,
+                      uint32_t seed)
+    : adapter_(function.function),
+      fitness_(adapter_),
+      mutation_(dimension, function.minValue, function.maxValue,
+                settings.epsilon0, settings.tau, seed),
+      rate_(settings.mutationRate),
+      mating_(settings.populationSize - std::min(settings.eliteSize, settings.populationSize)),
+      survival_(makeSurvival(settings)),
+      algorithm_(codec_, fitness_, mutation_, rate_, mating_, combination_, *survival_),
+      population_(randomPopulation(dimension, settings.populationSize, function.minValue,
+                                   function.maxValue, settings.sigma, 1, seed)),
+      eliteSize_(settings.eliteSize)
+  {
+    combination_.g_.seed(seed);
+  }
+
+  FitnessType advance(std::size_t evaluations) override
+  {
+    fitness_.limit(evaluations);
+    while (fitness_.evaluations() < evaluations)
+    {
+      population_ = algorithm_.iterate(std::move(population_), eliteSize_);
+    }
+    return fitness_.best();
+  }
+
+  std::size_t evaluations() const override { return fitness_.evaluations(); }
+
+  private:
+
+    using Survival = gene::SurvivalPolicy<Void, EvolutionParams>;
+
+    static std::unique_ptr<Survival> makeSurvival(const GeneticAlgorithmSettings& settings)
+    {
+      std::size_t pool = settings.tournamentSize == 0 ? settings.populationSize
+                                                      : settings.tournamentSize;
+      if (settings.survivors == 0 || settings.survivors > pool ||
+          pool > settings.populationSize || settings.eliteSize >= settings.populationSize)
+      {
+        throw std::invalid_argument("genetic algorithm needs 0 < survivors <= "
+                                    "tournament size <= population size, and a "
+                                    "smaller elite");
+      }
+      if (settings.tournamentSize == 0)
+      {
+        return std::unique_ptr<Survival>(
+           new TruncationSelection<Void, EvolutionParams>(settings.survivors));
+      }
+      return std::unique_ptr<Survival>(
+         new TournamentSelection<Void, EvolutionParams>(settings.survivors,
+                                                        settings.tournamentSize));
+    }
+
+    FitnessAdapter adapter_;
+    CountingFitness fitness_;
+    NullCodec codec_;
+    UncorrelatedOneStep mutation_;
+    ConstantMutationRate<Void, EvolutionParams> rate_;
+    RandomMating<Void, EvolutionParams> mating_;
+    LocalRecombination combination_;
+    std::unique_ptr<Survival> survival_;
+    GeneticAlgorithm<Void, EvolutionParams> algorithm_;
+    Population population_;
+    const std::size_t eliteSize_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Configurations to tune from the settings of each run
+inline TuningConfiguration configuration(const std::string& name,
+                                         const TestFunction& function,
+                                         std::size_t dimension,
+                                         const EvolutionStrategiesSettings& settings)
+{
+  return {name, [=](uint32_t seed)
+          {
+            return std::unique_ptr<TuningRun>(
+               new EvolutionStrategiesRun(function, dimension, settings, seed));
+          }};
+}
+
+inline TuningConfiguration configuration(const std::string& name,
+                                         const TestFunction& function,
+                                         std::size_t dimension,
+                                         const GeneticAlgorithmSettings& settings)
+{
+  return {name, [=](uint32_t seed)
+          {
+            return std::unique_ptr<TuningRun>(
+               new GeneticAlgorithmRun(function, dimension, settings, seed));
+          }};
+}
+
+}}
+#endif
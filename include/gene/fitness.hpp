@@ -7,9 +7,11 @@
 #include <limits>
 #include <map>
 
+#include "gene/policies.hpp"
+
 namespace gene
 {
-  PopulationFitness normalize(const PopulationFitness& f)
+  inline PopulationFitness normalize(const PopulationFitness& f)
   {
     float minFitness = std::numeric_limits<float>::min();
     float totalFitness = 0;
@@ -25,7 +27,7 @@ namespace gene
     float totalAfterShift = totalFitness - (minFitness * numEntries);
 
     std::size_t populationSize = f.size();
-    PopulationFitness normalized; normalized.reserve(f.size());
+    PopulationFitness normalized(f.size());
 
     for (std::size_t k = 0; k < populationSize; ++k)
     {
@@ -39,7 +41,7 @@ namespace gene
   
   using Wheel = std::multimap<float, PopulationIndex>;
 
-  Wheel computeWheel (const PopulationFitness& f)
+  inline Wheel computeWheel (const PopulationFitness& f)
   {
     PopulationFitness normalized = normalize(f);
     
@@ -0,0 +1,121 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_LAZY_HEADER_SEEN_
+#define GENE_LAZY_HEADER_SEEN_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "gene/policies.hpp"
+#include "gene/parallel.hpp"
+
+namespace gene
+{
+
+/******************************************************************************
+ * Phenotype that is decoded the first time it is accessed.
+ * Copies share the decoded value, so an individual is decoded at most once
+ * no matter how many times it is copied. Accessing it from several threads
+ * is safe; only one of them decodes. If decoding throws, the exception
+ * propagates to the caller and the next access tries again.
+ *****************************************************************************/
+template<typename Phenotype>
+struct Lazy
+{
+  Lazy() : Lazy(Phenotype()) { }
+
+  // Already decoded phenotype
+  Lazy(Phenotype value) : state_(std::make_shared<State>())
+  {
+    state_->value.reset(new Phenotype(std::move(value)));
+    state_->decoded = true;
+  }
+
+  // Phenotype to be decoded by 'decode' when first accessed
+  explicit Lazy(std::function<Phenotype()> decode) : state_(std::make_shared<State>())
+  {
+    state_->decode = std::move(decode);
+  }
+
+  const Phenotype& get() const
+  {
+    State& state = *state_;
+    if (!state.decoded)
+    {
+      std::call_once(state.once, [&state]
+      {
+        state.value.reset(new Phenotype(state.decode()));
+        state.decode = nullptr;
+        state.decoded = true;
+      });
+    }
+    return *state.value;
+  }
+
+  bool isDecoded() const { return state_->decoded; }
+
+  const Phenotype& operator*() const { return get(); }
+  const Phenotype* operator->() const { return &get(); }
+
+  private:
+
+    struct State
+    {
+      std::once_flag once;
+      std::atomic<bool> decoded {false};
+      std::function<Phenotype()> decode;
+      std::unique_ptr<const Phenotype> value;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+/******************************************************************************
+ * Codec of lazy phenotypes on top of a codec of Phenotype.
+ * decode() only keeps a copy of the genotype, so offspring that are mutated
+ * again or dropped by the survival policy are never decoded. Genotypes
+ * should thus be cheap to copy (e.g. dna::Genotype shares its chromosome
+ * data among copies). decodeBatch() decodes the pending phenotypes of a
+ * population in parallel, which requires the underlying decode() to be
+ * thread safe.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct LazyCodec : public Codec<Lazy<Phenotype>, Genotype>
+{
+  LazyCodec(const Codec<Phenotype, Genotype>& codec) : codec_(codec) { }
+
+  Lazy<Phenotype> decode(const Genotype& genotype) const
+                                       throw(std::invalid_argument) override
+  {
+    const Codec<Phenotype, Genotype>& codec = codec_;
+    return Lazy<Phenotype>(std::function<Phenotype()>([&codec, genotype]
+    {
+      return codec.decode(genotype);
+    }));
+  }
+
+  Genotype encode(const Lazy<Phenotype>& phenotype) const override
+  {
+    return codec_.encode(phenotype.get());
+  }
+
+  void decodeBatch(Population<Lazy<Phenotype>, Genotype>& population,
+                   std::size_t threads = 0) const override
+  {
+    parallelFor(population.size(), threads, [&population](std::size_t k)
+    {
+      population[k].first.get();
+    });
+  }
+
+  private:
+
+    const Codec<Phenotype, Genotype>& codec_;
+};
+
+}
+#endif
@@ -38,8 +38,9 @@ struct MutationMix : public MutationStrategy<Phenotype, Genotype>
     }
   }
 
-  Individual<Phenotype, Genotype> mutate(Individual<Phenotype, Genotype> i,
-                                         const Codec<Phenotype, Genotype>& codec) override
+  void mutateInPlace(Individual<Phenotype, Genotype>& i,
+                     const Codec<Phenotype, Genotype>& codec,
+                     MutatedRegion* region = nullptr) override
   {
     float p = distribution_(generator_);
     auto it = mutations_.lower_bound(p);
@@ -47,7 +48,7 @@ struct MutationMix : public MutationStrategy<Phenotype, Genotype>
       it = mutations_.begin();
     }
     MutationPtr& mutation = it->second;
-    return std::move(mutation->mutate(std::move(i), codec));
+    mutation->mutateInPlace(i, codec, region);
   }
 };
 
@@ -70,21 +71,37 @@ struct LocalSearchMutation : public MutationStrategy<Phenotype, Genotype>
  
     : mutation_(mutation), fitness_(fitness), numChildren_(numChildren) { }
 
-  Individual<Phenotype, Genotype> mutate(Individual<Phenotype, Genotype> i,
-                                         const Codec<Phenotype, Genotype>& codec) override
+  void mutateInPlace(Individual<Phenotype, Genotype>& i,
+                     const Codec<Phenotype, Genotype>& codec,
+                     MutatedRegion* region = nullptr) override
   {
+    if (numChildren_ == 0) return;
+
+    // the last child takes over the original individual instead of a copy
     Population<Phenotype, Genotype> children;
     children.reserve(numChildren_);
+    for (std::size_t k = 0; k + 1 < numChildren_; ++k) children.push_back(i);
+    children.push_back(std::move(i));
 
+    std::vector<MutatedRegion> regions(region != nullptr ? numChildren_ : 0);
     for (std::size_t k = 0; k < numChildren_; ++k)
     {
-      children.emplace_back(mutation_->mutate(i, codec));
+      mutation_->mutateInPlace(children[k],
+                               codec,
+                               region != nullptr ? &regions[k] : nullptr);
     }
 
     PopulationFitness f = fitness_->calculate(children);
     auto maxFitnessIt = std::max_element(f.begin(), f.end());
-    Individual<Phenotype, Genotype>& best = children[maxFitnessIt - f.begin()];
-    return std::move(best);
+    std::size_t bestIndex = maxFitnessIt - f.begin();
+    i = std::move(children[bestIndex]);
+
+    if (region != nullptr)
+    {
+      region->insert(region->end(),
+                     regions[bestIndex].begin(),
+                     regions[bestIndex].end());
+    }
   }
 };
 
@@ -0,0 +1,163 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_PARALLEL_HEADER_SEEN_
+#define GENE_PARALLEL_HEADER_SEEN_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace gene
+{
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t hardwareThreads()
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+/******************************************************************************
+ * Calls f(k) for every k in [0, count), splitting the range in contiguous
+ * blocks among 'threads' threads (the hardware concurrency if 0). If any
+ * call throws, the first exception is rethrown once all threads finish.
+ *****************************************************************************/
+template<typename Function>
+void parallelFor(std::size_t count, std::size_t threads, Function f)
+{
+  if (threads == 0) threads = hardwareThreads();
+  threads = std::min(threads, count);
+
+  if (threads <= 1)
+  {
+    for (std::size_t k = 0; k < count; ++k) f(k);
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&, t]
+    {
+      try
+      {
+        std::size_t end = count * (t + 1) / threads;
+        for (std::size_t k = count * t / threads; k < end; ++k) f(k);
+      }
+      catch (...)
+      {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) worker.join();
+  for (const std::exception_ptr& error : errors)
+  {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+/******************************************************************************
+ * Same as parallelFor, but the threads take the indices one at a time, for
+ * calls of very different cost (e.g. whole runs of an algorithm).
+ *****************************************************************************/
+template<typename Function>
+void parallelDynamic(std::size_t count, std::size_t threads, Function f)
+{
+  if (threads == 0) threads = hardwareThreads();
+  threads = std::min(threads, count);
+
+  std::atomic<std::size_t> next(0);
+  parallelFor(threads, threads, [&](std::size_t)
+  {
+    for (std::size_t k = next++; k < count; k = next++) f(k);
+  });
+}
+
+/******************************************************************************
+ * Number of contiguous blocks parallelBlocks splits 'count' items in.
+ *****************************************************************************/
+inline std::size_t blockCount(std::size_t count, std::size_t threads)
+{
+  if (threads == 0) threads = hardwareThreads();
+  return std::max<std::size_t>(1, std::min(threads, count));
+}
+
+/******************************************************************************
+ * Calls f(block, begin, end) for each of the blockCount(count, threads)
+ * contiguous blocks [begin, end) of [0, count), one per thread.
+ *****************************************************************************/
+template<typename Function>
+void parallelBlocks(std::size_t count, std::size_t threads, Function f)
+{
+  std::size_t blocks = blockCount(count, threads);
+  parallelFor(blocks, blocks, [&](std::size_t b)
+  {
+    f(b, count * b / blocks, count * (b + 1) / blocks);
+  });
+}
+
+/******************************************************************************
+ * Inclusive prefix sums of 'values', in two parallel passes: the sum of
+ * each block, then the sums inside each block starting from the total of
+ * the blocks before it.
+ *****************************************************************************/
+template<typename Sum, typename Value>
+std::vector<Sum> parallelPrefixSum(const std::vector<Value>& values, std::size_t threads)
+{
+  std::size_t count = values.size();
+  std::vector<Sum> sums(count);
+  std::vector<Sum> blockSums(blockCount(count, threads) + 1, Sum());
+  parallelBlocks(count, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    Sum sum = Sum();
+    for (std::size_t k = begin; k < end; ++k) sum += values[k];
+    blockSums[b + 1] = sum;
+  });
+  for (std::size_t b = 1; b < blockSums.size(); ++b) blockSums[b] += blockSums[b - 1];
+  parallelBlocks(count, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    Sum sum = blockSums[b];
+    for (std::size_t k = begin; k < end; ++k) sums[k] = sum += values[k];
+  });
+  return sums;
+}
+
+/******************************************************************************
+ * Indices k in [0, count) for which keep(k) holds, in increasing order.
+ * Each block counts its own, and then writes them at the offset given by
+ * the counts of the blocks before it. keep is called twice per index.
+ *****************************************************************************/
+template<typename Predicate>
+std::vector<std::size_t> parallelCompact(std::size_t count, std::size_t threads, Predicate keep)
+{
+  std::vector<std::size_t> offsets(blockCount(count, threads) + 1, 0);
+  parallelBlocks(count, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    std::size_t kept = 0;
+    for (std::size_t k = begin; k < end; ++k) kept += keep(k) ? 1 : 0;
+    offsets[b + 1] = kept;
+  });
+  for (std::size_t b = 1; b < offsets.size(); ++b) offsets[b] += offsets[b - 1];
+
+  std::vector<std::size_t> result(offsets.back());
+  parallelBlocks(count, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    std::size_t out = offsets[b];
+    for (std::size_t k = begin; k < end; ++k)
+    {
+      if (keep(k)) result[out++] = k;
+    }
+  });
+  return result;
+}
+
+}
+#endif
@@ -12,6 +12,9 @@
 #include <stdexcept>
 #include <functional>
 #include <algorithm>
+#include <type_traits>
+
+#include "gene/parallel.hpp"
 
 namespace gene {
 
@@ -44,6 +47,19 @@ struct Codec
 {
   virtual Phenotype decode(const Genotype&) const throw(std::invalid_argument) = 0;
   virtual Genotype encode(const Phenotype&) const = 0;
+
+  // Decodes the phenotype of every individual of the population, splitting
+  // the work among 'threads' threads (the hardware concurrency if 0).
+  // decode() must be safe to call concurrently for this to be used.
+  virtual void decodeBatch(Population<Phenotype, Genotype>& population,
+                           std::size_t threads = 0) const
+  {
+    parallelFor(population.size(), threads, [&](std::size_t k)
+    {
+      population[k].first = decode(population[k].second);
+    });
+  }
+
   virtual ~Codec() { }
 };
 
@@ -82,17 +98,70 @@ template<typename Phenotype, typename Genotype>
 struct FitnessFunction
 {
   virtual PopulationFitness calculate(const Population<Phenotype, Genotype>&) = 0;
+
+  // Fitness of the population when only the 'count' fittest individuals
+  // need an exact one: functions that can stop early (see bounded.hpp) give
+  // the rest an upper bound lower than the fitness of those, and flag the
+  // individuals with a bound in 'bounded' (left empty if there is none).
+  virtual PopulationFitness calculateTop(const Population<Phenotype, Genotype>& population,
+                                         std::size_t count,
+                                         std::vector<bool>* bounded = nullptr)
+  {
+    if (bounded != nullptr) bounded->clear();
+    return calculate(population);
+  }
+
   virtual ~FitnessFunction() { }
 };
 
+/****************************************************************************
+ * Span of positions [begin, end) modified by a mutation inside one locus of
+ * a genotype. The meaning of 'locus' depends on the coding (e.g. index of
+ * the chromosome for DNA, parameter vector for evolution strategies).
+ ***************************************************************************/
+struct MutatedSpan
+{
+  std::size_t locus;
+  std::size_t begin;
+  std::size_t end;
+};
+
+using MutatedRegion = std::vector<MutatedSpan>;
+
+/****************************************************************************
+ * Appends a span to the region, if the caller asked for one.
+ ***************************************************************************/
+inline void reportMutation(MutatedRegion* region,
+                           std::size_t locus,
+                           std::size_t begin,
+                           std::size_t end)
+{
+  if (region != nullptr && begin < end)
+  {
+    region->push_back(MutatedSpan{locus, begin, end});
+  }
+}
+
 /****************************************************************************
  * Interface abstracting a mutation in a genotipe.
+ * Implementations modify the individual in place, so that only the mutated
+ * part of the genotype is touched, and may report which spans changed.
  ***************************************************************************/
 template<typename Phenotype, typename Genotype>
 struct MutationStrategy
 {
-  virtual Individual<Phenotype, Genotype> mutate(Individual<Phenotype, Genotype>,
-                                                 const Codec<Phenotype, Genotype>&) = 0;
+  virtual void mutateInPlace(Individual<Phenotype, Genotype>&,
+                             const Codec<Phenotype, Genotype>&,
+                             MutatedRegion* region = nullptr) = 0;
+
+  // Adapter for the by-value interface: mutates a copy and returns it.
+  Individual<Phenotype, Genotype> mutate(Individual<Phenotype, Genotype> i,
+                                         const Codec<Phenotype, Genotype>& codec)
+  {
+    mutateInPlace(i, codec);
+    return std::move(i);
+  }
+
   virtual ~MutationStrategy() { }
 };
 
@@ -136,6 +205,27 @@ struct SurvivalPolicy
   virtual Survivors selectSurvivors (const Population<Phenotype, Genotype>&,
                                      const PopulationFitness&) = 0;
 
+  // Same survivors, as indices in increasing order. Policies that can find
+  // them without building the set override it.
+  virtual std::vector<PopulationIndex> selectIndices (
+                            const Population<Phenotype, Genotype>& population,
+                            const PopulationFitness& fitness)
+  {
+    Survivors survivors = selectSurvivors(population, fitness);
+    return std::vector<PopulationIndex>(survivors.begin(), survivors.end());
+  }
+
+  // Number of the fittest individuals among which the survivors are always
+  // chosen, so that the rest need no exact fitness. Policies whose choice
+  // depends on the fitness of any individual keep the population size.
+  virtual std::size_t survivingRank(std::size_t populationSize) const
+  {
+    return populationSize;
+  }
+
+  // Threads used by the policy, and by select() on indices
+  virtual std::size_t threads() const { return 1; }
+
   Population<Phenotype, Genotype> select(Population<Phenotype, Genotype>&& p,
                                          const Survivors& s)
   {
@@ -155,7 +245,79 @@ struct SurvivalPolicy
     return std::move(result);
   }
 
+  // Moves the individuals at the given distinct indices out of p, split
+  // among threads() threads when individuals can be default constructed
+  Population<Phenotype, Genotype> select(Population<Phenotype, Genotype>&& p,
+                                         const std::vector<PopulationIndex>& s)
+  {
+    return gather(p, s, std::is_default_constructible<Individual<Phenotype, Genotype>>());
+  }
+
+  PopulationFitness select(PopulationFitness && f,
+                           const std::vector<PopulationIndex>& s)
+  {
+    PopulationFitness result(s.size());
+    parallelFor(s.size(), threads(), [&](std::size_t k) { result[k] = f[s[k]]; });
+    return result;
+  }
+
   virtual ~SurvivalPolicy() { }
+
+  private:
+
+    Population<Phenotype, Genotype> gather(Population<Phenotype, Genotype>& p,
+                                           const std::vector<PopulationIndex>& s,
+                                           std::true_type)
+    {
+      Population<Phenotype, Genotype> result(s.size());
+      parallelFor(s.size(), threads(), [&](std::size_t k) { result[k] = std::move(p[s[k]]); });
+      return result;
+    }
+
+    Population<Phenotype, Genotype> gather(Population<Phenotype, Genotype>& p,
+                                           const std::vector<PopulationIndex>& s,
+                                           std::false_type)
+    {
+      Population<Phenotype, Genotype> result; result.reserve(s.size());
+      for (std::size_t k : s) result.emplace_back(std::move(p[k]));
+      return result;
+    }
+};
+
+/****************************************************************************
+ * Interface abstracting an observer of the evaluated population of each
+ * generation (e.g. PopulationStatistics).
+ ***************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct GenerationObserver
+{
+  virtual void observe(const Population<Phenotype, Genotype>&,
+                       const PopulationFitness&) = 0;
+
+  // Same, when the fitness of the individuals flagged in 'bounded' (if not
+  // empty) is only an upper bound (see bounded.hpp). By default the others
+  // are observed alone.
+  virtual void observe(const Population<Phenotype, Genotype>& population,
+                       const PopulationFitness& fitness,
+                       const std::vector<bool>& bounded)
+  {
+    if (std::find(bounded.begin(), bounded.end(), true) == bounded.end())
+    {
+      observe(population, fitness);
+      return;
+    }
+    Population<Phenotype, Genotype> exact;
+    PopulationFitness exactFitness;
+    for (PopulationIndex k = 0; k < population.size(); ++k)
+    {
+      if (bounded[k]) continue;
+      exact.push_back(population[k]);
+      exactFitness.push_back(fitness[k]);
+    }
+    observe(exact, exactFitness);
+  }
+
+  virtual ~GenerationObserver() { }
 };
 
 }
@@ -0,0 +1,139 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_PROCESS_HEADER_SEEN_
+#define GENE_PROCESS_HEADER_SEEN_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "gene/parallel.hpp"
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Counters of a WorkerPool.
+ *****************************************************************************/
+struct WorkerStatistics
+{
+  std::size_t evaluated = 0;    // requests answered by a worker
+  std::size_t crashes = 0;      // workers that died or closed their socket
+  std::size_t timeouts = 0;     // workers killed for not answering in time
+  std::size_t requeued = 0;     // requests sent again after losing a worker
+  std::size_t failed = 0;       // requests given up on, see WorkerPool
+  std::size_t dead = 0;         // workers that could not be restarted
+};
+
+/******************************************************************************
+ * Pool of local worker processes evaluating serialized requests, so that a
+ * crash in the evaluation does not take the caller down.
+ * Workers are forked at construction (and when restarted) and run
+ * 'evaluate' on the requests they receive through a Unix domain socket;
+ * they see the memory of the parent as it was when they were forked.
+ * evaluate() splits a batch in chunks of 'batchSize' requests (if 0, about
+ * four chunks per worker) and hands them to idle workers, which send their
+ * answers every millisecond or so. A worker that dies, or does not answer
+ * within 'timeout' (no limit if zero), is killed and restarted, and its
+ * unanswered requests are queued again. The request it was evaluating,
+ * which it publishes in memory shared with the parent, counts as an
+ * attempt; after 'maxAttempts' of them it gets 'failureFitness'. A worker
+ * that can't be restarted (fork failing, say) is left dead until the next
+ * evaluate(), which throws if no worker is left to evaluate its requests.
+ * Forking is only safe while no other thread of the process holds a lock
+ * the workers may need (e.g. the allocator's).
+ *****************************************************************************/
+struct WorkerPool
+{
+  using Evaluate = std::function<FitnessType(const std::string&)>;
+
+  WorkerPool(Evaluate evaluate,
+             std::size_t workers = 0,
+             std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+             std::size_t maxAttempts = 3,
+             FitnessType failureFitness = std::numeric_limits<FitnessType>::lowest());
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool();
+
+  PopulationFitness evaluate(const std::vector<std::string>& requests,
+                             std::size_t batchSize = 0);
+
+  std::size_t size() const { return workers_.size(); }
+  const WorkerStatistics& statistics() const { return statistics_; }
+
+  private:
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Worker
+    {
+      pid_t pid = -1;
+      int socket = -1;
+      std::atomic<uint64_t>* current = nullptr; // request being evaluated
+      std::deque<std::size_t> outstanding;      // in the order they are answered
+      Clock::time_point deadline;
+      std::string buffer;                       // partial answer read so far
+    };
+
+    void start(Worker& worker);
+    void stop(Worker& worker);
+    void shutdown();
+    [[noreturn]] void serve(int socket, std::atomic<uint64_t>& current);
+    bool send(Worker& worker, const std::vector<std::string>& requests);
+
+    Evaluate evaluate_;
+    const std::chrono::milliseconds timeout_;
+    const std::size_t maxAttempts_;
+    const FitnessType failureFitness_;
+    std::vector<Worker> workers_;
+    std::atomic<uint64_t>* shared_;             // one slot per worker
+    WorkerStatistics statistics_;
+};
+
+/******************************************************************************
+ * Fitness function evaluating another one in a WorkerPool. Individuals are
+ * serialized in the parent and deserialized in the workers, which evaluate
+ * them one at a time with the wrapped function as it was when they were
+ * forked.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct ProcessFitness : public FitnessFunction<Phenotype, Genotype>
+{
+  using Serialize = std::function<std::string(const Individual<Phenotype, Genotype>&)>;
+  using Deserialize = std::function<Individual<Phenotype, Genotype>(const std::string&)>;
+
+  ProcessFitness(FitnessFunction<Phenotype, Genotype>& function,
+                 Serialize serialize,
+                 Deserialize deserialize,
+                 std::size_t workers = 0,
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+                 std::size_t maxAttempts = 3,
+                 std::size_t batchSize = 0);
+
+  PopulationFitness calculate(const Population<Phenotype, Genotype>& population) override;
+
+  const WorkerPool& pool() const { return pool_; }
+
+  private:
+
+    Serialize serialize_;
+    const std::size_t batchSize_;
+    WorkerPool pool_;
+};
+
+}
+
+#include "gene/process_impl.hpp"
+#endif
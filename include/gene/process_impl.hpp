@@ -0,0 +1,435 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace gene {
+
+namespace process {
+
+// Answer of a worker to request 'index'
+struct Answer
+{
+  uint64_t index;
+  double fitness;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline bool readAll(int fd, void* data, std::size_t size)
+{
+  char* p = static_cast<char*>(data);
+  while (size > 0)
+  {
+    ssize_t n = ::read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes without raising SIGPIPE if the other end is gone
+inline bool writeAll(int fd, const void* data, std::size_t size)
+{
+  const char* p = static_cast<const char*>(data);
+  while (size > 0)
+  {
+    ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void appendWord(std::string& message, uint64_t w)
+{
+  message.append(reinterpret_cast<const char*>(&w), sizeof(w));
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline WorkerPool::WorkerPool(Evaluate evaluate,
+                              std::size_t workers,
+                              std::chrono::milliseconds timeout,
+                              std::size_t maxAttempts,
+                              FitnessType failureFitness)
+  : evaluate_(evaluate),
+    timeout_(timeout),
+    maxAttempts_(std::max<std::size_t>(maxAttempts, 1)),
+    failureFitness_(failureFitness),
+    workers_(workers == 0 ? hardwareThreads() : workers)
+{
+  std::size_t bytes = workers_.size() * sizeof(std::atomic<uint64_t>);
+  void* shared = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED)
+  {
+    throw std::runtime_error(std::string("mmap: ") + std::strerror(errno));
+  }
+  shared_ = static_cast<std::atomic<uint64_t>*>(shared);
+  for (std::size_t k = 0; k < workers_.size(); ++k)
+  {
+    workers_[k].current = new (shared_ + k) std::atomic<uint64_t>(0);
+  }
+
+  try
+  {
+    for (Worker& worker : workers_) start(worker);
+  }
+  catch (...)
+  {
+    shutdown();
+    throw;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline WorkerPool::~WorkerPool()
+{
+  shutdown();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void WorkerPool::shutdown()
+{
+  // closing the sockets makes idle workers exit; busy ones are killed
+  for (Worker& worker : workers_)
+  {
+    if (worker.pid < 0) continue;
+    if (!worker.outstanding.empty()) ::kill(worker.pid, SIGKILL);
+    ::close(worker.socket);
+  }
+  for (Worker& worker : workers_)
+  {
+    if (worker.pid >= 0) ::waitpid(worker.pid, nullptr, 0);
+  }
+  ::munmap(shared_, workers_.size() * sizeof(std::atomic<uint64_t>));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void WorkerPool::start(Worker& worker)
+{
+  int sockets[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+  {
+    throw std::runtime_error(std::string("socketpair: ") + std::strerror(errno));
+  }
+
+  pid_t pid = ::fork();
+  if (pid < 0)
+  {
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+    throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+  }
+
+  if (pid == 0)
+  {
+    // the worker must not keep the other workers' sockets open, or they
+    // would not see the parent closing them
+    ::close(sockets[0]);
+    for (const Worker& other : workers_)
+    {
+      if (other.socket >= 0) ::close(other.socket);
+    }
+    serve(sockets[1], *worker.current);
+  }
+
+  ::close(sockets[1]);
+  worker.pid = pid;
+  worker.socket = sockets[0];
+  worker.outstanding.clear();
+  worker.buffer.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Kills a worker and waits for it
+inline void WorkerPool::stop(Worker& worker)
+{
+  ::kill(worker.pid, SIGKILL);
+  ::close(worker.socket);
+  ::waitpid(worker.pid, nullptr, 0);
+  worker.pid = -1;
+  worker.socket = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Loop of a worker: reads a chunk (count, then index, size and bytes of
+// each request) and evaluates its requests in order, until the parent
+// closes the socket. Answers are sent at the end of the chunk, or before
+// an evaluation if the last ones were sent more than a millisecond ago.
+inline void WorkerPool::serve(int socket, std::atomic<uint64_t>& current)
+{
+  std::string answers;
+  std::vector<uint64_t> indices;
+  std::vector<std::string> requests;
+  uint64_t count;
+  while (process::readAll(socket, &count, sizeof(count)))
+  {
+    indices.resize(count);
+    requests.resize(count);
+    for (uint64_t k = 0; k < count; ++k)
+    {
+      uint64_t size;
+      if (!process::readAll(socket, &indices[k], sizeof(uint64_t))
+          || !process::readAll(socket, &size, sizeof(size))) ::_exit(1);
+      requests[k].resize(size);
+      if (size > 0 && !process::readAll(socket, &requests[k][0], size)) ::_exit(1);
+    }
+
+    Clock::time_point sent = Clock::now();
+    for (uint64_t k = 0; k < count; ++k)
+    {
+      if (!answers.empty() && Clock::now() - sent > std::chrono::milliseconds(1))
+      {
+        if (!process::writeAll(socket, answers.data(), answers.size())) ::_exit(1);
+        answers.clear();
+        sent = Clock::now();
+      }
+
+      process::Answer answer;
+      answer.index = indices[k];
+      current.store(answer.index, std::memory_order_relaxed);
+      try
+      {
+        answer.fitness = evaluate_(requests[k]);
+      }
+      catch (...)
+      {
+        ::_exit(2);
+      }
+      answers.append(reinterpret_cast<const char*>(&answer), sizeof(answer));
+    }
+    if (!process::writeAll(socket, answers.data(), answers.size())) ::_exit(1);
+    answers.clear();
+  }
+  ::_exit(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sends the outstanding requests of an idle worker
+inline bool WorkerPool::send(Worker& worker, const std::vector<std::string>& requests)
+{
+  std::string message;
+  process::appendWord(message, worker.outstanding.size());
+  for (std::size_t index : worker.outstanding)
+  {
+    process::appendWord(message, index);
+    process::appendWord(message, requests[index].size());
+    message.append(requests[index]);
+  }
+  worker.current->store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+  worker.deadline = Clock::now() + timeout_;
+  return process::writeAll(worker.socket, message.data(), message.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline PopulationFitness WorkerPool::evaluate(const std::vector<std::string>& requests,
+                                              std::size_t batchSize)
+{
+  std::size_t count = requests.size();
+  PopulationFitness fitness(count, failureFitness_);
+  std::vector<std::size_t> attempts(count, 0);
+  std::deque<std::size_t> queue;
+  for (std::size_t k = 0; k < count; ++k) queue.push_back(k);
+  std::size_t remaining = count;
+  if (batchSize == 0) batchSize = std::max<std::size_t>(1, count / (4 * workers_.size()));
+
+  // Workers left busy by a call that threw are restarted, and those that
+  // could not be restarted get another chance
+  for (Worker& worker : workers_)
+  {
+    if (worker.pid >= 0 && worker.outstanding.empty()) continue;
+    if (worker.pid >= 0) stop(worker);
+    try
+    {
+      start(worker);
+    }
+    catch (const std::runtime_error&)
+    {
+      // still dead
+      worker.outstanding.clear();
+      worker.buffer.clear();
+    }
+  }
+
+  // Restarts a lost worker, queueing its requests again but the one it was
+  // evaluating once it has used its attempts. If it can't be restarted, it
+  // is left dead until the next call
+  auto lose = [&](Worker& worker)
+  {
+    stop(worker);
+    std::size_t culprit = worker.current->load(std::memory_order_relaxed);
+    for (std::size_t index : worker.outstanding)
+    {
+      if (index == culprit && ++attempts[index] >= maxAttempts_)
+      {
+        ++statistics_.failed;
+        --remaining;
+      }
+      else
+      {
+        queue.push_back(index);
+        ++statistics_.requeued;
+      }
+    }
+    try
+    {
+      start(worker);
+    }
+    catch (const std::runtime_error&)
+    {
+      worker.outstanding.clear();
+      worker.buffer.clear();
+      ++statistics_.dead;
+    }
+  };
+
+  std::vector<pollfd> polled;
+  std::vector<Worker*> busy;
+  while (remaining > 0)
+  {
+    for (Worker& worker : workers_)
+    {
+      if (worker.pid < 0 || !worker.outstanding.empty() || queue.empty()) continue;
+      for (std::size_t k = 0; k < batchSize && !queue.empty(); ++k)
+      {
+        worker.outstanding.push_back(queue.front());
+        queue.pop_front();
+      }
+      if (!send(worker, requests))
+      {
+        ++statistics_.crashes;
+        lose(worker);
+      }
+    }
+
+    polled.clear();
+    busy.clear();
+    Clock::time_point now = Clock::now();
+    int wait = -1;
+    for (Worker& worker : workers_)
+    {
+      if (worker.outstanding.empty()) continue;
+      polled.push_back(pollfd{worker.socket, POLLIN, 0});
+      busy.push_back(&worker);
+      if (timeout_.count() > 0)
+      {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(worker.deadline - now);
+        int ms = std::max<int>(0, left.count() + 1);
+        wait = wait < 0 ? ms : std::min(wait, ms);
+      }
+    }
+    if (polled.empty())
+    {
+      bool alive = std::any_of(workers_.begin(), workers_.end(),
+                               [](const Worker& worker) { return worker.pid >= 0; });
+      if (!alive) throw std::runtime_error("no worker left in the pool");
+      continue;
+    }
+
+    if (::poll(polled.data(), polled.size(), wait) < 0 && errno != EINTR)
+    {
+      throw std::runtime_error(std::string("poll: ") + std::strerror(errno));
+    }
+
+    now = Clock::now();
+    for (std::size_t k = 0; k < polled.size(); ++k)
+    {
+      Worker& worker = *busy[k];
+      if (polled[k].revents != 0)
+      {
+        char data[4096];
+        ssize_t n = ::read(worker.socket, data, sizeof(data));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+          ++statistics_.crashes;
+          lose(worker);
+          continue;
+        }
+
+        worker.buffer.append(data, n);
+        std::size_t used = 0;
+        for (; used + sizeof(process::Answer) <= worker.buffer.size();
+               used += sizeof(process::Answer))
+        {
+          process::Answer answer;
+          std::memcpy(&answer, worker.buffer.data() + used, sizeof(answer));
+          if (worker.outstanding.empty() || answer.index != worker.outstanding.front())
+          {
+            throw std::logic_error("unexpected answer from a worker");
+          }
+          worker.outstanding.pop_front();
+          fitness[answer.index] = answer.fitness;
+          ++statistics_.evaluated;
+          --remaining;
+        }
+        worker.buffer.erase(0, used);
+        worker.deadline = now + timeout_;
+      }
+      else if (timeout_.count() > 0 && now >= worker.deadline)
+      {
+        ++statistics_.timeouts;
+        lose(worker);
+      }
+    }
+  }
+  return fitness;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+ProcessFitness<Phenotype, Genotype>::ProcessFitness(
+                              FitnessFunction<Phenotype, Genotype>& function,
+                              Serialize serialize,
+                              Deserialize deserialize,
+                              std::size_t workers,
+                              std::chrono::milliseconds timeout,
+                              std::size_t maxAttempts,
+                              std::size_t batchSize)
+  : serialize_(serialize),
+    batchSize_(batchSize),
+    pool_([&function, deserialize](const std::string& request)
+          {
+            Population<Phenotype, Genotype> population;
+            population.push_back(deserialize(request));
+            return function.calculate(population).at(0);
+          },
+          workers, timeout, maxAttempts)
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype>
+PopulationFitness ProcessFitness<Phenotype, Genotype>::calculate(
+                           const Population<Phenotype, Genotype>& population)
+{
+  std::vector<std::string> requests;
+  requests.reserve(population.size());
+  for (const auto& individual : population) requests.push_back(serialize_(individual));
+  return pool_.evaluate(requests, batchSize_);
+}
+
+}
@@ -0,0 +1,215 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_RACING_HEADER_SEEN_
+#define GENE_RACING_HEADER_SEEN_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Counters of a RacingFitness.
+ *****************************************************************************/
+struct RacingStatistics
+{
+  std::size_t requested = 0;    // individuals asked for
+  std::size_t sampled = 0;      // calls to the noisy function, per individual
+  std::size_t resampled = 0;    // of them, samples beyond the first
+  std::size_t rounds = 0;       // batches of resamples
+};
+
+/******************************************************************************
+ * Fitness function averaging the samples of a noisy one, taking more only
+ * where they can change the outcome of the selection. The samples of an
+ * individual are kept across generations under its key (e.g. a hash of the
+ * genotype, individuals with the same key being the same), so the elite
+ * and other survivors keep refining their mean instead of being trusted on
+ * a lucky sample; the estimates of the individuals no longer in the
+ * population are dropped once there are more than 'capacity'.
+ *
+ * calculateTop() races the individuals around the boundary between the
+ * 'count' fittest and the rest: while the confidence interval (the mean
+ * +- 'confidence' standard errors) of an individual contains the midpoint
+ * between the count-th and the next mean, it is sampled again, up to
+ * 'maxSamples' times. The standard deviation is pooled over the individuals
+ * of the population with several samples; until there is one, only the two
+ * individuals at the boundary are resampled. Each round of resamples is a
+ * single call to the noisy function. calculate() samples only the
+ * individuals not seen before, as there is no boundary to race on.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct RacingFitness : public FitnessFunction<Phenotype, Genotype>
+{
+  using Key = std::function<uint64_t(const Individual<Phenotype, Genotype>&)>;
+
+  RacingFitness(FitnessFunction<Phenotype, Genotype>& function,
+                Key key,
+                std::size_t maxSamples = 10,
+                double confidence = 2,
+                std::size_t capacity = 10000)
+    : function_(function),
+      key_(key),
+      maxSamples_(std::max<std::size_t>(maxSamples, 1)),
+      confidence_(confidence),
+      capacity_(capacity),
+      calls_(0)
+  {
+    // do nothing
+  }
+
+  PopulationFitness calculate(const Population<Phenotype, Genotype>& population) override
+  {
+    return calculateTop(population, population.size());
+  }
+
+  PopulationFitness calculateTop(const Population<Phenotype, Genotype>& population,
+                                 std::size_t count,
+                                 std::vector<bool>* bounded = nullptr) override
+  {
+    if (bounded != nullptr) bounded->clear();
+    std::size_t size = population.size();
+    statistics_.requested += size;
+    ++calls_;
+
+    // estimate of each individual, and the first individual of each key
+    std::vector<Estimate*> estimates(size);
+    std::vector<PopulationIndex> distinct;
+    for (PopulationIndex k = 0; k < size; ++k)
+    {
+      Estimate& estimate = estimates_[key_(population[k])];
+      if (estimate.used != calls_)
+      {
+        estimate.used = calls_;
+        distinct.push_back(k);
+      }
+      estimates[k] = &estimate;
+    }
+
+    std::vector<PopulationIndex> pending;
+    for (PopulationIndex k : distinct)
+    {
+      if (estimates[k]->samples == 0) pending.push_back(k);
+    }
+    sample(population, pending, estimates);
+
+    // race around the boundary until every interval is clear of it
+    std::vector<double> means(size);
+    while (count > 0 && count < size)
+    {
+      for (PopulationIndex k = 0; k < size; ++k) means[k] = estimates[k]->mean;
+      std::nth_element(means.begin(), means.begin() + count, means.end(),
+                       std::greater<double>());
+      double next = means[count];
+      double last = *std::min_element(means.begin(), means.begin() + count);
+      double boundary = (last + next) / 2;
+
+      double squares = 0;
+      std::size_t freedom = 0;
+      for (PopulationIndex k : distinct)
+      {
+        squares += estimates[k]->m2;
+        freedom += estimates[k]->samples - 1;
+      }
+
+      pending.clear();
+      for (PopulationIndex k : distinct)
+      {
+        const Estimate& estimate = *estimates[k];
+        if (estimate.samples >= maxSamples_) continue;
+        bool racing;
+        if (freedom == 0)
+        {
+          racing = estimate.mean == last || estimate.mean == next;
+        }
+        else
+        {
+          double error = std::sqrt(squares / freedom / estimate.samples);
+          racing = std::abs(estimate.mean - boundary) <= confidence_ * error;
+        }
+        if (racing) pending.push_back(k);
+      }
+      if (pending.empty()) break;
+
+      statistics_.resampled += pending.size();
+      ++statistics_.rounds;
+      sample(population, pending, estimates);
+    }
+
+    PopulationFitness fitness(size);
+    for (PopulationIndex k = 0; k < size; ++k) fitness[k] = estimates[k]->mean;
+
+    if (estimates_.size() > capacity_)
+    {
+      for (auto it = estimates_.begin(); it != estimates_.end(); )
+      {
+        if (it->second.used != calls_) it = estimates_.erase(it);
+        else ++it;
+      }
+    }
+    return fitness;
+  }
+
+  // Number of samples taken of the individual so far
+  std::size_t samples(const Individual<Phenotype, Genotype>& individual) const
+  {
+    auto it = estimates_.find(key_(individual));
+    return it == estimates_.end() ? 0 : it->second.samples;
+  }
+
+  const RacingStatistics& statistics() const { return statistics_; }
+
+  private:
+
+    // Running mean and sum of squared deviations of the samples
+    struct Estimate
+    {
+      std::size_t samples = 0;
+      double mean = 0;
+      double m2 = 0;
+      std::size_t used = 0;     // last call the key was seen in
+    };
+
+    // Takes one more sample of each of the given individuals
+    void sample(const Population<Phenotype, Genotype>& population,
+                const std::vector<PopulationIndex>& indices,
+                std::vector<Estimate*>& estimates)
+    {
+      if (indices.empty()) return;
+
+      Population<Phenotype, Genotype> batch;
+      batch.reserve(indices.size());
+      for (PopulationIndex k : indices) batch.push_back(population[k]);
+      PopulationFitness values = function_.calculate(batch);
+      statistics_.sampled += indices.size();
+
+      for (std::size_t i = 0; i < indices.size(); ++i)
+      {
+        Estimate& estimate = *estimates[indices[i]];
+        ++estimate.samples;
+        double delta = values[i] - estimate.mean;
+        estimate.mean += delta / estimate.samples;
+        estimate.m2 += delta * (values[i] - estimate.mean);
+      }
+    }
+
+    FitnessFunction<Phenotype, Genotype>& function_;
+    Key key_;
+    const std::size_t maxSamples_;
+    const double confidence_;
+    const std::size_t capacity_;
+    std::size_t calls_;
+    std::unordered_map<uint64_t, Estimate> estimates_;
+    RacingStatistics statistics_;
+};
+
+}
+#endif
@@ -5,7 +5,11 @@
 #ifndef GENE_SELECTION_HEADER_SEEN_
 #define GENE_SELECTION_HEADER_SEEN_
 
+#include "gene/policies.hpp"
 #include "gene/fitness.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <random>
 
 namespace gene
@@ -36,89 +40,320 @@ Survivors internalWheelSelection (const Population<Phenotype, Genotype>& populat
   return result;
 }
 
+namespace selection
+{
+
+///////////////////////////////////////////////////////////////////////////////
+// Key with the order of the fitness, so that it can be selected a digit at
+// a time; zeros of either sign get the same key, as they compare equal
+inline uint32_t orderedKey(FitnessType f)
+{
+  if (f == 0) f = 0;
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Indices of the 'count' highest fitness values, in increasing order; ties
+// at the threshold are broken by higher index, as the original selection
+// did walking a multimap backwards. The threshold is found by a
+// radix select over the keys (three passes of parallel per-block
+// histograms), and the survivors are compacted in parallel.
+inline std::vector<PopulationIndex> truncate(const PopulationFitness& fitness,
+                                             std::size_t count,
+                                             std::size_t threads)
+{
+  std::size_t size = fitness.size();
+  if (count >= size)
+  {
+    return parallelCompact(size, threads, [](std::size_t) { return true; });
+  }
+  if (count == 0) return std::vector<PopulationIndex>();
+
+  const std::size_t DIGITS[] = {11, 11, 10};
+  std::size_t blocks = blockCount(size, threads);
+  uint32_t prefix = 0;
+  std::size_t prefixBits = 0;
+  std::size_t needed = count;      // among the keys with that prefix
+  for (std::size_t digit : DIGITS)
+  {
+    std::size_t buckets = std::size_t(1) << digit;
+    std::size_t shift = 32 - prefixBits - digit;
+    std::vector<std::size_t> histograms(blocks * buckets, 0);
+    parallelBlocks(size, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+    {
+      std::size_t* histogram = histograms.data() + b * buckets;
+      for (std::size_t k = begin; k < end; ++k)
+      {
+        uint32_t key = orderedKey(fitness[k]);
+        if (prefixBits > 0 && (key >> (32 - prefixBits)) != prefix) continue;
+        ++histogram[(key >> shift) & (buckets - 1)];
+      }
+    });
+
+    // the bucket holding the last key needed, from the highest down
+    std::size_t above = 0;
+    std::size_t bucket = buckets;
+    while (bucket-- > 0)
+    {
+      std::size_t inBucket = 0;
+      for (std::size_t b = 0; b < blocks; ++b) inBucket += histograms[b * buckets + bucket];
+      if (above + inBucket >= needed) break;
+      above += inBucket;
+    }
+    needed -= above;
+    prefix = (prefix << digit) | uint32_t(bucket);
+    prefixBits += digit;
+  }
+
+  // keys above the threshold survive, and the last 'needed' equal to it
+  uint32_t threshold = prefix;
+  std::vector<std::size_t> ties(blocks + 1, 0);
+  parallelBlocks(size, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    std::size_t equal = 0;
+    for (std::size_t k = begin; k < end; ++k) equal += orderedKey(fitness[k]) == threshold;
+    ties[b + 1] = equal;
+  });
+  for (std::size_t b = 1; b <= blocks; ++b) ties[b] += ties[b - 1];
+  std::size_t skipped = ties[blocks] - needed;
+
+  std::vector<std::size_t> offsets(blocks + 1, 0);
+  parallelBlocks(size, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    std::size_t kept = 0;
+    for (std::size_t k = begin; k < end; ++k) kept += orderedKey(fitness[k]) > threshold;
+    std::size_t tiesTaken = ties[b + 1] - std::min(std::max(ties[b], skipped), ties[b + 1]);
+    offsets[b + 1] = kept + tiesTaken;
+  });
+  for (std::size_t b = 1; b <= blocks; ++b) offsets[b] += offsets[b - 1];
+
+  std::vector<PopulationIndex> result(offsets.back());
+  parallelBlocks(size, threads, [&](std::size_t b, std::size_t begin, std::size_t end)
+  {
+    std::size_t out = offsets[b];
+    std::size_t tie = ties[b];
+    for (std::size_t k = begin; k < end; ++k)
+    {
+      uint32_t key = orderedKey(fitness[k]);
+      if (key > threshold)
+      {
+        result[out++] = k;
+      }
+      else if (key == threshold && tie++ >= skipped)
+      {
+        result[out++] = k;
+      }
+    }
+  });
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Cumulative weights of the individuals for the wheel: their fitness minus
+// the lowest one when it is negative, or all equal if they sum to zero
+inline std::vector<double> wheel(const PopulationFitness& fitness, std::size_t threads)
+{
+  FitnessType lowest = 0;
+  for (FitnessType f : fitness) lowest = std::min(lowest, f);
+  std::vector<double> sums;
+  if (lowest < 0)
+  {
+    PopulationFitness shifted(fitness.size());
+    parallelFor(fitness.size(), threads, [&](std::size_t k) { shifted[k] = fitness[k] - lowest; });
+    sums = parallelPrefixSum<double>(shifted, threads);
+  }
+  else
+  {
+    sums = parallelPrefixSum<double>(fitness, threads);
+  }
+
+  if (!sums.empty() && !(sums.back() > 0))
+  {
+    parallelFor(sums.size(), threads, [&](std::size_t k) { sums[k] = double(k + 1); });
+  }
+  return sums;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Individual of the wheel at the given point of [0, total)
+inline PopulationIndex spin(const std::vector<double>& sums, double point)
+{
+  auto it = std::upper_bound(sums.begin(), sums.end(), point);
+  return it == sums.end() ? sums.size() - 1 : it - sums.begin();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Indices flagged, in increasing order
+inline std::vector<PopulationIndex> flagged(const std::vector<std::atomic<uint8_t>>& flags,
+                                            std::size_t threads)
+{
+  return parallelCompact(flags.size(), threads, [&](std::size_t k)
+  {
+    return flags[k].load(std::memory_order_relaxed) != 0;
+  });
+}
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
+// Roulette wheel selection of 'size' random points; an individual drawn
+// more than once survives once. The wheel is built with a parallel prefix
+// sum and split in a slice per thread ('threads' threads, the hardware
+// concurrency if 0); each thread draws the points of its slice in order,
+// so that it walks the wheel forward instead of searching it per point.
 template<typename Phenotype, typename Genotype>
 struct FitnessProportionateSelection : public SurvivalPolicy<Phenotype, Genotype>
 {
   private: const std::size_t size_;
+           const std::size_t threads_;
+           std::mt19937 generator_;
 
   public:
-  
-  FitnessProportionateSelection(std::size_t size) : size_(size) { }
+
+  FitnessProportionateSelection(std::size_t size, std::size_t threads = 1)
+    : size_(size), threads_(threads), generator_(std::random_device{}()) { }
 
   Survivors selectSurvivors (const Population<Phenotype, Genotype>& population,
                              const PopulationFitness& fitness) override
   {
-    Wheel wheel = computeWheel(fitness);
-    std::mt19937 generator {std::random_device{}()};
-    std::uniform_real_distribution<> distribution (0.0f, 1.0f);
-    std::multiset<float> points;
-    for (std::size_t k = 0; k < size_; ++k)
+    std::vector<PopulationIndex> survivors = selectIndices(population, fitness);
+    return Survivors(survivors.begin(), survivors.end());
+  }
+
+  std::vector<PopulationIndex> selectIndices (
+                            const Population<Phenotype, Genotype>& population,
+                            const PopulationFitness& fitness) override
+  {
+    if (fitness.empty()) return std::vector<PopulationIndex>();
+    std::vector<double> sums = selection::wheel(fitness, threads_);
+    std::vector<std::atomic<uint8_t>> flags(fitness.size());
+
+    // How many of the points fall in each of equal slices of the wheel
+    std::size_t blocks = blockCount(fitness.size(), threads_);
+    std::vector<std::size_t> points(blocks);
+    std::vector<uint32_t> seeds(blocks);
+    std::size_t remaining = size_;
+    for (std::size_t b = 0; b < blocks; ++b)
     {
-      points.insert(distribution(generator));
+      points[b] = std::binomial_distribution<std::size_t>(remaining, 1.0 / (blocks - b))(generator_);
+      remaining -= points[b];
+      seeds[b] = generator_();
     }
-    return internalWheelSelection(population, fitness, points);
+
+    // Each slice draws its points already sorted, as the normalized
+    // cumulative sums of exponential spacings, and walks the wheel forward
+    double total = sums.back();
+    parallelFor(blocks, blocks, [&](std::size_t b)
+    {
+      if (points[b] == 0) return;
+      std::mt19937 generator(seeds[b]);
+      std::exponential_distribution<double> spacing;
+      std::vector<double> cumulative(points[b] + 1);
+      double sum = 0;
+      for (double& c : cumulative) c = sum += spacing(generator);
+
+      double low = total * b / blocks;
+      double width = total * (b + 1) / blocks - low;
+      PopulationIndex index = selection::spin(sums, low + width * cumulative[0] / sum);
+      for (std::size_t k = 0; k < points[b]; ++k)
+      {
+        double point = low + width * cumulative[k] / sum;
+        while (index + 1 < sums.size() && sums[index] <= point) ++index;
+        flags[index].store(1, std::memory_order_relaxed);
+      }
+    });
+    return selection::flagged(flags, threads_);
   }
+
+  std::size_t threads() const override { return threads_; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
+// Stochastic universal sampling of 'size' equally spaced points; an
+// individual under several points survives once. Each thread looks up the
+// first point of its block and walks the wheel forward from there.
 template<typename Phenotype, typename Genotype>
 struct StochasticUniversalSampling : public SurvivalPolicy<Phenotype, Genotype>
 {
   private: const std::size_t size_;
+           const std::size_t threads_;
+           std::mt19937 generator_;
 
   public:
-  
-  StochasticUniversalSampling(std::size_t size) : size_(size) { }
+
+  StochasticUniversalSampling(std::size_t size, std::size_t threads = 1)
+    : size_(size), threads_(threads), generator_(std::random_device{}()) { }
 
   Survivors selectSurvivors (const Population<Phenotype, Genotype>& population,
                              const PopulationFitness& fitness) override
   {
-    float totalFitness = 1.0f;
-    float distanceBetweenPoints = totalFitness / size_;
-    std::mt19937 generator {std::random_device{}()};
-    std::uniform_real_distribution<> distribution (0.0f, distanceBetweenPoints);
-    float start = distribution(generator);
-    std::multiset<float> points;
-    for (std::size_t k = 0; k < size_; ++k)
+    std::vector<PopulationIndex> survivors = selectIndices(population, fitness);
+    return Survivors(survivors.begin(), survivors.end());
+  }
+
+  std::vector<PopulationIndex> selectIndices (
+                            const Population<Phenotype, Genotype>& population,
+                            const PopulationFitness& fitness) override
+  {
+    if (fitness.empty() || size_ == 0) return std::vector<PopulationIndex>();
+    std::vector<double> sums = selection::wheel(fitness, threads_);
+    std::vector<std::atomic<uint8_t>> flags(fitness.size());
+
+    double distance = sums.back() / size_;
+    double start = std::uniform_real_distribution<double>(0, distance)(generator_);
+    parallelBlocks(size_, threads_, [&](std::size_t, std::size_t begin, std::size_t end)
     {
-      float point = start + k * distanceBetweenPoints;
-      points.insert(point); 
-    }
-    return internalWheelSelection(population, fitness, points);
+      PopulationIndex index = selection::spin(sums, start + begin * distance);
+      for (std::size_t k = begin; k < end; ++k)
+      {
+        double point = start + k * distance;
+        while (index + 1 < sums.size() && sums[index] <= point) ++index;
+        flags[index].store(1, std::memory_order_relaxed);
+      }
+    });
+    return selection::flagged(flags, threads_);
   }
+
+  std::size_t threads() const override { return threads_; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
+// Keeps the 'size' fittest individuals (ties broken by higher index), found
+// by a parallel radix select on 'threads' threads (the hardware
+// concurrency if 0).
 template<typename Phenotype, typename Genotype>
 struct TruncationSelection: public SurvivalPolicy<Phenotype, Genotype>
 {
   private: const std::size_t size_;
+           const std::size_t threads_;
 
   public:
-  
-  TruncationSelection (std::size_t size) : size_(size) { }
+
+  TruncationSelection (std::size_t size, std::size_t threads = 1)
+    : size_(size), threads_(threads) { }
 
   Survivors selectSurvivors (const Population<Phenotype, Genotype>& population,
                              const PopulationFitness& fitness) override
   {
-    std::size_t populationSize = population.size();
-    std::multimap<FitnessType, PopulationIndex> fitnessMap;
-    for (PopulationIndex k = 0; k < populationSize; ++k)
-    {
-      fitnessMap.insert(std::make_pair(fitness[k], k));
-    }
+    std::vector<PopulationIndex> survivors = selectIndices(population, fitness);
+    return Survivors(survivors.begin(), survivors.end());
+  }
 
-    // select survivors from higher to lower fitness
-    Survivors result;
-    auto it = fitnessMap.crbegin();
-    auto end = fitnessMap.crend();
-    for (std::size_t i = 0; it != end && i < size_; ++i, ++it)
-    {
-      result.insert(it->second);
-    }
-    return result;
+  std::vector<PopulationIndex> selectIndices (
+                            const Population<Phenotype, Genotype>& population,
+                            const PopulationFitness& fitness) override
+  {
+    return selection::truncate(fitness, size_, threads_);
   }
+
+  std::size_t survivingRank(std::size_t populationSize) const override
+  {
+    return std::min(size_, populationSize);
+  }
+
+  std::size_t threads() const override { return threads_; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -162,6 +397,14 @@ struct TournamentSelection : public SurvivalPolicy<Phenotype, Genotype>
     }
     return result;
   }
+
+  // The tournamentSize_ - survivorsNumber_ least fit individuals lose every
+  // tournament they take part in
+  std::size_t survivingRank(std::size_t populationSize) const override
+  {
+    std::size_t losers = tournamentSize_ - std::min(survivorsNumber_, tournamentSize_);
+    return populationSize - std::min(losers, populationSize);
+  }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,101 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_STATIC_ALGORITHM_HEADER_SEEN_
+#define GENE_STATIC_ALGORITHM_HEADER_SEEN_
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Same generation loop as GeneticAlgorithm, with the operators given as
+ * template arguments. They are the existing operator classes, but the
+ * calls are qualified with their concrete types, so they are resolved at
+ * compile time and can be inlined into the loop instead of going through
+ * the virtual interfaces. The types must therefore be the concrete
+ * classes of the operators passed, not the interfaces. As in
+ * GeneticAlgorithm, only the individuals that may survive or be in the
+ * elite get an exact fitness (see FitnessFunction::calculateTop), and the
+ * observer, if any, sees each population with its fitness. Unlike
+ * GeneticAlgorithm, the elite is moved rather than copied into the new
+ * population, and the random generator is kept between generations.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype,
+         typename CodecType,
+         typename FitnessFunctionType,
+         typename MutationType,
+         typename MutationRateType,
+         typename MatingType,
+         typename CombinationType,
+         typename SurvivalType>
+struct StaticGeneticAlgorithm
+{
+  static_assert(std::is_base_of<Codec<Phenotype, Genotype>, CodecType>::value
+                && !std::is_abstract<FitnessFunctionType>::value
+                && !std::is_abstract<MutationType>::value
+                && !std::is_abstract<MutationRateType>::value
+                && !std::is_abstract<MatingType>::value
+                && !std::is_abstract<CombinationType>::value
+                && !std::is_abstract<SurvivalType>::value,
+                "operators must be concrete classes");
+
+  StaticGeneticAlgorithm (CodecType& codec,
+                          FitnessFunctionType& fitnessFunction,
+                          MutationType& mutationStrategy,
+                          MutationRateType& mutationRate,
+                          MatingType& matingStrategy,
+                          CombinationType& combinationStrategy,
+                          SurvivalType& survivalPolicy,
+                          GenerationObserver<Phenotype, Genotype>* observer = nullptr,
+                          uint32_t seed = std::random_device{}());
+
+  Population<Phenotype, Genotype> iterate(Population<Phenotype,Genotype>&& population,
+                                          std::size_t eliteSize);
+
+  private:
+
+    CodecType& codec_;
+    FitnessFunctionType& fitnessFunction_;
+    MutationType& mutationStrategy_;
+    MutationRateType& mutationRate_;
+    MatingType& matingStrategy_;
+    CombinationType& combinationStrategy_;
+    SurvivalType& survivalPolicy_;
+    GenerationObserver<Phenotype, Genotype>* observer_;
+    std::mt19937 generator_;
+};
+
+/******************************************************************************
+ * Builds a StaticGeneticAlgorithm deducing the operator types, e.g.
+ * makeStaticGeneticAlgorithm<Phenotype, Genotype>(codec, fitness, ...)
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype,
+         typename CodecType,
+         typename FitnessFunctionType,
+         typename MutationType,
+         typename MutationRateType,
+         typename MatingType,
+         typename CombinationType,
+         typename SurvivalType>
+StaticGeneticAlgorithm<Phenotype, Genotype, CodecType, FitnessFunctionType,
+                       MutationType, MutationRateType, MatingType,
+                       CombinationType, SurvivalType>
+makeStaticGeneticAlgorithm(CodecType& codec,
+                           FitnessFunctionType& fitnessFunction,
+                           MutationType& mutationStrategy,
+                           MutationRateType& mutationRate,
+                           MatingType& matingStrategy,
+                           CombinationType& combinationStrategy,
+                           SurvivalType& survivalPolicy,
+                           GenerationObserver<Phenotype, Genotype>* observer = nullptr,
+                           uint32_t seed = std::random_device{}());
+
+}
+
+#include "gene/static_algorithm_impl.hpp"
+#endif
@@ -0,0 +1,168 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace gene {
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype,
+         typename CodecType,
+         typename FitnessFunctionType,
+         typename MutationType,
+         typename MutationRateType,
+         typename MatingType,
+         typename CombinationType,
+         typename SurvivalType>
+StaticGeneticAlgorithm<Phenotype, Genotype, CodecType, FitnessFunctionType,
+                       MutationType, MutationRateType, MatingType,
+                       CombinationType, SurvivalType>::StaticGeneticAlgorithm (
+         CodecType& codec,
+         FitnessFunctionType& fitnessFunction,
+         MutationType& mutationStrategy,
+         MutationRateType& mutationRate,
+         MatingType& matingStrategy,
+         CombinationType& combinationStrategy,
+         SurvivalType& survivalPolicy,
+         GenerationObserver<Phenotype, Genotype>* observer,
+         uint32_t seed)
+  : codec_(codec),
+    fitnessFunction_(fitnessFunction),
+    mutationStrategy_(mutationStrategy),
+    mutationRate_(mutationRate),
+    matingStrategy_(matingStrategy),
+    combinationStrategy_(combinationStrategy),
+    survivalPolicy_(survivalPolicy),
+    observer_(observer),
+    generator_(seed)
+{
+  // do nothing
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype,
+         typename CodecType,
+         typename FitnessFunctionType,
+         typename MutationType,
+         typename MutationRateType,
+         typename MatingType,
+         typename CombinationType,
+         typename SurvivalType>
+Population<Phenotype, Genotype>
+StaticGeneticAlgorithm<Phenotype, Genotype, CodecType, FitnessFunctionType,
+                       MutationType, MutationRateType, MatingType,
+                       CombinationType, SurvivalType>::iterate(
+         Population<Phenotype, Genotype>&& p,
+         std::size_t eliteSize)
+{
+  const Codec<Phenotype, Genotype>& codec = codec_;
+
+  // Calculate fitness of the whole population; only the individuals that
+  // may survive or be in the elite need an exact one
+  std::size_t ranked = std::max(survivalPolicy_.SurvivalType::survivingRank(p.size()),
+                                eliteSize);
+  std::vector<bool> bounded;
+  PopulationFitness fitness =
+     fitnessFunction_.FitnessFunctionType::calculateTop(p, ranked, &bounded);
+  if (observer_ != nullptr) observer_->observe(p, fitness, bounded);
+
+  // Select elite for later, best first
+  std::vector<PopulationIndex> elite(p.size());
+  for (PopulationIndex k = 0; k < elite.size(); ++k) elite[k] = k;
+  eliteSize = std::min(eliteSize, elite.size());
+  std::partial_sort(elite.begin(), elite.begin() + eliteSize, elite.end(),
+                    [&fitness](PopulationIndex a, PopulationIndex b)
+                    { return fitness[a] > fitness[b]; });
+  elite.resize(eliteSize);
+
+  // Apply selection policy
+  std::vector<PopulationIndex> survivors =
+     survivalPolicy_.SurvivalType::selectIndices(p, fitness);
+
+  // filter fitness for dropped individuals; select only moves the
+  // survivors out of p
+  Population<Phenotype, Genotype> population = survivalPolicy_.select(std::move(p), survivors);
+  fitness = survivalPolicy_.select(std::move(fitness), survivors);
+
+  // Determine the mating among individuals of the population
+  auto mating = matingStrategy_.MatingType::mating(population, fitness);
+
+  // Combine each of the pairs specified in the calculated mating
+  Population<Phenotype, Genotype> offspring;
+  offspring.reserve(mating.size() + eliteSize);
+  for (const auto& entry : mating)
+  {
+    PopulationIndex index1 = std::get<0>(entry);
+    PopulationIndex index2 = std::get<1>(entry);
+    NumberOfChildren numOffspring = std::get<2>(entry);
+
+    const Individual<Phenotype, Genotype>& i1 = population[index1];
+    const Individual<Phenotype, Genotype>& i2 = population[index2];
+
+    for (std::size_t k = 0; k < numOffspring; ++k)
+    {
+      offspring.push_back(combinationStrategy_.CombinationType::combine(i1, i2, codec));
+    }
+  }
+
+  // Mutate offspring
+  PopulationMutationRates rates =
+     mutationRate_.MutationRateType::mutationProbability(offspring);
+  std::size_t offspringSize = offspring.size();
+  for (std::size_t k = 0; k < offspringSize; ++k)
+  {
+    std::bernoulli_distribution mutation(rates[k]);
+    if (mutation(generator_))
+    {
+      mutationStrategy_.MutationType::mutateInPlace(offspring[k], codec, nullptr);
+    }
+  }
+
+  // Keep the best from the previous generation (i.e. elitism), moving them
+  // from wherever selection left them
+  for (PopulationIndex index : elite)
+  {
+    auto survivor = std::lower_bound(survivors.begin(), survivors.end(), index);
+    if (survivor == survivors.end() || *survivor != index)
+    {
+      offspring.push_back(std::move(p[index]));
+    }
+    else
+    {
+      offspring.push_back(std::move(population[survivor - survivors.begin()]));
+    }
+  }
+
+  return offspring;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Phenotype, typename Genotype,
+         typename CodecType,
+         typename FitnessFunctionType,
+         typename MutationType,
+         typename MutationRateType,
+         typename MatingType,
+         typename CombinationType,
+         typename SurvivalType>
+StaticGeneticAlgorithm<Phenotype, Genotype, CodecType, FitnessFunctionType,
+                       MutationType, MutationRateType, MatingType,
+                       CombinationType, SurvivalType>
+makeStaticGeneticAlgorithm(CodecType& codec,
+                           FitnessFunctionType& fitnessFunction,
+                           MutationType& mutationStrategy,
+                           MutationRateType& mutationRate,
+                           MatingType& matingStrategy,
+                           CombinationType& combinationStrategy,
+                           SurvivalType& survivalPolicy,
+                           GenerationObserver<Phenotype, Genotype>* observer,
+                           uint32_t seed)
+{
+  return {codec, fitnessFunction, mutationStrategy, mutationRate,
+          matingStrategy, combinationStrategy, survivalPolicy, observer, seed};
+}
+
+}
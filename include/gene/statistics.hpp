@@ -0,0 +1,342 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_STATISTICS_HEADER_SEEN_
+#define GENE_STATISTICS_HEADER_SEEN_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Count, mean, variance and range of a stream of values, updated one value
+ * at a time (Welford's method).
+ *****************************************************************************/
+struct RunningStatistics
+{
+  std::size_t count = 0;
+  double mean = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  void add(double x)
+  {
+    ++count;
+    double delta = x - mean;
+    mean += delta / count;
+    m2_ += delta * (x - mean);
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  // Population variance of the values added
+  double variance() const { return count == 0 ? 0 : m2_ / count; }
+
+  double deviation() const { return std::sqrt(variance()); }
+
+  private:
+    double m2_ = 0;
+};
+
+/******************************************************************************
+ * Position of the lowest bit set in a non zero word.
+ *****************************************************************************/
+inline std::size_t lowestBit(uint64_t w)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(w);
+#else
+  std::size_t k = 0;
+  for (; (w & 1) == 0; w >>= 1) ++k;
+  return k;
+#endif
+}
+
+/******************************************************************************
+ * Counts, for every bit position of a sequence of words, how many of the
+ * sequences added have it set. The counts are kept bit-sliced: plane p
+ * holds bit p of the count of every position, so adding a word updates its
+ * 64 counters at once with a few logical operations (a ripple carry that
+ * is two operations per word on average).
+ *****************************************************************************/
+struct LocusCounter
+{
+  using Word = uint64_t;
+
+  LocusCounter() : words_(0) { }
+
+  void clear()
+  {
+    planes_.clear();
+    words_ = 0;
+  }
+
+  // Adds one to the counter of every bit set in the 'count' words
+  void add(const Word* words, std::size_t count)
+  {
+    if (count > words_)
+    {
+      words_ = count;
+      for (std::vector<Word>& plane : planes_) plane.resize(words_, 0);
+    }
+    for (std::size_t w = 0; w < count; ++w)
+    {
+      Word carry = words[w];
+      for (std::size_t p = 0; carry != 0; ++p)
+      {
+        if (p == planes_.size()) planes_.emplace_back(words_, 0);
+        Word& plane = planes_[p][w];
+        Word next = plane & carry;
+        plane ^= carry;
+        carry = next;
+      }
+    }
+  }
+
+  // Number of words counted per sequence, i.e. bit positions / 64
+  std::size_t words() const { return words_; }
+
+  // Counters of all the bit positions
+  std::vector<std::size_t> counts() const
+  {
+    std::vector<std::size_t> result(words_ * 64, 0);
+    for (std::size_t p = 0; p < planes_.size(); ++p)
+    {
+      for (std::size_t w = 0; w < words_; ++w)
+      {
+        for (Word bits = planes_[p][w]; bits != 0; bits &= bits - 1)
+        {
+          result[w * 64 + lowestBit(bits)] += std::size_t(1) << p;
+        }
+      }
+    }
+    return result;
+  }
+
+  private:
+
+    std::size_t words_;
+    std::vector<std::vector<Word>> planes_;
+};
+
+/******************************************************************************
+ * Shannon entropy, in bits, of a distribution given by counts summing to
+ * 'total'.
+ *****************************************************************************/
+inline double entropy(const std::size_t* counts, std::size_t symbols, std::size_t total)
+{
+  double h = 0;
+  for (std::size_t s = 0; s < symbols; ++s)
+  {
+    if (counts[s] == 0 || counts[s] == total) continue;
+    double p = double(counts[s]) / total;
+    h -= p * std::log2(p);
+  }
+  return h;
+}
+
+/******************************************************************************
+ * Number of the sequences of the given lengths that cover each position,
+ * up to the longest one.
+ *****************************************************************************/
+inline std::vector<std::size_t> coverage(const std::vector<std::size_t>& lengths)
+{
+  std::size_t longest = lengths.empty() ? 0 : *std::max_element(lengths.begin(), lengths.end());
+  std::vector<std::size_t> result(longest + 1, 0);
+  for (std::size_t length : lengths) ++result[length];
+  std::size_t covering = 0;
+  for (std::size_t k = longest + 1; k-- > 0; )
+  {
+    std::size_t ending = result[k];
+    result[k] = covering;
+    covering += ending;
+  }
+  result.pop_back();
+  return result;
+}
+
+/******************************************************************************
+ * Estimates of the genotype diversity of a population. Those an estimator
+ * does not provide are NaN.
+ *****************************************************************************/
+struct Diversity
+{
+  // Mean distance between two individuals (e.g. Hamming distance, or
+  // squared euclidean distance for real vectors)
+  double meanDistance = std::numeric_limits<double>::quiet_NaN();
+
+  // Mean entropy of the loci, normalized to [0, 1]
+  double entropy = std::numeric_limits<double>::quiet_NaN();
+
+  // Mean Jaccard distance between the sets of k-mers of two individuals
+  double kmerDistance = std::numeric_limits<double>::quiet_NaN();
+};
+
+/******************************************************************************
+ * Interface abstracting the estimation of the diversity of a population in
+ * one pass over its genotypes. The genotypes passed to add() are only valid
+ * until estimate() returns.
+ *****************************************************************************/
+template<typename Genotype>
+struct DiversityEstimator
+{
+  virtual void clear() = 0;
+  virtual void add(const Genotype&) = 0;
+  virtual Diversity estimate() = 0;
+  virtual ~DiversityEstimator() { }
+};
+
+/******************************************************************************
+ * Estimates the mean distance with the given function over 'pairs' random
+ * pairs of individuals (all of them if there are fewer). Fallback for
+ * genotypes without a specific estimator.
+ *****************************************************************************/
+template<typename Genotype>
+struct SampledDiversity : public DiversityEstimator<Genotype>
+{
+  using Distance = std::function<double(const Genotype&, const Genotype&)>;
+
+  SampledDiversity(Distance distance,
+                   std::size_t pairs = 1000,
+                   uint32_t seed = std::random_device{}())
+    : distance_(distance), pairs_(pairs), generator_(seed)
+  {
+    // do nothing
+  }
+
+  void clear() override { genotypes_.clear(); }
+
+  void add(const Genotype& genotype) override { genotypes_.push_back(&genotype); }
+
+  Diversity estimate() override
+  {
+    Diversity result;
+    std::size_t n = genotypes_.size();
+    if (n < 2) return result;
+
+    double sum = 0;
+    std::size_t count = 0;
+    if (n * (n - 1) / 2 <= pairs_)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        for (std::size_t j = i + 1; j < n; ++j, ++count)
+        {
+          sum += distance_(*genotypes_[i], *genotypes_[j]);
+        }
+      }
+    }
+    else
+    {
+      std::uniform_int_distribution<std::size_t> first(0, n - 1), second(0, n - 2);
+      for (; count < pairs_; ++count)
+      {
+        std::size_t i = first(generator_);
+        std::size_t j = second(generator_);
+        if (j >= i) ++j;
+        sum += distance_(*genotypes_[i], *genotypes_[j]);
+      }
+    }
+    result.meanDistance = sum / count;
+    return result;
+  }
+
+  private:
+
+    Distance distance_;
+    const std::size_t pairs_;
+    std::mt19937 generator_;
+    std::vector<const Genotype*> genotypes_;
+};
+
+/******************************************************************************
+ * Statistics of one generation.
+ *****************************************************************************/
+struct GenerationStatistics
+{
+  std::size_t generation = 0;
+  RunningStatistics fitness;
+  FitnessType bestEver = std::numeric_limits<FitnessType>::lowest();
+  std::size_t stagnation = 0;      // generations since bestEver improved
+  Diversity diversity;
+};
+
+/******************************************************************************
+ * Observer computing the statistics of each generation in a single pass
+ * over the population: running fitness statistics, the best fitness so far
+ * and the diversity estimated by 'diversity' (if any). The statistics are
+ * kept in history() and passed to 'report' (if any).
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct PopulationStatistics : public GenerationObserver<Phenotype, Genotype>
+{
+  using Report = std::function<void(const GenerationStatistics&)>;
+
+  PopulationStatistics(DiversityEstimator<Genotype>* diversity = nullptr,
+                       Report report = Report())
+    : diversity_(diversity), report_(report)
+  {
+    // do nothing
+  }
+
+  void observe(const Population<Phenotype, Genotype>& population,
+               const PopulationFitness& fitness) override
+  {
+    observe(population, fitness, std::vector<bool>());
+  }
+
+  // Bounded fitness is left out of the fitness statistics, but the
+  // individuals still count for the diversity
+  void observe(const Population<Phenotype, Genotype>& population,
+               const PopulationFitness& fitness,
+               const std::vector<bool>& bounded) override
+  {
+    GenerationStatistics statistics;
+    statistics.generation = history_.size();
+    if (diversity_ != nullptr) diversity_->clear();
+    for (PopulationIndex k = 0; k < population.size(); ++k)
+    {
+      if (bounded.empty() || !bounded[k]) statistics.fitness.add(fitness[k]);
+      if (diversity_ != nullptr) diversity_->add(population[k].second);
+    }
+    if (diversity_ != nullptr)
+    {
+      statistics.diversity = diversity_->estimate();
+      diversity_->clear();
+    }
+
+    if (!history_.empty())
+    {
+      statistics.bestEver = history_.back().bestEver;
+      statistics.stagnation = history_.back().stagnation + 1;
+    }
+    if (statistics.fitness.count > 0 && statistics.fitness.max > statistics.bestEver)
+    {
+      statistics.bestEver = statistics.fitness.max;
+      statistics.stagnation = 0;
+    }
+
+    history_.push_back(statistics);
+    if (report_) report_(history_.back());
+  }
+
+  const std::vector<GenerationStatistics>& history() const { return history_; }
+
+  private:
+
+    DiversityEstimator<Genotype>* diversity_;
+    Report report_;
+    std::vector<GenerationStatistics> history_;
+};
+
+}
+#endif
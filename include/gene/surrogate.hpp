@@ -0,0 +1,286 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_SURROGATE_HEADER_SEEN_
+#define GENE_SURROGATE_HEADER_SEEN_
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Counters of a SurrogateFitness. Evaluations saved are those of the
+ * screened out individuals plus those answered from the archive.
+ *****************************************************************************/
+struct SurrogateStatistics
+{
+  std::size_t requested = 0;    // individuals asked for
+  std::size_t evaluated = 0;    // real evaluations
+  std::size_t screened = 0;     // individuals given their predicted fitness
+  std::size_t archived = 0;     // individuals found in the archive
+
+  // Quality of the predictions made for the individuals then evaluated
+  double absoluteErrorSum = 0;
+  std::size_t predictions = 0;
+  double rankCorrelationSum = 0;
+  std::size_t correlatedBatches = 0;
+
+  std::size_t saved() const { return screened + archived; }
+
+  double meanAbsoluteError() const
+  {
+    return predictions == 0 ? 0 : absoluteErrorSum / predictions;
+  }
+
+  // Mean over batches of the Spearman correlation between predicted and
+  // real fitness
+  double meanRankCorrelation() const
+  {
+    return correlatedBatches == 0 ? 0 : rankCorrelationSum / correlatedBatches;
+  }
+};
+
+/******************************************************************************
+ * Fitness function that pre-screens individuals with a cheap model before
+ * calling an expensive one. The model predicts the fitness of an
+ * individual from its features (a vector of doubles, e.g. the values of
+ * EvolutionParams) as the inverse distance weighted mean of its nearest
+ * neighbours in an archive of real evaluations. Only the 'fraction' of
+ * each batch with the best predictions is evaluated by the wrapped
+ * function; the rest get their prediction, lowered to the worst real
+ * fitness of the batch so that they never rank above an evaluated
+ * individual. Individuals whose features are already in the archive get
+ * the archived fitness. Until the archive holds 'neighbours' entries every
+ * individual is evaluated.
+ * Features should be scaled so that euclidean distances are meaningful,
+ * and generating more offspring than needed lets the screening choose.
+ *****************************************************************************/
+template<typename Phenotype, typename Genotype>
+struct SurrogateFitness : public FitnessFunction<Phenotype, Genotype>
+{
+  using Features = std::function<std::vector<double>(const Individual<Phenotype, Genotype>&)>;
+
+  SurrogateFitness(FitnessFunction<Phenotype, Genotype>& function,
+                   Features features,
+                   double fraction = 0.3,
+                   std::size_t neighbours = 5,
+                   std::size_t capacity = 2000)
+    : function_(function),
+      features_(features),
+      fraction_(fraction),
+      neighbours_(std::max<std::size_t>(neighbours, 1)),
+      capacity_(std::max<std::size_t>(capacity, 1)),
+      dimension_(0),
+      archiveSize_(0),
+      next_(0)
+  {
+    // do nothing
+  }
+
+  PopulationFitness calculate(const Population<Phenotype, Genotype>& population) override
+  {
+    std::size_t size = population.size();
+    statistics_.requested += size;
+
+    std::vector<double> points;
+    std::size_t dimension = 0;
+    for (PopulationIndex k = 0; k < size; ++k)
+    {
+      std::vector<double> f = features_(population[k]);
+      if (k == 0) dimension = f.size();
+      if (f.size() != dimension) throw std::invalid_argument("features of different sizes");
+      points.insert(points.end(), f.begin(), f.end());
+    }
+    if (size == 0) return PopulationFitness();
+    if (fitness_.empty() || dimension != dimension_) reset(dimension);
+
+    // predictions, and fitness of the individuals already in the archive
+    PopulationFitness fitness(size, 0);
+    std::vector<double> predicted(size, 0);
+    std::vector<PopulationIndex> pending;
+    bool screening = archiveSize_ >= neighbours_;
+    for (PopulationIndex k = 0; k < size; ++k)
+    {
+      bool known = false;
+      if (screening) predicted[k] = predict(points.data() + k * dimension_, known);
+      if (known)
+      {
+        fitness[k] = predicted[k];
+        ++statistics_.archived;
+      }
+      else
+      {
+        pending.push_back(k);
+      }
+    }
+
+    // the most promising go to the real function
+    std::size_t count = pending.size();
+    if (screening)
+    {
+      count = std::min(pending.size(),
+                       std::size_t(std::ceil(fraction_ * pending.size())));
+      std::partial_sort(pending.begin(), pending.begin() + count, pending.end(),
+                        [&predicted](PopulationIndex a, PopulationIndex b)
+                        { return predicted[a] > predicted[b]; });
+    }
+
+    PopulationFitness real;
+    if (count > 0)
+    {
+      Population<Phenotype, Genotype> chosen;
+      chosen.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) chosen.push_back(population[pending[i]]);
+      real = function_.calculate(chosen);
+      statistics_.evaluated += count;
+    }
+
+    // with nothing evaluated, the screened ones rank below the archive
+    FitnessType worst = std::numeric_limits<FitnessType>::max();
+    if (count == 0)
+    {
+      for (std::size_t a = 0; a < archiveSize_; ++a) worst = std::min(worst, fitness_[a]);
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      PopulationIndex k = pending[i];
+      fitness[k] = real[i];
+      worst = std::min(worst, real[i]);
+      add(points.data() + k * dimension_, real[i]);
+    }
+    for (std::size_t i = count; i < pending.size(); ++i)
+    {
+      PopulationIndex k = pending[i];
+      fitness[k] = std::min<FitnessType>(predicted[k], worst);
+      ++statistics_.screened;
+    }
+
+    if (screening) score(pending, count, predicted, real);
+    return fitness;
+  }
+
+  const SurrogateStatistics& statistics() const { return statistics_; }
+
+  private:
+
+    // Inverse distance weighted mean of the fitness of the nearest
+    // neighbours; 'known' is set when the point is in the archive
+    double predict(const double* point, bool& known) const
+    {
+      std::vector<std::pair<double, std::size_t>> nearest;
+      nearest.reserve(neighbours_ + 1);
+      for (std::size_t a = 0; a < archiveSize_; ++a)
+      {
+        const double* other = archive_.data() + a * dimension_;
+        double distance = 0;
+        for (std::size_t j = 0; j < dimension_; ++j)
+        {
+          double d = point[j] - other[j];
+          distance += d * d;
+        }
+        if (distance == 0)
+        {
+          known = true;
+          return fitness_[a];
+        }
+        if (nearest.size() == neighbours_ && distance >= nearest.back().first) continue;
+        auto position = std::upper_bound(nearest.begin(), nearest.end(),
+                                         std::make_pair(distance, a));
+        nearest.insert(position, std::make_pair(distance, a));
+        if (nearest.size() > neighbours_) nearest.pop_back();
+      }
+
+      double sum = 0, weights = 0;
+      for (const auto& entry : nearest)
+      {
+        double weight = 1 / entry.first;
+        sum += weight * fitness_[entry.second];
+        weights += weight;
+      }
+      return sum / weights;
+    }
+
+    // Adds a real evaluation, replacing the oldest once the archive is full
+    void add(const double* point, FitnessType fitness)
+    {
+      std::copy(point, point + dimension_, archive_.data() + next_ * dimension_);
+      fitness_[next_] = fitness;
+      next_ = (next_ + 1) % capacity_;
+      archiveSize_ = std::min(archiveSize_ + 1, capacity_);
+    }
+
+    // Empties the archive, for features of the given dimension
+    void reset(std::size_t dimension)
+    {
+      dimension_ = dimension;
+      archive_.assign(capacity_ * dimension_, 0);
+      fitness_.assign(capacity_, 0);
+      archiveSize_ = 0;
+      next_ = 0;
+    }
+
+    // Accuracy of the predictions for the evaluated individuals
+    void score(const std::vector<PopulationIndex>& pending,
+               std::size_t count,
+               const std::vector<double>& predicted,
+               const PopulationFitness& real)
+    {
+      std::vector<double> p(count), r(count);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        p[i] = predicted[pending[i]];
+        r[i] = real[i];
+        statistics_.absoluteErrorSum += std::abs(p[i] - r[i]);
+      }
+      statistics_.predictions += count;
+      if (count < 2) return;
+
+      std::vector<double> pr = ranks(p);
+      std::vector<double> rr = ranks(r);
+      double mean = (count - 1) / 2.0;
+      double covariance = 0, variance = 0;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        covariance += (pr[i] - mean) * (rr[i] - mean);
+        variance += (pr[i] - mean) * (pr[i] - mean);
+      }
+      statistics_.rankCorrelationSum += covariance / variance;
+      ++statistics_.correlatedBatches;
+    }
+
+    static std::vector<double> ranks(const std::vector<double>& values)
+    {
+      std::vector<std::size_t> order(values.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(),
+                [&values](std::size_t a, std::size_t b) { return values[a] < values[b]; });
+      std::vector<double> result(values.size());
+      for (std::size_t i = 0; i < order.size(); ++i) result[order[i]] = i;
+      return result;
+    }
+
+    FitnessFunction<Phenotype, Genotype>& function_;
+    Features features_;
+    const double fraction_;
+    const std::size_t neighbours_;
+    const std::size_t capacity_;
+
+    std::size_t dimension_;
+    std::vector<double> archive_;    // features of the evaluations, as rows
+    PopulationFitness fitness_;
+    std::size_t archiveSize_;
+    std::size_t next_;
+    SurrogateStatistics statistics_;
+};
+
+}
+#endif
@@ -0,0 +1,180 @@
+// Copyright (c) 2013, Noe Casas (noe.casas@gmail.com).
+// Distributed under New BSD License.
+// (see accompanying file COPYING)
+
+#ifndef GENE_TUNING_HEADER_SEEN_
+#define GENE_TUNING_HEADER_SEEN_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gene/parallel.hpp"
+#include "gene/policies.hpp"
+
+namespace gene {
+
+/******************************************************************************
+ * Run of one configuration of an algorithm being tuned, advanced by
+ * evaluation budget.
+ *****************************************************************************/
+struct TuningRun
+{
+  // Goes on until 'evaluations' fitness evaluations have been made since
+  // the start, evaluating only part of the last generation if it would go
+  // over, and returns the best fitness found so far
+  virtual FitnessType advance(std::size_t evaluations) = 0;
+
+  // Fitness evaluations made since the start
+  virtual std::size_t evaluations() const = 0;
+
+  virtual ~TuningRun() { }
+};
+
+/******************************************************************************
+ * Configuration to tune: its name in the results, and how to start a run
+ * of it from a seed. Runs of different configurations and seeds advance
+ * concurrently, so they must not share operators.
+ *****************************************************************************/
+struct TuningConfiguration
+{
+  std::string name;
+  std::function<std::unique_ptr<TuningRun>(uint32_t seed)> start;
+};
+
+/******************************************************************************
+ * Outcome of a configuration: the best fitness of each of its runs at the
+ * last rung it reached, and their mean.
+ *****************************************************************************/
+struct TuningResult
+{
+  std::string name;
+  std::size_t rung = 0;
+  std::size_t budget = 0;        // evaluations per run at that rung
+  std::size_t evaluations = 0;   // made by all its runs
+  FitnessType mean = 0;
+  FitnessType best = 0;
+  FitnessType worst = 0;
+};
+
+/******************************************************************************
+ * Tunes configurations by successive halving. Every configuration starts
+ * 'seeds' runs, seeded seed, seed + 1... so that all face the same
+ * initial conditions. At each rung the runs of the remaining configurations
+ * advance to the rung's budget, 'minBudget' evaluations at the first and
+ * 'eta' times more at each next one, on 'threads' threads (the hardware
+ * concurrency if 0); then only the best 1/eta of the configurations, by
+ * mean fitness, go on. Tuning ends when one is left or the budget reaches
+ * 'maxBudget'. Runs are only as reproducible as their operators.
+ *****************************************************************************/
+struct SuccessiveHalving
+{
+  SuccessiveHalving(std::size_t seeds = 3,
+                    std::size_t minBudget = 1000,
+                    std::size_t maxBudget = 100000,
+                    std::size_t eta = 3,
+                    std::size_t threads = 0,
+                    uint32_t seed = 1)
+    : seeds_(seeds),
+      minBudget_(minBudget),
+      maxBudget_(maxBudget),
+      eta_(eta),
+      threads_(threads),
+      seed_(seed)
+  {
+    if (seeds == 0 || minBudget == 0 || eta < 2)
+    {
+      throw std::invalid_argument("successive halving needs seeds, budget and eta > 1");
+    }
+  }
+
+  // Results of every configuration, those reaching further rungs first and
+  // then by mean fitness
+  std::vector<TuningResult> tune(const std::vector<TuningConfiguration>& configurations) const
+  {
+    std::size_t count = configurations.size();
+    std::vector<std::unique_ptr<TuningRun>> runs(count * seeds_);
+    std::vector<FitnessType> best(count * seeds_);
+    std::vector<TuningResult> results(count);
+    for (std::size_t c = 0; c < count; ++c) results[c].name = configurations[c].name;
+
+    std::vector<std::size_t> alive(count);
+    for (std::size_t c = 0; c < count; ++c) alive[c] = c;
+
+    std::size_t budget = std::min(minBudget_, maxBudget_);
+    for (std::size_t rung = 0; !alive.empty(); ++rung)
+    {
+      parallelDynamic(alive.size() * seeds_, threads_, [&](std::size_t job)
+      {
+        std::size_t c = alive[job / seeds_];
+        std::size_t run = c * seeds_ + job % seeds_;
+        if (!runs[run]) runs[run] = configurations[c].start(seed_ + job % seeds_);
+        best[run] = runs[run]->advance(budget);
+      });
+
+      for (std::size_t c : alive)
+      {
+        TuningResult& result = results[c];
+        result.rung = rung;
+        result.budget = budget;
+        result.evaluations = 0;
+        double sum = 0;
+        for (std::size_t s = 0; s < seeds_; ++s)
+        {
+          std::size_t run = c * seeds_ + s;
+          FitnessType f = best[run];
+          result.evaluations += runs[run]->evaluations();
+          result.best = s == 0 ? f : std::max(result.best, f);
+          result.worst = s == 0 ? f : std::min(result.worst, f);
+          sum += f;
+        }
+        result.mean = sum / seeds_;
+      }
+
+      if (alive.size() <= 1 || budget >= maxBudget_) break;
+
+      std::sort(alive.begin(), alive.end(), [&results](std::size_t a, std::size_t b)
+                { return results[a].mean > results[b].mean; });
+      std::size_t kept = (alive.size() + eta_ - 1) / eta_;
+      for (std::size_t i = kept; i < alive.size(); ++i)
+      {
+        for (std::size_t s = 0; s < seeds_; ++s) runs[alive[i] * seeds_ + s].reset();
+      }
+      alive.resize(kept);
+      budget = std::min(budget * eta_, maxBudget_);
+    }
+
+    std::sort(results.begin(), results.end(), [](const TuningResult& a, const TuningResult& b)
+              { return a.rung != b.rung ? a.rung > b.rung : a.mean > b.mean; });
+    return results;
+  }
+
+  private:
+    const std::size_t seeds_;
+    const std::size_t minBudget_;
+    const std::size_t maxBudget_;
+    const std::size_t eta_;
+    const std::size_t threads_;
+    const uint32_t seed_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes the results as a table of tab separated columns, with a header
+inline void writeTable(std::ostream& out, const std::vector<TuningResult>& results)
+{
+  out << "configuration\trung\tbudget\tevaluations\tmean\tbest\tworst\n";
+  for (const TuningResult& result : results)
+  {
+    out << result.name << '\t' << result.rung << '\t' << result.budget << '\t'
+        << result.evaluations << '\t' << result.mean << '\t' << result.best << '\t'
+        << result.worst << '\n';
+  }
+}
+
+}
+#endif
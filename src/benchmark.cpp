@@ -0,0 +1,1132 @@
+#include "gene/algorithm.hpp"
+#include "gene/async.hpp"
+#include "gene/bounded.hpp"
+#include "gene/racing.hpp"
+#include "gene/static_algorithm.hpp"
+#include "gene/surrogate.hpp"
+#include "gene/mating.hpp"
+#include "gene/selection.hpp"
+#include "gene/coding/bitstring.hpp"
+#include "gene/coding/dna.hpp"
+#include "gene/coding/dna_io.hpp"
+#include "gene/coding/dna_store.hpp"
+#include "gene/evstrat.hpp"
+#include "gene/evstrat/cmaes.hpp"
+#include "gene/evstrat/differential.hpp"
+#include "gene/evstrat/tuning.hpp"
+#include "gene/process.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace gene;
+
+///////////////////////////////////////////////////////////////////////////////
+template<typename Function>
+double secondsPerRun(Function f, std::size_t runs)
+{
+  auto begin = std::chrono::steady_clock::now();
+  for (std::size_t k = 0; k < runs; ++k) f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - begin).count() / runs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void report(const std::string& name, double baseline, double optimized)
+{
+  std::cout << name << ": " << baseline * 1e3 << " ms -> "
+            << optimized * 1e3 << " ms (x" << baseline / optimized << ")"
+            << std::endl;
+}
+
+namespace dnabench {
+
+using namespace gene::coding::dna;
+
+///////////////////////////////////////////////////////////////////////////////
+// Byte per base decoder with codon table lookups, as decodeGenes used to be
+bool isCodon(std::vector<Base>::const_iterator it,
+             const std::vector<Codon>& codons)
+{
+  for (const Codon& codon : codons)
+  {
+    if (codon[0] == *it && codon[1] == *(it + 1) && codon[2] == *(it + 2)) return true;
+  }
+  return false;
+}
+
+std::vector<DecodedGene> unpackedDecodeGenes(const std::vector<Base>& bases)
+{
+  const std::vector<Codon> startCodons(START_CODONS.begin(), START_CODONS.end());
+  const std::vector<Codon> stopCodons(STOP_CODONS.begin(), STOP_CODONS.end());
+  std::vector<DecodedGene> result;
+  std::size_t length = bases.size();
+  for (std::size_t pos = 0; pos + CODON_SIZE < length; ++pos)
+  {
+    if (!isCodon(bases.begin() + pos, startCodons)) continue;
+    DecodedGene gene;
+    gene.push_back(decodeCodon(bases.begin() + pos));
+    for (pos += CODON_SIZE; pos + CODON_SIZE < length; pos += CODON_SIZE)
+    {
+      gene.push_back(decodeCodon(bases.begin() + pos));
+      if (!isCodon(bases.begin() + pos, stopCodons)) continue;
+      result.push_back(std::move(gene));
+      pos--;
+      break;
+    }
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Random bases where A and T appear with the given probability
+std::vector<Base> randomBases(std::size_t count, double atProbability)
+{
+  std::mt19937 random(42);
+  std::bernoulli_distribution at(atProbability);
+  std::bernoulli_distribution coin(0.5);
+  std::vector<Base> bases;
+  bases.reserve(count);
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    bases.push_back(at(random) ? (coin(random) ? Base::A : Base::T)
+                               : (coin(random) ? Base::G : Base::C));
+  }
+  return bases;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void decode()
+{
+  for (double atProbability : {0.5, 0.1})
+  {
+    std::vector<Base> bases = randomBases(1 << 22, atProbability);
+    Chromosome chromosome(bases);
+
+    std::size_t genes = decodeGenes(chromosome).size();
+
+    // the decoder takes a few ms, so it runs more times to average out noise
+    double baseline = secondsPerRun([&]{ unpackedDecodeGenes(bases); }, 5);
+    double optimized = secondsPerRun([&]{ chromosome.clearDecoded();
+                                          decodeGenes(chromosome); }, 50);
+    report("decodeGenes, 4M bases, " + std::to_string(genes) + " genes",
+           baseline, optimized);
+
+    GeneTable table;
+    double reused = secondsPerRun([&]{ chromosome.clearDecoded();
+                                       decodeGenes(chromosome, table); }, 50);
+    report("decodeGenes into a reused GeneTable", optimized, reused);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void incrementalDecode()
+{
+  Chromosome chromosome(randomBases(1 << 22, 0.5));
+  std::mt19937 random(7);
+  std::uniform_int_distribution<std::size_t> position(0, chromosome.bases.size() - 1);
+
+  auto mutateOneBase = [&]
+  {
+    std::size_t pos = position(random);
+    chromosome.bases.set(pos, randomBase(random));
+    chromosome.markDirty(pos, pos + 1);
+  };
+
+  std::size_t genes = 0;
+  double full = secondsPerRun([&]{ mutateOneBase();
+                                   chromosome.clearDecoded();
+                                   genes += decodeGenes(chromosome).size(); }, 5);
+  decodeGenes(chromosome);
+  double incremental = secondsPerRun([&]{ mutateOneBase();
+                                          genes += decodeGenes(chromosome).size(); }, 50);
+  report("decodeGenes after a point mutation, 4M bases", full, incremental);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Uniform crossover of a pair of 10^6 base homologs, base by base as on the
+// unpacked representation and a word at a time
+void crossover()
+{
+  struct NoPhenotype { };
+  struct NullCodec : public Codec<NoPhenotype, Genotype>
+  {
+    NoPhenotype decode(const Genotype&) const throw(std::invalid_argument) override
+    {
+      return NoPhenotype();
+    }
+
+    Genotype encode(const NoPhenotype&) const override
+    {
+      throw std::logic_error("not invertible");
+    }
+  };
+
+  const std::size_t size = 1000000;
+  std::vector<Base> b1 = randomBases(size, 0.5);
+  std::vector<Base> b2 = randomBases(size, 0.3);
+  std::pair<NoPhenotype, Genotype> parent{NoPhenotype(), Genotype({Chromosome(b1), Chromosome(b2)})};
+  NullCodec codec;
+  UniformCrossover<NoPhenotype> uniform(7);
+
+  std::mt19937 random(7);
+  std::bernoulli_distribution coin(0.5);
+  std::size_t bases = 0;
+  double baseline = secondsPerRun([&]
+  {
+    std::vector<Base> child(size);
+    for (std::size_t k = 0; k < size; ++k) child[k] = coin(random) ? b1[k] : b2[k];
+    bases += child.size();
+  }, 10);
+  double optimized = secondsPerRun([&]
+  {
+    // one chromosome per gamete, two per call
+    bases += uniform.combine(parent, parent, codec).second.chromosomes[0].bases.size();
+  }, 10) / 2;
+  report("Uniform crossover, 10^6 bases", baseline, optimized);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Round trip of a converged population of 1000 genotypes through a file,
+// checking that every genotype reads back equal and that truncated copies
+// of the file are rejected instead of read out of bounds
+void io()
+{
+  const std::string path = "benchmark_population.dna";
+  std::vector<Chromosome> ancestor{Chromosome(randomBases(100000, 0.5)),
+                                   Chromosome(randomBases(30000, 0.3))};
+  std::mt19937 random(11);
+  Population<int, Genotype> population;
+  for (std::size_t k = 0; k < 1000; ++k)
+  {
+    Genotype genotype(ancestor);
+    for (Chromosome& chromosome : genotype.chromosomes)
+    {
+      for (std::size_t m = 0; m < 20; ++m)
+      {
+        chromosome.bases.set(random() % chromosome.bases.size(), randomBase(random));
+      }
+    }
+    population.emplace_back(0, std::move(genotype));
+  }
+
+  double written = secondsPerRun([&] { writePopulation(path, population); }, 1);
+  std::ifstream file(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::size_t mismatches = 0;
+  double read = secondsPerRun([&]
+  {
+    PopulationReader reader(path);
+    for (std::size_t k = 0; k < reader.size(); ++k)
+    {
+      Genotype genotype = reader.read(k);
+      for (std::size_t c = 0; c < genotype.chromosomes.size(); ++c)
+      {
+        const PackedBases& expected = population[k].second.chromosomes[c].bases;
+        if (!(genotype.chromosomes[c].bases == expected)) ++mismatches;
+      }
+    }
+  }, 1);
+
+  std::size_t rejected = 0, truncations = 0;
+  for (std::size_t size = 8; size < data.size(); size += data.size() / 50 + 8)
+  {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(data.data(), size);
+    ++truncations;
+    try
+    {
+      PopulationReader reader(path);
+      for (std::size_t k = 0; k < reader.size(); ++k) reader.read(k);
+    }
+    catch (const std::runtime_error&)
+    {
+      ++rejected;
+    }
+  }
+  std::remove(path.c_str());
+
+  std::cout << "Population file, 1000 x 130000 bases: " << data.size() / 1024 << " KiB, written in "
+            << written * 1e3 << " ms, read in " << read * 1e3 << " ms, "
+            << mismatches << " mismatches, " << rejected << "/" << truncations
+            << " truncated copies rejected" << std::endl;
+}
+
+}
+
+namespace esbench {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+void normal()
+{
+  const std::size_t count = 1 << 20;
+  std::vector<double> samples(count);
+
+  std::mt19937 g(42);
+  std::normal_distribution<> distribution(0.0, 1.0);
+  double baseline = secondsPerRun([&]{ for (double& x : samples) x = distribution(g); }, 20);
+
+  NormalGenerator generator(42);
+  double optimized = secondsPerRun([&]{ generator.fill(samples.data(), count); }, 20);
+
+  report("N(0,1) samples, 1M draws", baseline, optimized);
+  std::cout << "  " << count / baseline / 1e6 << " -> "
+            << count / optimized / 1e6 << " M draws/s" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// UncorrelatedNSteps against the same kernels fed one sample at a time by
+// std::normal_distribution over mt19937, as it was before NormalGenerator
+void mutation()
+{
+  const std::size_t n = 10000;
+  gene::evstrat::Population population = randomPopulation(n, 100, -5, 5, 1, n);
+  gene::evstrat::Population previous = population;
+  UncorrelatedNSteps mutation(n, -5, 5);
+  NullCodec codec;
+
+  std::mt19937 g(42);
+  std::normal_distribution<> normal(0.0, 1.0);
+  std::vector<double> z(3 * n);
+  double baseline = secondsPerRun([&]
+  {
+    for (gene::evstrat::Individual& i : previous)
+    {
+      double* value = i.second.value.data();
+      double* sigma = i.second.sigma.data();
+      double baseMutation = mutation.tauPrime_ * normal(g);
+      for (std::size_t k = 0; k < 2 * n; ++k) z[k] = normal(g);
+      selfAdaptSigmas(sigma, z.data(), n, baseMutation, mutation.tau_,
+                      mutation.epsilon0_, 5, z.data() + 2 * n);
+      perturb(value, sigma, z.data() + n, n, -5, 5);
+    }
+  }, 5);
+  double optimized = secondsPerRun([&]{ for (gene::evstrat::Individual& i : population)
+                                          mutation.mutateInPlace(i, codec, nullptr); }, 5);
+  report("UncorrelatedNSteps, 100 x 10^4 coordinates", baseline, optimized);
+}
+
+}
+
+namespace gabench {
+
+using namespace gene::coding::bitstring;
+
+///////////////////////////////////////////////////////////////////////////////
+// OneMax: the phenotype and the fitness are the number of bits set
+struct OneMaxCodec : public Codec<std::size_t, Genotype>
+{
+  std::size_t decode(const Genotype& genotype) const throw(std::invalid_argument) override
+  {
+    return genotype.count();
+  }
+
+  Genotype encode(const std::size_t&) const override
+  {
+    throw std::logic_error("not invertible");
+  }
+};
+
+struct OneMax : public FitnessFunction<std::size_t, Genotype>
+{
+  PopulationFitness calculate(const Population<std::size_t, Genotype>& population) override
+  {
+    PopulationFitness fitness;
+    fitness.reserve(population.size());
+    for (const auto& individual : population) fitness.push_back(individual.second.count());
+    return fitness;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+Population<std::size_t, Genotype> randomPopulation(std::size_t size, std::size_t bits)
+{
+  std::mt19937 random(42);
+  Population<std::size_t, Genotype> population;
+  for (std::size_t k = 0; k < size; ++k)
+  {
+    population.emplace_back(0, Genotype({randomChromosome(bits, random)}));
+  }
+  return population;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The same GA on small bitstrings, composed through the virtual interfaces
+// and statically
+void algorithm()
+{
+  const std::size_t size = 256;
+  const std::size_t elite = 4;
+  const std::size_t generations = 50;
+
+  for (std::size_t bits : {64, 1024})
+  {
+    OneMaxCodec codec;
+    OneMax fitness;
+    BitFlipMutation<std::size_t> mutation(1.0f / bits, 1);
+    ConstantMutationRate<std::size_t, Genotype> rate(1.0f);
+    RandomMating<std::size_t, Genotype> mating(size - elite);
+    UniformCrossover<std::size_t> crossover(2);
+    TruncationSelection<std::size_t, Genotype> selection(size / 2);
+
+    GeneticAlgorithm<std::size_t, Genotype> dynamic(codec, fitness, mutation, rate,
+                                                     mating, crossover, selection);
+    auto composed = makeStaticGeneticAlgorithm<std::size_t, Genotype>(
+                       codec, fitness, mutation, rate, mating, crossover, selection,
+                       nullptr, 3);
+
+    double baseline = secondsPerRun([&]
+    {
+      auto population = randomPopulation(size, bits);
+      for (std::size_t g = 0; g < generations; ++g)
+      {
+        population = dynamic.iterate(std::move(population), elite);
+      }
+    }, 5);
+    double optimized = secondsPerRun([&]
+    {
+      auto population = randomPopulation(size, bits);
+      for (std::size_t g = 0; g < generations; ++g)
+      {
+        population = composed.iterate(std::move(population), elite);
+      }
+    }, 5);
+    report("GA, 256 x " + std::to_string(bits) + " bits, 50 generations", baseline, optimized);
+  }
+}
+
+}
+
+namespace selbench {
+
+///////////////////////////////////////////////////////////////////////////////
+// Survivors of the previous TruncationSelection: a multimap by fitness, and
+// the best ones in a set
+Survivors multimapTruncation(const PopulationFitness& fitness, std::size_t size)
+{
+  std::multimap<FitnessType, PopulationIndex> fitnessMap;
+  for (PopulationIndex k = 0; k < fitness.size(); ++k)
+  {
+    fitnessMap.insert(std::make_pair(fitness[k], k));
+  }
+  Survivors result;
+  auto it = fitnessMap.crbegin();
+  for (std::size_t i = 0; it != fitnessMap.crend() && i < size; ++i, ++it)
+  {
+    result.insert(it->second);
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Half of a large population survives, by truncation and by sampling
+void selection()
+{
+  const std::size_t size = 1000000;
+  const std::size_t threads = hardwareThreads();
+
+  std::mt19937 random(42);
+  std::normal_distribution<FitnessType> normal(0, 1);
+  Population<int, int> population(size, Individual<int, int>(0, 0));
+  PopulationFitness fitness(size);
+  for (FitnessType& f : fitness) f = std::abs(normal(random));
+
+  TruncationSelection<int, int> truncation(size / 2, threads);
+  double baseline = secondsPerRun([&] { multimapTruncation(fitness, size / 2); }, 3);
+  double optimized = secondsPerRun([&] { truncation.selectIndices(population, fitness); }, 3);
+  report("Truncation, 10^6 individuals", baseline, optimized);
+
+  // sampling, on one thread and on all of them
+  FitnessProportionateSelection<int, int> roulette1(size / 2), roulette(size / 2, threads);
+  baseline = secondsPerRun([&] { roulette1.selectIndices(population, fitness); }, 3);
+  optimized = secondsPerRun([&] { roulette.selectIndices(population, fitness); }, 3);
+  report("Roulette, 10^6 individuals, " + std::to_string(threads) + " threads",
+         baseline, optimized);
+
+  StochasticUniversalSampling<int, int> sus1(size / 2), sus(size / 2, threads);
+  baseline = secondsPerRun([&] { sus1.selectIndices(population, fitness); }, 3);
+  optimized = secondsPerRun([&] { sus.selectIndices(population, fitness); }, 3);
+  report("SUS, 10^6 individuals, " + std::to_string(threads) + " threads",
+         baseline, optimized);
+}
+
+}
+
+namespace boundbench {
+
+///////////////////////////////////////////////////////////////////////////////
+// Individuals passing each of 2000 test cases with the probability given by
+// their phenotype, the elite of the previous generation last; a tenth of
+// them survive
+void bounded()
+{
+  const std::size_t size = 1000;
+  const std::size_t cases = 2000;
+  const std::size_t elite = 10;
+
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> uniform(0, 0.9);
+  Population<double, std::size_t> population;
+  for (std::size_t k = 0; k < size; ++k)
+  {
+    double skill = k < size - elite ? uniform(random) : 0.9 + 0.01 * (k + elite - size);
+    population.emplace_back(skill, k);
+  }
+
+  auto score = [](const Individual<double, std::size_t>& individual, std::size_t c)
+  {
+    uint64_t h = (individual.second << 32 | c) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 31; h *= 0xbf58476d1ce4e5b9ULL; h ^= h >> 27;
+    return FitnessType((h >> 11) / double(1ULL << 53) < individual.first);
+  };
+  SummedFitness<double, std::size_t> fitness(cases, score, 1);
+  TruncationSelection<double, std::size_t> truncation(size / 10);
+
+  std::size_t ranked = truncation.survivingRank(size);
+  PopulationFitness exact = fitness.calculate(population);
+  PopulationFitness bounded = fitness.calculateTop(population, ranked);
+  if (truncation.selectIndices(population, exact) !=
+      truncation.selectIndices(population, bounded))
+  {
+    std::cout << "bounded fitness: different survivors" << std::endl;
+  }
+
+  double baseline = secondsPerRun([&] { fitness.calculate(population); }, 5);
+  double optimized = secondsPerRun([&] { fitness.calculateTop(population, ranked); }, 5);
+  report("Fitness of 1000 x 2000 cases, best 100 exact", baseline, optimized);
+}
+
+}
+
+namespace racebench {
+
+///////////////////////////////////////////////////////////////////////////////
+// Phenotype plus gaussian noise, the genotype being the key
+struct NoisyFitness : public FitnessFunction<double, std::size_t>
+{
+  std::mt19937 random {42};
+  std::normal_distribution<double> noise {0, 1};
+
+  PopulationFitness calculate(const Population<double, std::size_t>& population) override
+  {
+    PopulationFitness fitness;
+    for (const auto& individual : population) fitness.push_back(individual.first + noise(random));
+    return fitness;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Fraction of the truly best 'count' among the 'count' best by fitness
+double accuracy(const Population<double, std::size_t>& population,
+                const PopulationFitness& fitness, std::size_t count)
+{
+  TruncationSelection<double, std::size_t> truncation(count);
+  PopulationFitness truth;
+  for (const auto& individual : population) truth.push_back(individual.first);
+  std::vector<PopulationIndex> best = truncation.selectIndices(population, truth);
+  std::vector<PopulationIndex> chosen = truncation.selectIndices(population, fitness);
+  std::vector<PopulationIndex> common;
+  std::set_intersection(best.begin(), best.end(), chosen.begin(), chosen.end(),
+                        std::back_inserter(common));
+  return double(common.size()) / count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The best tenth of 1000 individuals, their fitness spread as much as the
+// noise, picked from one sample each, from 10 each and by racing
+void racing()
+{
+  const std::size_t size = 1000;
+  const std::size_t count = size / 10;
+
+  std::mt19937 random(7);
+  std::normal_distribution<double> spread(0, 1);
+  Population<double, std::size_t> population;
+  for (std::size_t k = 0; k < size; ++k) population.emplace_back(spread(random), k);
+
+  NoisyFitness noisy;
+  PopulationFitness once = noisy.calculate(population);
+  PopulationFitness averaged(size, 0);
+  for (std::size_t n = 0; n < 10; ++n)
+  {
+    PopulationFitness f = noisy.calculate(population);
+    for (std::size_t k = 0; k < size; ++k) averaged[k] += f[k] / 10;
+  }
+  RacingFitness<double, std::size_t> racing(noisy,
+     [](const Individual<double, std::size_t>& i) { return uint64_t(i.second); });
+  PopulationFitness raced = racing.calculateTop(population, count);
+
+  std::cout << "Best 100 of 1000 noisy individuals: "
+            << accuracy(population, once, count) * 100 << "% right with 1 sample, "
+            << accuracy(population, averaged, count) * 100 << "% with 10, "
+            << accuracy(population, raced, count) * 100 << "% racing with "
+            << double(racing.statistics().sampled) / size << " samples each" << std::endl;
+}
+
+}
+
+namespace tunebench {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+// Successive halving over a grid of ES and GA settings on each standard
+// function of 10 coordinates, 3 seeds per configuration
+void tuning()
+{
+  const std::size_t dimension = 10;
+  SuccessiveHalving halving(3, 2000, 54000, 3);
+
+  for (const TestFunction& function : standardFunctions())
+  {
+    std::vector<TuningConfiguration> configurations;
+    for (std::size_t mu : {5, 15})
+      for (std::size_t lambda : {35, 100})
+        for (bool plus : {false, true})
+          for (double tau : {0.5, 1.0})
+          {
+            EvolutionStrategiesSettings settings;
+            settings.mu = mu;
+            settings.lambda = lambda;
+            settings.plus = plus;
+            settings.tau = tau;
+            configurations.push_back(configuration(
+               "ES (" + std::to_string(mu) + (plus ? "+" : ",") + std::to_string(lambda) +
+               ") tau " + std::to_string(tau).substr(0, 3), function, dimension, settings));
+          }
+    for (float rate : {0.2f, 0.8f})
+      for (std::size_t survivors : {20, 50})
+        for (std::size_t tournament : {0, 60})
+        {
+          GeneticAlgorithmSettings settings;
+          settings.mutationRate = rate;
+          settings.survivors = survivors;
+          settings.tournamentSize = tournament;
+          configurations.push_back(configuration(
+             "GA rate " + std::to_string(rate).substr(0, 3) + " survivors " +
+             std::to_string(survivors) + (tournament ? " tournament" : " truncation"),
+             function, dimension, settings));
+        }
+
+    std::vector<TuningResult> results;
+    double seconds = secondsPerRun([&] { results = halving.tune(configurations); }, 1);
+    std::cout << "Tuning " << configurations.size() << " configurations on "
+              << function.name << ": " << seconds * 1e3 << " ms" << std::endl;
+    writeTable(std::cout, results);
+  }
+}
+
+}
+
+namespace procbench {
+
+///////////////////////////////////////////////////////////////////////////////
+// Fitness of about 2000 square roots per individual
+struct CheapFitness : public FitnessFunction<int, int>
+{
+  PopulationFitness calculate(const Population<int, int>& population) override
+  {
+    PopulationFitness fitness;
+    for (const auto& individual : population)
+    {
+      double sum = 0;
+      for (int k = 0; k < 2000; ++k) sum += std::sqrt(k + individual.second);
+      fitness.push_back(sum);
+    }
+    return fitness;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Same, but crashing on every 97th genotype and hanging on one
+struct FaultyFitness : public CheapFitness
+{
+  PopulationFitness calculate(const Population<int, int>& population) override
+  {
+    for (const auto& individual : population)
+    {
+      if (individual.second % 97 == 13) std::raise(SIGSEGV);
+      if (individual.second == 500) std::this_thread::sleep_for(std::chrono::seconds(5));
+    }
+    return CheapFitness::calculate(population);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 10^5 cheap evaluations in process and in a pool of one worker, then 1000
+// evaluations crashing or hanging now and then, with a 300 ms timeout
+void process()
+{
+  auto serialize = [](const Individual<int, int>& individual)
+  {
+    return std::string(reinterpret_cast<const char*>(&individual.second), sizeof(int));
+  };
+  auto deserialize = [](const std::string& request)
+  {
+    int genotype;
+    std::memcpy(&genotype, request.data(), sizeof(genotype));
+    return Individual<int, int>(0, genotype);
+  };
+
+  Population<int, int> population;
+  for (int k = 0; k < 100000; ++k) population.emplace_back(0, k);
+  CheapFitness cheap;
+  ProcessFitness<int, int> pooled(cheap, serialize, deserialize, 1);
+  PopulationFitness local, remote;
+  double baseline = secondsPerRun([&] { local = cheap.calculate(population); }, 1);
+  double optimized = secondsPerRun([&] { remote = pooled.calculate(population); }, 1);
+  report(std::string("Fitness of 10^5 individuals in process and in 1 worker") +
+         (local == remote ? "" : " (DIFFERENT)"), baseline, optimized);
+
+  population.resize(1000);
+  FaultyFitness faulty;
+  ProcessFitness<int, int> guarded(faulty, serialize, deserialize, 3,
+                                   std::chrono::milliseconds(300), 2);
+  PopulationFitness fitness;
+  double seconds = secondsPerRun([&] { fitness = guarded.calculate(population); }, 1);
+  std::size_t wrong = 0;
+  for (int k = 0; k < 1000; ++k)
+  {
+    bool failed = k % 97 == 13 || k == 500;
+    FitnessType expected = failed ? std::numeric_limits<FitnessType>::lowest()
+                                  : cheap.calculate({population[k]})[0];
+    wrong += fitness[k] != expected;
+  }
+  const WorkerStatistics& statistics = guarded.pool().statistics();
+  std::cout << "Faulty fitness of 1000 individuals in 3 workers: " << seconds * 1e3
+            << " ms, " << statistics.crashes << " crashes, " << statistics.timeouts
+            << " timeouts, " << statistics.requeued << " requeued, " << statistics.failed
+            << " failed, " << wrong << " wrong" << std::endl;
+}
+
+}
+
+namespace surrbench {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+// (15,100)-ES on 10-D functions for 300 generations through a
+// SurrogateFitness evaluating 20% of the offspring, against the same ES
+// given as many real evaluations
+void surrogate()
+{
+  const std::size_t n = 10, generations = 300;
+  for (const TestFunction& function : standardFunctions())
+  {
+    if (function.name != "sphere" && function.name != "rastrigin") continue;
+    FitnessAdapter adapter(function.function);
+    CountingFitness counting(adapter);
+    SurrogateFitness<Void, EvolutionParams> screening(counting,
+      [](const gene::evstrat::Individual& individual) { return individual.second.value; }, 0.2);
+    UncorrelatedNSteps mutation(n, function.minValue, function.maxValue, 1e-8, 1, 7);
+    LocalRecombination combination;
+    combination.g_.seed(7);
+    MuCommaLambda survival;
+    EvolutionStrategies strategies(screening, mutation, combination, survival, 100);
+    gene::evstrat::Population population =
+       randomPopulation(n, 15, function.minValue, function.maxValue, 1, n, 7);
+    double seconds = secondsPerRun([&]
+    {
+      for (std::size_t g = 0; g < generations; ++g)
+      {
+        population = strategies.iterate(std::move(population));
+      }
+    }, 1);
+
+    EvolutionStrategiesRun plain(function, n, EvolutionStrategiesSettings(), 7);
+    FitnessType best = plain.advance(counting.evaluations());
+
+    const SurrogateStatistics& statistics = screening.statistics();
+    std::cout << "Surrogate (15,100)-ES on " << function.name << ": " << -counting.best()
+              << " with " << statistics.evaluated << " true evaluations of "
+              << statistics.requested << " candidates (" << statistics.screened
+              << " screened, " << statistics.archived << " archived, "
+              << seconds * 1e3 << " ms); plain ES " << -best << std::endl;
+    std::cout << "  prediction error " << statistics.meanAbsoluteError()
+              << ", rank correlation " << statistics.meanRankCorrelation() << std::endl;
+  }
+}
+
+}
+
+namespace cmabench {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+// Ellipsoid of condition 10^6 in a random orthonormal basis
+Function rotatedEllipsoid(std::size_t n)
+{
+  std::mt19937 random(2);
+  std::normal_distribution<double> normal;
+  auto basis = std::make_shared<Matrix>(n, n);
+  Matrix& r = *basis;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    for (std::size_t j = 0; j < n; ++j) r(i, j) = normal(random);
+    for (std::size_t k = 0; k < i; ++k)
+    {
+      double dot = 0;
+      for (std::size_t j = 0; j < n; ++j) dot += r(i, j) * r(k, j);
+      for (std::size_t j = 0; j < n; ++j) r(i, j) -= dot * r(k, j);
+    }
+    double norm = 0;
+    for (std::size_t j = 0; j < n; ++j) norm += r(i, j) * r(i, j);
+    for (std::size_t j = 0; j < n; ++j) r(i, j) /= std::sqrt(norm);
+  }
+  return [basis, n](const std::vector<double>& x)
+  {
+    const Matrix& r = *basis;
+    double sum = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double y = 0;
+      for (std::size_t j = 0; j < n; ++j) y += r(i, j) * x[j];
+      sum += std::pow(1e6, n > 1 ? double(i) / (n - 1) : 0.0) * y * y;
+    }
+    return sum;
+  };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CMA-ES down to 10^-8 on the rotated ellipsoid, against a (15,100)-ES with
+// a step size per coordinate given as many evaluations
+void cmaes()
+{
+  for (std::size_t n : {10, 30})
+  {
+    Function function = rotatedEllipsoid(n);
+    FitnessAdapter fitness(function);
+    EvolutionParams start;
+    start.value.assign(n, 1.0);
+    start.sigma = {0.5};
+    CmaEs strategy(fitness, start, 0, 42);
+    double seconds = secondsPerRun([&]
+    {
+      while (-strategy.bestFitness() >= 1e-8 && strategy.generation() < 100000) strategy.iterate();
+    }, 1);
+    std::size_t evaluations = strategy.generation() * strategy.lambda();
+
+    EvolutionStrategiesRun run({"ellipsoid", function, -5, 5}, n,
+                               EvolutionStrategiesSettings(), 42);
+    FitnessType best = run.advance(evaluations);
+    std::cout << "Rotated ellipsoid, n = " << n << ": CMA-ES " << -strategy.bestFitness()
+              << " in " << evaluations << " evaluations (" << seconds * 1e3
+              << " ms), (15,100)-ES " << -best << std::endl;
+  }
+
+  const std::size_t n = 200;
+  Matrix covariance(n, n);
+  std::mt19937 random(1);
+  std::normal_distribution<double> normal;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    for (std::size_t j = 0; j <= i; ++j) covariance(i, j) = covariance(j, i) = normal(random);
+  }
+  std::vector<double> eigenvalues;
+  double seconds = secondsPerRun([&]
+  {
+    Matrix vectors = covariance;
+    symmetricEigen(vectors, eigenvalues);
+  }, 3);
+  std::cout << "Eigendecomposition, n = 200: " << seconds * 1e3 << " ms" << std::endl;
+}
+
+}
+
+namespace debench {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+// 1000 generations of each variant on 30-D sphere and Rosenbrock, with 100
+// individuals and one thread
+void differential()
+{
+  struct Setting
+  {
+    const char* name;
+    DifferentialEvolution::Variant variant;
+    double f;
+  };
+  const Setting settings[] = {
+    {"rand/1/bin", DifferentialEvolution::RAND_1_BIN, 0.5},
+    {"best/1/bin", DifferentialEvolution::BEST_1_BIN, 0.5},
+    {"best/1/bin F 0.7", DifferentialEvolution::BEST_1_BIN, 0.7},
+    {"current-to-pbest/1/bin", DifferentialEvolution::CURRENT_TO_PBEST_1_BIN, 0.5}};
+
+  for (const TestFunction& function : standardFunctions())
+  {
+    if (function.name != "sphere" && function.name != "rosenbrock") continue;
+    for (const Setting& setting : settings)
+    {
+      FitnessAdapter fitness(function.function);
+      DifferentialEvolution evolution(fitness, setting.variant, function.minValue,
+                                      function.maxValue, setting.f, 0.9, 1, 3);
+      SoaPopulation population = toSoaPopulation(
+         randomPopulation(30, 100, function.minValue, function.maxValue, 1, 1, 3));
+      double seconds = secondsPerRun([&]
+      {
+        for (std::size_t g = 0; g < 1000; ++g) population = evolution.iterate(std::move(population));
+      }, 1);
+      FitnessType best = *std::max_element(population.fitness.begin(), population.fitness.end());
+      std::cout << "DE " << setting.name << " on " << function.name << ": " << -best
+                << " in " << seconds * 1e3 << " ms" << std::endl;
+    }
+  }
+}
+
+}
+
+namespace asyncbench {
+
+using namespace gene::coding::bitstring;
+
+///////////////////////////////////////////////////////////////////////////////
+// Number of ones of a bit string
+struct OneMaxCodec : public Codec<std::size_t, Genotype>
+{
+  std::size_t decode(const Genotype& genotype) const throw(std::invalid_argument) override
+  {
+    return genotype.count();
+  }
+
+  Genotype encode(const std::size_t&) const override
+  {
+    throw std::logic_error("not invertible");
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// OneMax taking from 0.5 to 28 ms per individual, the longest only for a
+// few of them, as an external solver would
+struct SlowOneMax : public FitnessFunction<std::size_t, Genotype>
+{
+  PopulationFitness calculate(const Population<std::size_t, Genotype>& population) override
+  {
+    PopulationFitness fitness;
+    for (const auto& individual : population)
+    {
+      std::size_t ones = individual.second.count();
+      std::size_t delay = 500 + (ones * 7919 % 10) * (ones % 7 == 0 ? 3000 : 300);
+      std::this_thread::sleep_for(std::chrono::microseconds(delay));
+      fitness.push_back(ones);
+    }
+    return fitness;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 10 generations of a (20+100)-ES on a sphere taking 1 ms per individual,
+// evaluating the offspring one after another and on 16 threads as they are
+// bred
+void asyncStrategies()
+{
+  using namespace gene::evstrat;
+  FitnessAdapter fitness([](const std::vector<double>& x)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return sphere(x);
+  });
+  ThreadedFitness<Void, EvolutionParams> threaded(fitness, 16);
+
+  double seconds[2];
+  for (std::size_t run = 0; run < 2; ++run)
+  {
+    UncorrelatedNSteps mutation(10, -5, 5, 1e-8, 1, 7);
+    LocalRecombination combination;
+    MuPlusLambda survival;
+    EvolutionStrategies strategies(fitness, mutation, combination, survival, 100);
+    gene::evstrat::Population population = randomPopulation(10, 20, -5, 5, 1, 10, 7);
+    seconds[run] = secondsPerRun([&]
+    {
+      for (std::size_t g = 0; g < 10; ++g)
+      {
+        population = run == 0 ? strategies.iterate(std::move(population))
+                              : strategies.iterate(std::move(population), threaded);
+      }
+    }, 1);
+  }
+  report("10 generations of a (20+100)-ES, 1 ms per evaluation, blocking and on 16 threads",
+         seconds[0], seconds[1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 60 generations of OneMax on 16 threads, waiting for the whole generation
+// (quorum 1, as GeneticAlgorithm) and for 80% of it
+void async()
+{
+  double seconds[2];
+  std::size_t best[2];
+  const double quorums[] = {1.0, 0.8};
+  for (std::size_t q = 0; q < 2; ++q)
+  {
+    std::mt19937 random(1);
+    Population<std::size_t, Genotype> population;
+    for (std::size_t k = 0; k < 40; ++k)
+    {
+      population.emplace_back(0, Genotype({randomChromosome(100, random)}));
+    }
+    OneMaxCodec codec;
+    SlowOneMax slow;
+    ThreadedFitness<std::size_t, Genotype> fitness(slow, 16);
+    BitFlipMutation<std::size_t> mutation(0.01f, 1);
+    ConstantMutationRate<std::size_t, Genotype> rate(1.0f);
+    RandomMating<std::size_t, Genotype> mating(36);
+    UniformCrossover<std::size_t> crossover(2);
+    TournamentSelection<std::size_t, Genotype> survival(20, 30);
+    PipelinedGeneticAlgorithm<std::size_t, Genotype> algorithm(codec, fitness, mutation, rate,
+                                                               mating, crossover, survival,
+                                                               quorums[q]);
+    seconds[q] = secondsPerRun([&]
+    {
+      for (std::size_t g = 0; g < 60; ++g) population = algorithm.iterate(std::move(population), 4);
+    }, 1);
+    best[q] = 0;
+    for (const auto& individual : population) best[q] = std::max(best[q], individual.second.count());
+  }
+  report("60 generations of slow OneMax, quorum 1 and 0.8 (best " + std::to_string(best[0]) +
+         " and " + std::to_string(best[1]) + ")", seconds[0], seconds[1]);
+  asyncStrategies();
+}
+
+}
+
+namespace storebench {
+
+using namespace gene::coding::dna;
+
+struct NoPhenotype { };
+
+///////////////////////////////////////////////////////////////////////////////
+struct NullCodec : public Codec<NoPhenotype, Genotype>
+{
+  NoPhenotype decode(const Genotype&) const throw(std::invalid_argument) override
+  {
+    return NoPhenotype();
+  }
+
+  Genotype encode(const NoPhenotype&) const override
+  {
+    throw std::logic_error("not invertible");
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Number of A bases
+struct CountA : public FitnessFunction<NoPhenotype, Genotype>
+{
+  PopulationFitness calculate(const Population<NoPhenotype, Genotype>& population) override
+  {
+    PopulationFitness fitness;
+    for (const auto& individual : population)
+    {
+      std::size_t count = 0;
+      for (const Chromosome& chromosome : individual.second.chromosomes)
+      {
+        for (std::size_t k = 0; k < chromosome.bases.size(); ++k) count += chromosome.bases[k] == Base::A;
+      }
+      fitness.push_back(count);
+    }
+    return fitness;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 10 generations of a GeneticAlgorithm on 200 genotypes of two 50000 base
+// chromosomes, in memory and with every genotype in a GenotypeStore,
+// children stored as they are made and fitness streamed in record order
+void store()
+{
+  const std::size_t size = 50000;
+  std::mt19937 random(5);
+  Population<NoPhenotype, Genotype> initial;
+  for (std::size_t k = 0; k < 200; ++k)
+  {
+    std::vector<Chromosome> chromosomes;
+    for (std::size_t c = 0; c < 2; ++c)
+    {
+      std::vector<Base> bases(size);
+      for (Base& base : bases) base = randomBase(random);
+      chromosomes.emplace_back(bases);
+    }
+    initial.emplace_back(NoPhenotype(), Genotype(chromosomes));
+  }
+
+  NullCodec codec;
+  CountA count;
+  BaseMutation<NoPhenotype> mutation(0.001, 1);
+  ConstantMutationRate<NoPhenotype, Genotype> rate(1.0f);
+  RandomMating<NoPhenotype, Genotype> mating(96);
+  SimpleCrossover<NoPhenotype> crossover(2);
+  TruncationSelection<NoPhenotype, Genotype> survival(100);
+
+  Population<NoPhenotype, Genotype> population = initial;
+  GeneticAlgorithm<NoPhenotype, Genotype> inMemory(codec, count, mutation, rate, mating,
+                                                   crossover, survival);
+  double baseline = secondsPerRun([&]
+  {
+    for (std::size_t g = 0; g < 10; ++g) population = inMemory.iterate(std::move(population), 4);
+  }, 1);
+
+  GenotypeStore genotypes(".", {size, size}, 256);
+  StoringCombination<NoPhenotype> storing(crossover, genotypes);
+  StreamingFitness<NoPhenotype> streaming(count, genotypes, 64);
+  GeneticAlgorithm<NoPhenotype, Genotype> outOfCore(codec, streaming, mutation, rate, mating,
+                                                    storing, survival);
+  population = initial;
+  genotypes.store(population);
+  double optimized = secondsPerRun([&]
+  {
+    for (std::size_t g = 0; g < 10; ++g)
+    {
+      population = outOfCore.iterate(std::move(population), 4);
+      genotypes.store(population);
+    }
+  }, 1);
+
+  std::cout << "GeneticAlgorithm on 200 x 2 x 50000 bases, 10 generations: " << baseline * 1e3
+            << " ms in memory, " << optimized * 1e3 << " ms in a store of "
+            << genotypes.records() << " records of " << genotypes.recordBytes() / 1024
+            << " KiB (" << genotypes.used() << " used)" << std::endl;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+  std::string only = argc > 1 ? argv[1] : "";
+  if (only.empty() || only == "decode") dnabench::decode();
+  if (only.empty() || only == "incremental") dnabench::incrementalDecode();
+  if (only.empty() || only == "crossover") dnabench::crossover();
+  if (only.empty() || only == "io") dnabench::io();
+  if (only.empty() || only == "normal") esbench::normal();
+  if (only.empty() || only == "mutation") esbench::mutation();
+  if (only.empty() || only == "algorithm") gabench::algorithm();
+  if (only.empty() || only == "selection") selbench::selection();
+  if (only.empty() || only == "bounded") boundbench::bounded();
+  if (only.empty() || only == "racing") racebench::racing();
+  if (only.empty() || only == "tuning") tunebench::tuning();
+  if (only.empty() || only == "process") procbench::process();
+  if (only.empty() || only == "surrogate") surrbench::surrogate();
+  if (only.empty() || only == "cmaes") cmabench::cmaes();
+  if (only.empty() || only == "differential") debench::differential();
+  if (only.empty() || only == "async") asyncbench::async();
+  if (only.empty() || only == "store") storebench::store();
+  return 0;
+}
@@ -1,71 +1,748 @@
+#include "gene/bounded.hpp"
+#include "gene/lazy.hpp"
+#include "gene/process.hpp"
+#include "gene/racing.hpp"
+#include "gene/selection.hpp"
+#include "gene/statistics.hpp"
+#include "gene/coding/bitstring.hpp"
 #include "gene/coding/dna.hpp"
-#include "gene/policies.hpp"
-#include "gene/algorithm.hpp"
+#include "gene/coding/dna_io.hpp"
+#include "gene/evstrat.hpp"
+#include "gene/evstrat/cmaes.hpp"
+#include "gene/evstrat/functions.hpp"
 
-#include <utility>
-#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
 
 using namespace gene;
+
+std::size_t failures = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Reports a failed expectation without stopping the other tests
+void check(bool condition, const std::string& what)
+{
+  if (condition) return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+namespace dnatest {
+
 using namespace gene::coding::dna;
 
+struct NoPhenotype { };
+
 ///////////////////////////////////////////////////////////////////////////////
-struct Neuron : boost::noncopyable
+struct NullCodec : public Codec<NoPhenotype, Genotype>
 {
-  uint8_t x;
-  uint8_t y;
-  uint8_t z;
-  uint8_t distanceThreshold;
-  uint8_t outputThreshold;
+  NoPhenotype decode(const Genotype&) const throw(std::invalid_argument) override
+  {
+    return NoPhenotype();
+  }
+
+  Genotype encode(const NoPhenotype&) const override
+  {
+    throw std::logic_error("not invertible");
+  }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-struct Network
+std::vector<Base> randomBases(std::size_t count, std::mt19937& random)
 {
-  std::vector<Network> neurons;
-};
+  std::vector<Base> bases(count);
+  for (Base& base : bases) base = randomBase(random);
+  return bases;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Copies and appended runs share chunks until they are written
+void packedBasesCopyOnWrite()
+{
+  std::mt19937 random(1);
+  std::vector<Base> bases = randomBases(3 * PackedBases::BASES_PER_CHUNK + 100, random);
+  PackedBases original(bases);
+  PackedBases copy = original;
+  check(copy == original, "a copy of PackedBases equals the original");
+  check(copy.sharedChunks() == copy.chunkCount(), "a copy shares all its chunks");
+
+  std::size_t pos = PackedBases::BASES_PER_CHUNK + 7;
+  Base other = original[pos] == Base::A ? Base::C : Base::A;
+  copy.set(pos, other);
+  check(original[pos] == bases[pos], "writing a copy leaves the original alone");
+  check(copy[pos] == other, "writing a copy changes the copy");
+  check(copy.sharedChunks() == copy.chunkCount() - 1, "writing a copy copies one chunk");
+
+  PackedBases joined;
+  joined.append(original, 0, 2 * PackedBases::BASES_PER_CHUNK);
+  joined.append(original, 2 * PackedBases::BASES_PER_CHUNK + 5, original.size());
+  check(joined.size() == original.size() - 5, "appended runs have their length");
+  check(joined.sharedChunks() == 2, "chunk aligned runs are appended by sharing");
+  bool equal = true;
+  for (std::size_t k = 0; k < joined.size(); ++k)
+  {
+    equal = equal && joined[k] == bases[k < 2 * PackedBases::BASES_PER_CHUNK ? k : k + 5];
+  }
+  check(equal, "appended runs hold the bases of the original");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Number of positions where the base changes from the previous one
+std::size_t switches(const PackedBases& bases)
+{
+  std::size_t count = 0;
+  for (std::size_t k = 1; k < bases.size(); ++k) count += bases[k] != bases[k - 1];
+  return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Children of parents with homologs of a single base each, so that the
+// homolog every base comes from can be told
+void crossover()
+{
+  const std::size_t size = 4 * PackedBases::BASES_PER_CHUNK;
+  auto parent = [&](Base b1, Base b2)
+  {
+    return std::make_pair(NoPhenotype(),
+                          Genotype({Chromosome(std::vector<Base>(size, b1)),
+                                    Chromosome(std::vector<Base>(size, b2))}));
+  };
+  auto p1 = parent(Base::A, Base::T);
+  auto p2 = parent(Base::G, Base::C);
+  NullCodec codec;
+
+  auto onlyFrom = [](const PackedBases& bases, Base b1, Base b2)
+  {
+    return std::all_of(bases.begin(), bases.end(), [&](Base b) { return b == b1 || b == b2; });
+  };
+
+  NPointCrossover<NoPhenotype> npoint(3, 1);
+  UniformCrossover<NoPhenotype> uniform(2);
+  SegmentSwapCrossover<NoPhenotype> swap(3);
+  for (std::size_t k = 0; k < 20; ++k)
+  {
+    Genotype child = npoint.combine(p1, p2, codec).second;
+    check(child.chromosomes.size() == 2, "a child has a gamete of each parent");
+    check(child.chromosomes[0].bases.size() == size && child.chromosomes[1].bases.size() == size,
+          "N point crossover keeps the length of equal homologs");
+    check(onlyFrom(child.chromosomes[0].bases, Base::A, Base::T)
+          && onlyFrom(child.chromosomes[1].bases, Base::G, Base::C),
+          "N point crossover takes the bases of the homologs of each parent");
+    check(switches(child.chromosomes[0].bases) <= 3, "N point crossover switches at most N times");
+
+    child = uniform.combine(p1, p2, codec).second;
+    const PackedBases& mixed = child.chromosomes[0].bases;
+    std::size_t as = std::count(mixed.begin(), mixed.end(), Base::A);
+    check(onlyFrom(mixed, Base::A, Base::T), "uniform crossover takes the bases of the homologs");
+    check(as > size / 2 - size / 20 && as < size / 2 + size / 20,
+          "uniform crossover takes about half of the bases of each homolog");
+
+    child = swap.combine(p1, p2, codec).second;
+    const PackedBases& swapped = child.chromosomes[1].bases;
+    check(onlyFrom(swapped, Base::G, Base::C) && switches(swapped) <= 2,
+          "segment swap replaces a single segment");
+    check(swapped.sharedChunks() == swapped.chunkCount(),
+          "segment swap shares all the chunks of the homologs");
+  }
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-struct MyFactory : public Codec<Network, Genotype>
+// A population of close genotypes, stored as keyframes and deltas, reads
+// back equal; truncated files are rejected
+void populationFile()
 {
-  Network decode(const Genotype&) const throw(std::invalid_argument) override { }
-  Genotype encode(const Network&) const override { };
+  const std::string path = "test_population.dna";
+  std::mt19937 random(3);
+  std::vector<Chromosome> ancestor{Chromosome(randomBases(10000, random)),
+                                   Chromosome(randomBases(3000, random))};
+  Population<NoPhenotype, Genotype> population;
+  for (std::size_t k = 0; k < 40; ++k)
+  {
+    Genotype genotype(ancestor);
+    for (Chromosome& chromosome : genotype.chromosomes)
+    {
+      for (std::size_t m = 0; m < 5; ++m)
+      {
+        chromosome.bases.set(random() % chromosome.bases.size(), randomBase(random));
+      }
+    }
+    if (k == 17) genotype.chromosomes[1].bases.resize(1234);
+    population.emplace_back(NoPhenotype(), std::move(genotype));
+  }
+
+  NullCodec codec;
+  writePopulation(path, population, 8);
+  Population<NoPhenotype, Genotype> read = readPopulation(path, codec);
+  check(read.size() == population.size(), "a population file holds every genotype");
+  bool equal = read.size() == population.size();
+  for (std::size_t k = 0; equal && k < read.size(); ++k)
+  {
+    const auto& expected = population[k].second.chromosomes;
+    const auto& actual = read[k].second.chromosomes;
+    equal = expected.size() == actual.size();
+    for (std::size_t c = 0; equal && c < actual.size(); ++c)
+    {
+      equal = actual[c].bases == expected[c].bases;
+    }
+  }
+  check(equal, "a population file reads back the genotypes written");
+
+  std::ifstream file(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  bool rejected = true;
+  for (std::size_t size = 0; size < data.size(); size += data.size() / 10 + 8)
+  {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(data.data(), size);
+    try
+    {
+      readPopulation(path, codec);
+      rejected = false;
+    }
+    catch (const std::runtime_error&)
+    {
+      // expected
+    }
+  }
+  check(rejected, "truncated population files are rejected");
+  std::remove(path.c_str());
+}
+
+typedef std::vector<DecodedGene> Genes;
+
+///////////////////////////////////////////////////////////////////////////////
+// Genes of all the chromosomes, counting the decodes
+struct GeneCodec : public Codec<Genes, Genotype>
+{
+  mutable std::atomic<std::size_t> decodes{0};
+
+  Genes decode(const Genotype& genotype) const throw(std::invalid_argument) override
+  {
+    ++decodes;
+    Genes genes;
+    for (const Chromosome& chromosome : genotype.chromosomes)
+    {
+      for (GeneView gene : decodeGenes(chromosome)) genes.emplace_back(gene.begin(), gene.end());
+    }
+    return genes;
+  }
+
+  Genotype encode(const Genes&) const override
+  {
+    throw std::logic_error("not invertible");
+  }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-struct MyFitness : FitnessFunction<Network, Genotype>
+// Lazy phenotypes are decoded once, when first accessed or by decodeBatch,
+// to the phenotypes decoded eagerly
+void lazyDecode()
 {
-  Fitness calculate(const Population<Network, Genotype>&) override { }
+  std::mt19937 random(4);
+  std::vector<Genotype> genotypes;
+  for (std::size_t k = 0; k < 40; ++k)
+  {
+    genotypes.emplace_back(std::vector<Chromosome>{Chromosome(randomBases(20000, random)),
+                                                   Chromosome(randomBases(5000, random))});
+  }
+  GeneCodec codec;
+  std::vector<Genes> eager;
+  for (const Genotype& genotype : genotypes) eager.push_back(codec.decode(genotype));
+  check(!eager[0].empty(), "random DNA has genes");
+
+  Population<Genes, Genotype> batch;
+  for (const Genotype& genotype : genotypes) batch.emplace_back(Genes(), genotype);
+  codec.decodeBatch(batch, 4);
+  bool equal = true;
+  for (std::size_t k = 0; k < batch.size(); ++k) equal = equal && batch[k].first == eager[k];
+  check(equal, "decodeBatch decodes the phenotypes that decode gives");
+
+  codec.decodes = 0;
+  LazyCodec<Genes, Genotype> lazyCodec(codec);
+  Population<Lazy<Genes>, Genotype> lazy;
+  for (const Genotype& genotype : genotypes)
+  {
+    lazy.emplace_back(lazyCodec.decode(genotype), genotype);
+  }
+  check(codec.decodes == 0, "lazy phenotypes are not decoded until accessed");
+
+  auto copy = lazy[3];
+  check(copy.first.get() == eager[3] && lazy[3].first.isDecoded() && codec.decodes == 1,
+        "copies of a lazy phenotype share its decoded value");
+
+  lazyCodec.decodeBatch(lazy, 4);
+  equal = true;
+  for (std::size_t k = 0; k < lazy.size(); ++k)
+  {
+    equal = equal && lazy[k].first.isDecoded() && *lazy[k].first == eager[k];
+  }
+  check(equal, "lazy decodeBatch decodes the phenotypes that decode gives");
+  check(codec.decodes == lazy.size(), "lazy phenotypes are decoded once");
+}
+
+}
+
+namespace processtest {
+
+///////////////////////////////////////////////////////////////////////////////
+// Requests crashing or hanging their worker get the failure fitness; the
+// rest are evaluated by the workers restarted in their place
+void workerPool()
+{
+  WorkerPool pool([](const std::string& request)
+  {
+    if (request == "crash") std::raise(SIGSEGV);
+    if (request == "hang") std::this_thread::sleep_for(std::chrono::seconds(10));
+    return FitnessType(request.size());
+  }, 2, std::chrono::milliseconds(200), 2, -1);
+
+  std::vector<std::string> requests;
+  for (std::size_t k = 0; k < 40; ++k) requests.push_back(std::string(k + 1, 'x'));
+  requests[5] = "crash";
+  requests[30] = "hang";
+
+  PopulationFitness fitness = pool.evaluate(requests, 4);
+  bool right = fitness.size() == requests.size();
+  for (std::size_t k = 0; right && k < requests.size(); ++k)
+  {
+    right = fitness[k] == (k == 5 || k == 30 ? -1 : FitnessType(k + 1));
+  }
+  check(right, "a worker pool evaluates the requests that do not fail");
+  const WorkerStatistics& statistics = pool.statistics();
+  check(statistics.crashes >= 1, "a worker pool counts crashed workers");
+  check(statistics.timeouts >= 1, "a worker pool kills workers that time out");
+  check(statistics.failed == 2, "a worker pool gives up on requests after maxAttempts");
+
+  fitness = pool.evaluate({"a", "bb"});
+  check(fitness == PopulationFitness({1, 2}), "a worker pool keeps working after failures");
+}
+
+}
+
+namespace fitnesstest {
+
+///////////////////////////////////////////////////////////////////////////////
+// Sum of 10 cases of value / 100
+struct Sum : public SummedFitness<int, int>
+{
+  Sum() : SummedFitness<int, int>(10, [](const Individual<int, int>& individual, std::size_t)
+                                      { return FitnessType(individual.second) / 100; }, 1)
+  {
+    // do nothing
+  }
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// The 'count' fittest get their exact fitness and the rest may get bounds
+// below the cutoff, flagged as such
+void boundedCutoff()
+{
+  Population<int, int> population;
+  for (int k = 0; k < 100; ++k) population.emplace_back(0, k * 37 % 100);
+  Sum sum;
+  std::vector<bool> bounded;
+  PopulationFitness fitness = sum.calculateTop(population, 10, &bounded);
+
+  bool exact = true, below = true;
+  std::size_t flags = 0;
+  for (std::size_t k = 0; k < population.size(); ++k)
+  {
+    FitnessType expected = sum.evaluate(population[k], std::numeric_limits<FitnessType>::lowest());
+    if (population[k].second >= 90) exact = exact && fitness[k] == expected && !bounded[k];
+    if (bounded[k]) below = below && fitness[k] >= expected && fitness[k] < 9;
+    flags += bounded[k];
+  }
+  check(exact, "calculateTop gives the fittest their exact fitness");
+  check(below, "calculateTop bounds are upper bounds below the cutoff");
+  check(flags > 0 && flags == sum.statistics().bounded,
+        "calculateTop flags and counts the bounded individuals");
+
+  PopulationFitness all = sum.calculate(population);
+  bool complete = true;
+  for (std::size_t k = 0; k < population.size(); ++k)
+  {
+    complete = complete && all[k] == sum.evaluate(population[k], std::numeric_limits<FitnessType>::lowest());
+  }
+  check(complete, "calculate evaluates every individual exactly");
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-struct Survival : public SurvivalPolicy<Network, Genotype>
+// Genotype plus normal noise of deviation 1
+struct Noisy : public FitnessFunction<int, int>
 {
-  Population<Network, Genotype>
-          selectSurvivors (Population<Network, Genotype>&& ancestors,
-                           Population<Network, Genotype>&& offspring) override { }
+  std::mt19937 random{5};
+  std::normal_distribution<double> noise;
+
+  PopulationFitness calculate(const Population<int, int>& population) override
+  {
+    PopulationFitness fitness;
+    for (const auto& individual : population) fitness.push_back(individual.second + noise(random));
+    return fitness;
+  }
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Racing resamples the individuals around the boundary of the fittest,
+// and only them
+void racing()
+{
+  Population<int, int> population;
+  for (int k = 0; k < 20; ++k) population.emplace_back(0, 10 * k);
+  Noisy noisy;
+  RacingFitness<int, int> racing(noisy, [](const Individual<int, int>& individual)
+                                        { return uint64_t(individual.second); });
+  PopulationFitness fitness = racing.calculateTop(population, 5);
+  std::vector<PopulationIndex> ranking(population.size());
+  for (std::size_t k = 0; k < ranking.size(); ++k) ranking[k] = k;
+  std::sort(ranking.begin(), ranking.end(),
+            [&](PopulationIndex a, PopulationIndex b) { return fitness[a] > fitness[b]; });
+  std::sort(ranking.begin(), ranking.begin() + 5);
+  check(ranking[0] == 15 && ranking[4] == 19, "racing ranks clearly separated individuals");
+
+  population.clear();
+  for (int k = 0; k < 20; ++k) population.emplace_back(0, k);
+  RacingFitness<int, int> close(noisy, [](const Individual<int, int>& individual)
+                                       { return uint64_t(individual.second); }, 10);
+  close.calculateTop(population, 10);
+  check(close.samples(population[0]) == 1 && close.samples(population[19]) == 1,
+        "racing samples once the individuals far from the boundary");
+  check(close.samples(population[9]) > 1 && close.samples(population[10]) > 1,
+        "racing resamples the individuals at the boundary");
+  check(close.statistics().rounds > 0, "racing counts its rounds of resamples");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Survivors of the selection policies on populations whose answer is known
+void selection()
+{
+  Population<int, int> population(5);
+  PopulationFitness fitness{3, 1, 3, 2, 3};
+  TruncationSelection<int, int> truncation(2);
+  check(truncation.selectIndices(population, fitness) == std::vector<PopulationIndex>({2, 4}),
+        "truncation keeps the fittest, ties broken by higher index");
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> values(0, 1000);
+  PopulationFitness many(100000);
+  for (FitnessType& f : many) f = values(random);
+  Population<int, int> large(many.size());
+  std::vector<PopulationIndex> expected(many.size());
+  for (std::size_t k = 0; k < expected.size(); ++k) expected[k] = k;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [&](PopulationIndex a, PopulationIndex b) { return many[a] > many[b]; });
+  std::vector<PopulationIndex> best(expected.begin(), expected.begin() + 500);
+  std::sort(best.begin(), best.end());
+  TruncationSelection<int, int> parallel(500, 4);
+  std::vector<PopulationIndex> survivors = parallel.selectIndices(large, many);
+  std::size_t common = 0;
+  for (PopulationIndex k : survivors) common += std::binary_search(best.begin(), best.end(), k);
+  check(survivors.size() == 500 && std::is_sorted(survivors.begin(), survivors.end()),
+        "parallel truncation returns sorted indices");
+  bool fittest = true;
+  FitnessType threshold = many[expected[499]];
+  for (PopulationIndex k : survivors) fittest = fittest && many[k] >= threshold;
+  check(fittest && common + std::size_t(std::count(many.begin(), many.end(), threshold)) >= 500,
+        "parallel truncation keeps the fittest");
+
+  FitnessProportionateSelection<int, int> roulette(10, 2);
+  check(roulette.selectIndices(Population<int, int>(4), {0, 0, 5, 0})
+          == std::vector<PopulationIndex>({2}),
+        "roulette selection only draws individuals with fitness");
+  StochasticUniversalSampling<int, int> sus(4, 2);
+  check(sus.selectIndices(Population<int, int>(4), {1, 1, 1, 1})
+          == std::vector<PopulationIndex>({0, 1, 2, 3}),
+        "stochastic universal sampling draws each of equal individuals once");
+  TournamentSelection<int, int> tournament(2, 5);
+  check(tournament.selectSurvivors(population, fitness).size() == 2,
+        "a tournament keeps its number of survivors");
+  check(tournament.selectSurvivors(population, {1, 2, 5, 4, 3}) == Survivors({2, 3}),
+        "a tournament of the whole population keeps the fittest");
+}
+
+}
+
+namespace statisticstest {
+
+namespace bits = gene::coding::bitstring;
+namespace dna = gene::coding::dna;
+
+///////////////////////////////////////////////////////////////////////////////
+// Mean of the distance between every pair of n individuals
+double meanPairwise(std::size_t n, std::function<double(std::size_t, std::size_t)> distance)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    for (std::size_t j = i + 1; j < n; ++j) sum += distance(i, j);
+  }
+  return sum / (n * (n - 1) / 2.0);
+}
+
+bool near(double a, double b)
+{
+  return std::abs(a - b) <= 1e-9 * std::max(1.0, std::abs(b));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void runningStatistics()
+{
+  std::vector<double> values{4, -2, 7.5, 0, 3, 3, 11};
+  RunningStatistics statistics;
+  for (double x : values) statistics.add(x);
+  double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  double variance = 0;
+  for (double x : values) variance += (x - mean) * (x - mean) / values.size();
+  check(statistics.count == values.size() && near(statistics.mean, mean)
+        && near(statistics.variance(), variance)
+        && statistics.min == -2 && statistics.max == 11,
+        "running statistics match the direct mean, variance and range");
+
+  std::mt19937 random(9);
+  LocusCounter counter;
+  std::vector<std::size_t> expected(3 * 64, 0);
+  for (std::size_t k = 0; k < 300; ++k)
+  {
+    std::vector<uint64_t> words(1 + k % 3);
+    for (std::size_t w = 0; w < words.size(); ++w)
+    {
+      words[w] = (uint64_t(random()) << 32) | random();
+      for (std::size_t b = 0; b < 64; ++b) expected[w * 64 + b] += (words[w] >> b) & 1;
+    }
+    counter.add(words.data(), words.size());
+  }
+  check(counter.words() == 3 && counter.counts() == expected,
+        "locus counters count the bits set at every position");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bit strings of different lengths: exact mean Hamming distance and entropy
+void locusDiversity()
+{
+  std::mt19937 random(10);
+  std::vector<bits::Genotype> population;
+  for (std::size_t k = 0; k < 25; ++k)
+  {
+    population.emplace_back(std::vector<bits::Chromosome>{
+      bits::randomChromosome(150 + 7 * k, random), bits::randomChromosome(64, random)});
+  }
+  bits::LocusDiversity diversity;
+  for (const bits::Genotype& genotype : population) diversity.add(genotype);
+  Diversity estimate = diversity.estimate();
+
+  double expected = meanPairwise(population.size(), [&](std::size_t i, std::size_t j)
+  {
+    std::size_t distance = 0;
+    for (std::size_t c = 0; c < 2; ++c)
+    {
+      const bits::Chromosome& a = population[i].chromosomes[c];
+      const bits::Chromosome& b = population[j].chromosomes[c];
+      for (std::size_t k = 0; k < std::min(a.size, b.size); ++k) distance += a.get(k) != b.get(k);
+    }
+    return double(distance);
+  });
+  check(near(estimate.meanDistance, expected), "locus diversity gives the mean Hamming distance");
+
+  double entropySum = 0;
+  std::size_t loci = 0;
+  for (std::size_t c = 0; c < 2; ++c)
+  {
+    for (std::size_t k = 0; ; ++k, ++loci)
+    {
+      std::size_t ones = 0, covering = 0;
+      for (const bits::Genotype& genotype : population)
+      {
+        const bits::Chromosome& chromosome = genotype.chromosomes[c];
+        if (k >= chromosome.size) continue;
+        ++covering;
+        ones += chromosome.get(k);
+      }
+      if (covering == 0) break;
+      for (double p : {double(ones) / covering, 1 - double(ones) / covering})
+      {
+        if (p > 0) entropySum -= p * std::log2(p);
+      }
+    }
+  }
+  check(near(estimate.entropy, entropySum / loci), "locus diversity gives the mean entropy");
+
+  SampledDiversity<bits::Genotype> sampled([](const bits::Genotype& a, const bits::Genotype& b)
+  {
+    std::size_t distance = 0;
+    for (std::size_t c = 0; c < 2; ++c)
+    {
+      const bits::Chromosome& x = a.chromosomes[c];
+      const bits::Chromosome& y = b.chromosomes[c];
+      for (std::size_t k = 0; k < std::min(x.size, y.size); ++k) distance += x.get(k) != y.get(k);
+    }
+    return double(distance);
+  }, 1000, 1);
+  for (const bits::Genotype& genotype : population) sampled.add(genotype);
+  check(near(sampled.estimate().meanDistance, expected),
+        "sampled diversity compares every pair of a small population");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DNA of different lengths: exact mean Hamming distance, and k-mer
+// distances of 0 between copies and close to 1 between random genotypes
+void genotypeDiversity()
+{
+  std::mt19937 random(11);
+  std::vector<dna::Genotype> population;
+  for (std::size_t k = 0; k < 20; ++k)
+  {
+    population.emplace_back(std::vector<dna::Chromosome>{
+      dna::Chromosome(dnatest::randomBases(100 + 13 * k, random)),
+      dna::Chromosome(dnatest::randomBases(40, random))});
+  }
+  dna::GenotypeDiversity diversity(8, 64, 1000, 1);
+  for (const dna::Genotype& genotype : population) diversity.add(genotype);
+  Diversity estimate = diversity.estimate();
+
+  double expected = meanPairwise(population.size(), [&](std::size_t i, std::size_t j)
+  {
+    std::size_t distance = 0;
+    for (std::size_t c = 0; c < 2; ++c)
+    {
+      const dna::PackedBases& a = population[i].chromosomes[c].bases;
+      const dna::PackedBases& b = population[j].chromosomes[c].bases;
+      for (std::size_t k = 0; k < std::min(a.size(), b.size()); ++k) distance += a[k] != b[k];
+    }
+    return double(distance);
+  });
+  check(near(estimate.meanDistance, expected), "genotype diversity gives the mean Hamming distance");
+  check(estimate.entropy > 0.8 && estimate.entropy <= 1, "random DNA has a high entropy");
+  check(estimate.kmerDistance > 0.9, "random DNA shares few k-mers");
+
+  diversity.clear();
+  for (std::size_t k = 0; k < 10; ++k) diversity.add(population[3]);
+  estimate = diversity.estimate();
+  check(estimate.meanDistance == 0 && estimate.entropy == 0 && estimate.kmerDistance == 0,
+        "copies of a genotype have no diversity");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Real vectors: mean squared euclidean distance from the variances
+void valueDiversity()
+{
+  std::mt19937 random(12);
+  std::normal_distribution<double> normal;
+  std::vector<gene::evstrat::EvolutionParams> population(30);
+  for (auto& individual : population)
+  {
+    individual.value.resize(6);
+    for (double& x : individual.value) x = 3 * normal(random) + 1;
+  }
+  gene::evstrat::ValueDiversity diversity;
+  for (const auto& individual : population) diversity.add(individual);
+  double expected = meanPairwise(population.size(), [&](std::size_t i, std::size_t j)
+  {
+    double distance = 0;
+    for (std::size_t k = 0; k < 6; ++k)
+    {
+      double d = population[i].value[k] - population[j].value[k];
+      distance += d * d;
+    }
+    return distance;
+  });
+  check(near(diversity.estimate().meanDistance, expected),
+        "value diversity gives the mean squared euclidean distance");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fitness statistics leave bounded fitness out, and the best so far and
+// the stagnation carry over generations
+void populationStatistics()
+{
+  std::mt19937 random(13);
+  Population<int, bits::Genotype> population;
+  for (std::size_t k = 0; k < 4; ++k)
+  {
+    population.emplace_back(0, bits::Genotype({bits::randomChromosome(100, random)}));
+  }
+  bits::LocusDiversity diversity, direct;
+  for (const auto& individual : population) direct.add(individual.second);
+  std::size_t reports = 0;
+  PopulationStatistics<int, bits::Genotype> statistics(&diversity,
+                                                       [&](const GenerationStatistics&)
+                                                       { ++reports; });
+  statistics.observe(population, {1, 5, 3, 100}, {false, false, false, true});
+  statistics.observe(population, {2, 4, 4, 2});
+  statistics.observe(population, {6, 1, 1, 1});
+
+  const std::vector<GenerationStatistics>& history = statistics.history();
+  check(reports == 3 && history.size() == 3 && history[2].generation == 2,
+        "population statistics keep and report every generation");
+  check(history[0].fitness.count == 3 && near(history[0].fitness.mean, 3)
+        && history[0].fitness.max == 5,
+        "population statistics leave bounded fitness out");
+  check(history[1].bestEver == 5 && history[1].stagnation == 1
+        && history[2].bestEver == 6 && history[2].stagnation == 0,
+        "population statistics track the best fitness so far");
+  check(near(history[0].diversity.meanDistance, direct.estimate().meanDistance),
+        "population statistics estimate the diversity of every individual");
+}
+
+}
+
+namespace evstrattest {
+
+using namespace gene::evstrat;
+
+///////////////////////////////////////////////////////////////////////////////
+// CMA-ES reaches the minimum of the sphere and Rosenbrock's function (some
+// seeds end in the local minimum of the 5-D Rosenbrock function instead)
+void cmaes()
+{
+  FitnessAdapter sphereFitness(sphere);
+  EvolutionParams start;
+  start.value.assign(10, 3.0);
+  start.sigma = {1.0};
+  CmaEs strategy(sphereFitness, start, 0, 1);
+  while (-strategy.bestFitness() > 1e-10 && strategy.generation() < 2000) strategy.iterate();
+  check(-strategy.bestFitness() <= 1e-10, "CMA-ES converges on the sphere");
+  double distance = 0;
+  for (double x : strategy.distribution().value) distance = std::max(distance, std::abs(x));
+  check(distance < 1e-4, "the CMA-ES mean ends at the minimum of the sphere");
+
+  FitnessAdapter rosenbrockFitness(rosenbrock);
+  start.value.assign(5, 0.0);
+  start.sigma = {0.5};
+  CmaEs valley(rosenbrockFitness, start, 0, 1);
+  while (-valley.bestFitness() > 1e-8 && valley.generation() < 5000) valley.iterate();
+  check(-valley.bestFitness() <= 1e-8, "CMA-ES follows the Rosenbrock valley");
+}
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 int main(void)
 {
-  std::vector<gene::coding::dna::Chromosome> chromosomes;
-  gene::coding::dna::Genotype g(std::move(chromosomes));
-
-  BaseMutation<Network> mutation(0.10, 423);
-  ConstantMutationRate<Network> mutationRate(0.20);
-  SimpleCrossover crossover(1245);
-
-  MyFactory factory;
-  MyFitness fitness;
-  Survival survival;
-/*
-  GeneticAlgorithm<Individual, Genotype> (factory,
-                                          fitness,
-                                          mutation,
-                                          mutationRate,
-                                          attraction,
-                                          crossover,
-                                          survival);
-*/  return 0;
+  dnatest::packedBasesCopyOnWrite();
+  dnatest::crossover();
+  dnatest::populationFile();
+  dnatest::lazyDecode();
+  processtest::workerPool();
+  fitnesstest::boundedCutoff();
+  fitnesstest::racing();
+  fitnesstest::selection();
+  statisticstest::runningStatistics();
+  statisticstest::locusDiversity();
+  statisticstest::genotypeDiversity();
+  statisticstest::valueDiversity();
+  statisticstest::populationStatistics();
+  evstrattest::cmaes();
+
+  std::cout << (failures == 0 ? "All tests passed" : std::to_string(failures) + " failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
 }